@@ -0,0 +1,147 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include "..\executionservice\executionservice.hpp"
+#include "..\tradebookingservice\tradebookingservice.hpp"
+#include "..\tradebookingservice\positionservice.hpp"
+
+// Counts the child orders sent by the algo
+class ChildCounter : public ServiceListener<AlgoExecution<Bond>>
+{
+public:
+    long children = 0;
+    long quantity = 0;
+
+    void ProcessAdd(AlgoExecution<Bond>& _data)
+    {
+        ExecutionOrder<Bond>* order = _data.GetExecutionOrder();
+        if (!order->IsChildOrder()) return;
+        children++;
+        quantity += order->GetVisibleQuantity();
+    }
+    void ProcessRemove(AlgoExecution<Bond>& _data) {}
+    void ProcessUpdate(AlgoExecution<Bond>& _data) {}
+};
+
+// Work a BUY and a SELL parent read by ParentOrderConnector through execution, booking and positions;
+// true if the buyer ends long and the seller short
+bool check_parent_sides()
+{
+    TimerWheel wheel;
+    ReplayClock clock(0, 1, &wheel);
+    AlgoExecutionService<Bond> algo(&wheel);
+    ExecutionService<Bond> execution;
+    algo.AddListener(execution.GetListener());
+    TradeBookingService<Bond> booking(&clock);
+    execution.AddFillListener(booking.GetListener());
+    PositionService<Bond> positions;
+    booking.AddListener(positions.GetListener());
+
+    ParentOrderConnector<Bond> connector(&algo, &clock);
+    for (std::string text : { "TWAP,2Y,BUY,10000000,0,500,5", "TWAP,10Y,SELL,20000000,0,500,5" })
+    {
+        CsvLine line;
+        tokenize_line(text.data(), text.data() + text.size(), line);
+        connector.OnFields(line);
+    }
+
+    std::vector<OrderBook<Bond>> books;
+    for (const char* ticker : { "2Y", "10Y" })
+    {
+        books.push_back(OrderBook<Bond>(get_product<Bond>(ticker), { Order(99.5, 10000000, BID) }, { Order(100.5, 10000000, OFFER) }));
+    }
+    for (long long now = 0; now <= 1000; now++)
+    {
+        if (now % 10 == 0)
+        {
+            for (auto& book : books)
+            {
+                book.SetTimestamp(now);
+                algo.AlgoExecuteOrder(book);
+            }
+        }
+        clock.SetTime(now);
+    }
+
+    long bought = positions.GetData(get_product<Bond>("2Y").GetProductId()).GetAggregatePosition();
+    long sold = positions.GetData(get_product<Bond>("10Y").GetProductId()).GetAggregatePosition();
+    std::cout << "BUY parent position " << bought << ", SELL parent position " << sold << std::endl;
+    return bought == 10000000 && sold == -20000000;
+}
+
+// Deterministic simulation of parent order slicing: thousands of TWAP, VWAP and POV parents are
+// worked on a replay clock stepped every ms, with a book update per product every 10 ms.
+// Reports the cost of scheduling and sending per child order, after checking that BUY parents
+// book long positions and SELL parents short ones.
+// usage: algoslicingbench [parents] [slices]
+int main(int argc, char* argv[]) {
+
+    if (!check_parent_sides())
+    {
+        std::cerr << "Parent orders booked on the wrong side" << std::endl;
+        return 1;
+    }
+
+    int parent_count = argc > 1 ? std::stoi(argv[1]) : 10000;
+    int slices = argc > 2 ? std::stoi(argv[2]) : 20;
+    const long long duration = 60000;
+    const long long horizon = 2 * duration + 1000;
+
+    TimerWheel wheel;
+    ReplayClock clock(0, 1, &wheel);
+    AlgoExecutionService<Bond> algo(&wheel, parent_count);
+    ChildCounter counter;
+    algo.AddListener(&counter);
+    int profile = algo.AddVolumeProfile({ 1, 2, 4, 4, 2, 1 });
+
+    //books are one point wide so the aggressor strategy stays out; the bids shrink to show traded volume
+    int product_count = get_product_count();
+    std::vector<OrderBook<Bond>> books;
+    for (int i = 0; i < product_count; i++)
+    {
+        books.push_back(OrderBook<Bond>(get_product_at<Bond>(i), { Order(99.5, 10000000, BID) }, { Order(100.5, 10000000, OFFER) }));
+    }
+    auto update_books = [&](long long _now)
+    {
+        long bid_quantity = 10000000 - (_now / 10 % 10) * 1000000;
+        for (auto& book : books)
+        {
+            Order bid(99.5, bid_quantity, BID);
+            Order offer(100.5, 10000000, OFFER);
+            book.SetStacks(&bid, &offer, 1);
+            book.SetTimestamp(_now);
+            algo.AlgoExecuteOrder(book);
+        }
+    };
+    update_books(0);
+
+    std::mt19937 rng(42);
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < parent_count; p++)
+    {
+        const Bond& product = get_product_at<Bond>(static_cast<int>(rng() % product_count));
+        PricingSide side = rng() % 2 == 0 ? BID : OFFER;
+        long quantity = 1000000 * (1 + static_cast<long>(rng() % 50));
+        long long start_time = static_cast<long long>(rng() % duration);
+        if (p % 3 == 0) algo.SubmitTWAP(product, side, quantity, start_time, start_time + duration, slices);
+        else if (p % 3 == 1) algo.SubmitVWAP(product, side, quantity, start_time, start_time + duration, profile);
+        else algo.SubmitPOV(product, side, quantity, 0.1, start_time, start_time + duration);
+    }
+    auto submitted = std::chrono::steady_clock::now();
+
+    for (long long now = 1; now <= horizon; now++)
+    {
+        if (now % 10 == 0) update_books(now);
+        clock.SetTime(now);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    long long submit_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(submitted - start).count();
+    long long run_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - submitted).count();
+    std::cout << parent_count << " parents, " << counter.children << " children, " << algo.GetActiveParentCount() << " still active, " << algo.GetExpiredQuantity() << " expired unsent" << std::endl;
+    std::cout << "submit " << submit_ns / std::max(parent_count, 1) << " ns per parent" << std::endl;
+    std::cout << "run " << run_ns / std::max(counter.children, 1L) << " ns per child (" << horizon << " ms simulated, " << horizon / 10 * product_count << " book updates)" << std::endl;
+    return 0;
+}
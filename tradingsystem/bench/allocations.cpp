@@ -0,0 +1,106 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "..\pricingservice\pricingservice.hpp"
+#include "..\marketdataservice\marketdataservice.hpp"
+#include "..\tradebookingservice\tradebookingservice.hpp"
+#include "..\inquiryservice\inquiryservice.hpp"
+
+// Heap allocations and bytes requested through operator new, to count what reading a line allocates
+long long allocation_count = 0;
+long long allocated_bytes = 0;
+
+void* operator new(std::size_t _size)
+{
+    allocation_count++;
+    allocated_bytes += static_cast<long long>(_size);
+    void* memory = std::malloc(_size > 0 ? _size : 1);
+    if (memory == nullptr) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* _memory) noexcept { std::free(_memory); }
+void operator delete(void* _memory, std::size_t) noexcept { std::free(_memory); }
+
+// Pass the first _warmup lines to _onLine, then count the allocations of the others and print them per line
+template<typename F>
+void run(const char* _name, const std::vector<std::string>& _lines, size_t _warmup, F _onLine)
+{
+    for (size_t i = 0; i < _warmup; i++) _onLine(_lines[i]);
+
+    long long allocations_before = allocation_count;
+    long long bytes_before = allocated_bytes;
+    for (size_t i = _warmup; i < _lines.size(); i++) _onLine(_lines[i]);
+    double lines = static_cast<double>(_lines.size() - _warmup);
+    double allocations = (allocation_count - allocations_before) / lines;
+    double bytes = (allocated_bytes - bytes_before) / lines;
+
+    std::cout << "  " << _name << ": " << allocations << " allocations, " << bytes << " bytes per line" << std::endl;
+}
+
+// Heap allocations per line read by each connector, into its service without listeners, once the
+// per product state has grown: prices, books of 5 levels, trades and inquiries (quoted and accepted
+// by the simulated client) generated in the file formats. Trades are booked both with a new id per
+// line and with ids repeating, as the service keeps every trade it has booked by id.
+// usage: allocationsbench [lines]
+int main(int argc, char* argv[]) {
+
+    long count = argc > 1 ? std::stol(argv[1]) : 1000000;
+    int products = get_product_count();
+    const int depth = 5;
+    size_t warmup = static_cast<size_t>(products) * depth * 2;
+    char line[128];
+
+    std::vector<std::string> prices, books, trades, repeated_trades, inquiries;
+    const char* trade_books[] = { "TRSY1", "TRSY2", "TRSY3" };
+    for (long i = 0; i < count; i++)
+    {
+        const std::string& ticker = get_product_at<Bond>(static_cast<int>(i % products)).GetTicker();
+        std::string price = decimal_to_fractional(99.0 + (i % 512) / 256.0);
+        prices.push_back(ticker + "," + price + ",0.0078125");
+
+        //a book is depth lines of one product
+        const std::string& book_ticker = get_product_at<Bond>(static_cast<int>(i / depth % products)).GetTicker();
+        books.push_back(book_ticker + "," + price + "," + std::to_string(0.0078125 * (1 + i % depth)) + "," + std::to_string(10000000 * (1 + i % depth)) + ",0");
+
+        snprintf(line, sizeof(line), "%s,T%09ld,%s,%s,1000000,%s", ticker.c_str(), i, price.c_str(), trade_books[i % 3], i % 2 == 0 ? "BUY" : "SELL");
+        trades.push_back(line);
+        snprintf(line, sizeof(line), "%s,R%09ld,%s,%s,1000000,%s", ticker.c_str(), i % warmup, price.c_str(), trade_books[i % 3], i % 2 == 0 ? "BUY" : "SELL");
+        repeated_trades.push_back(line);
+
+        Uuid id = { static_cast<uint64_t>(i) + 1, 0x9e3779b97f4a7c15ULL };
+        inquiries.push_back(uuid_to_string(id) + "," + ticker + "," + (i % 2 == 0 ? "BUY" : "SELL") + ",1000000," + price);
+    }
+
+    ReplayClock clock(0, 1, &SharedTimerWheel());
+    std::cout << count - static_cast<long>(warmup) << " lines per connector after " << warmup << " warm up lines" << std::endl;
+
+    PricingService<Bond> pricing_service(&clock);
+    PricingConnector<Bond>* pricing_connector = pricing_service.GetConnector();
+    run("pricing", prices, warmup, [&](const std::string& _line) { pricing_connector->OnLine(_line); });
+
+    MarketDataService<Bond> market_data_service(depth, &clock);
+    MarketDataConnector<Bond>* market_data_connector = market_data_service.GetConnector();
+    run("market data", books, warmup, [&](const std::string& _line) { market_data_connector->OnLine(_line); });
+
+    //one map node per trade id: the service keeps every booked trade for GetData
+    TradeBookingService<Bond> booking_service(&clock);
+    TradeBookingConnector<Bond>* booking_connector = booking_service.GetConnector();
+    run("trade booking, new ids", trades, warmup, [&](const std::string& _line) { booking_connector->OnLine(_line); });
+    TradeBookingService<Bond> repeated_booking_service(&clock);
+    TradeBookingConnector<Bond>* repeated_booking_connector = repeated_booking_service.GetConnector();
+    run("trade booking, repeated ids", repeated_trades, warmup, [&](const std::string& _line) { repeated_booking_connector->OnLine(_line); });
+
+    InquiryService<Bond> inquiry_service(30000, &clock);
+    for (int i = 0; i < products; i++)
+    {
+        Price<Bond> price(get_product_at<Bond>(i), 100.0, 1.0 / 128);
+        inquiry_service.UpdatePrice(price);
+    }
+    InquiryDataConnector<Bond>* inquiry_connector = inquiry_service.GetConnector();
+    run("inquiry", inquiries, warmup, [&](const std::string& _line) { inquiry_connector->OnLine(_line); });
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include "..\csvtokenizer.hpp"
+
+// Lines, fields and field bytes read, to check every reader saw the same data
+struct ReadTotals
+{
+    long long lines = 0;
+    long long fields = 0;
+    long long bytes = 0;
+
+    bool operator==(const ReadTotals& _other) const { return lines == _other.lines && fields == _other.fields && bytes == _other.bytes; }
+};
+
+// The connectors before the tokenizer: getline, then a stringstream split into strings
+ReadTotals read_stringstream(std::ifstream& _file)
+{
+    ReadTotals totals;
+    std::string line;
+    while (getline(_file, line)) {
+        if (line.empty()) continue;
+        std::stringstream ss(line);
+        std::string item;
+        std::vector<std::string> splittedItems;
+        while (getline(ss, item, ',')) {
+            splittedItems.push_back(item);
+            totals.bytes += item.size();
+        }
+        totals.lines++;
+        totals.fields += splittedItems.size();
+    }
+    return totals;
+}
+
+// getline, then the line split in place, as the connectors' OnLine does
+ReadTotals read_getline(std::ifstream& _file)
+{
+    ReadTotals totals;
+    std::string line;
+    CsvLine fields;
+    while (getline(_file, line)) {
+        if (line.empty()) continue;
+        tokenize_line(line.data(), line.data() + line.size(), fields);
+        totals.lines++;
+        totals.fields += fields.count;
+        for (int i = 0; i < fields.count; i++) totals.bytes += fields.lengths[i];
+    }
+    return totals;
+}
+
+// Blocks scanned for every separator at once
+ReadTotals read_tokenizer(std::ifstream& _file)
+{
+    ReadTotals totals;
+    CsvReader reader;
+    reader.Read(_file, [&](const CsvLine& _line)
+    {
+        totals.lines++;
+        totals.fields += _line.count;
+        for (int i = 0; i < _line.count; i++) totals.bytes += _line.lengths[i];
+    });
+    return totals;
+}
+
+// Time one reader over the file and print its throughput
+template<typename F>
+bool run(const char* _name, const std::string& _filename, long long _size, F _reader, ReadTotals& _totals)
+{
+    std::ifstream file(_filename, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    auto start = std::chrono::steady_clock::now();
+    _totals = _reader(file);
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << _name << ": " << _totals.lines << " lines in " << seconds << " s, " << static_cast<long long>(_size / seconds / (1 << 20)) << " MB/s, " << static_cast<long long>(_totals.lines / seconds) << " lines/s" << std::endl;
+    return true;
+}
+
+// Throughput of the CSV tokenizer against getline with a stringstream split and getline with an in
+// place split, over a file of copies of a data file grown to the given size. The SIMD path is the
+// one compiled in: configure with -DTRADINGSYSTEM_AVX2=ON for AVX2.
+// usage: csvtokenizerbench [MB] [source file]
+int main(int argc, char* argv[]) {
+
+    long long megabytes = argc > 1 ? std::stoll(argv[1]) : 2048;
+    std::string source = argc > 2 ? argv[2] : "marketdata.txt";
+
+    std::ifstream input(source, std::ios::binary);
+    if (!input.is_open())
+    {
+        std::cerr << "Failed to open " << source << std::endl;
+        return 1;
+    }
+    std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    if (content.empty())
+    {
+        std::cerr << source << " is empty" << std::endl;
+        return 1;
+    }
+    if (content.back() != '\n') content += '\n';
+
+    std::string filename = "csvtokenizerbench.txt";
+    long long size = 0;
+    {
+        std::ofstream output(filename, std::ios::binary);
+        while (size < megabytes << 20)
+        {
+            output << content;
+            size += content.size();
+        }
+    }
+
+#if defined(CSV_AVX2)
+    std::cout << "Separator scan: AVX2" << std::endl;
+#elif defined(CSV_SSE2)
+    std::cout << "Separator scan: SSE2" << std::endl;
+#else
+    std::cout << "Separator scan: scalar" << std::endl;
+#endif
+
+    ReadTotals stringstream_totals, getline_totals, tokenizer_totals;
+    bool ok = run("getline + stringstream", filename, size, read_stringstream, stringstream_totals)
+        && run("getline + tokenize_line", filename, size, read_getline, getline_totals)
+        && run("CsvReader", filename, size, read_tokenizer, tokenizer_totals);
+    std::remove(filename.c_str());
+
+    if (!ok)
+    {
+        std::cerr << "Failed to read " << filename << std::endl;
+        return 1;
+    }
+    if (!(stringstream_totals == tokenizer_totals) || !(getline_totals == tokenizer_totals))
+    {
+        std::cerr << "The readers saw different fields" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include "..\util.hpp"
+
+// The conversion the connectors used before fractional_to_ticks: substrings, stoi and stof
+double scalar_fractional_to_decimal(const std::string& fractional)
+{
+    size_t dashPos = fractional.find('-');
+    if (dashPos == std::string::npos) {
+        std::cerr << "Invalid format" << std::endl;
+        return -1.0; // or handle error appropriately
+    }
+
+    // Extract whole part and fractional part
+    std::string wholePart = fractional.substr(0, dashPos);
+    std::string fractionPart = fractional.substr(dashPos + 1);
+
+    // Extract parts for 32nds and 256ths
+    int fraction32 = std::stoi(fractionPart.substr(0, 2));
+    int fraction256 = 0;
+    if (fractionPart.length() > 2) {
+        fraction256 = (fractionPart[2] == '+') ? 4 : std::stoi(fractionPart.substr(2));
+    }
+
+    // Convert to decimal
+    float decimalFraction = fraction32 / 32.0f + fraction256 / 256.0f;
+
+    return std::stof(wholePart) + decimalFraction;
+}
+
+// Time _convert over every quote, _rounds times, and print conversions/s
+template<typename F>
+double run(const char* _name, const std::vector<std::string>& _quotes, int _rounds, F _convert)
+{
+    double sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < _rounds; r++)
+    {
+        for (const std::string& quote : _quotes) sum += _convert(quote);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double conversions = static_cast<double>(_quotes.size()) * _rounds;
+    std::cout << _name << ": " << static_cast<long long>(conversions / seconds) << " conversions/s, " << seconds * 1e9 / conversions << " ns per conversion" << std::endl;
+    return sum;
+}
+
+// Conversions/s of fractional prices to decimal, for the original substring and stoi routine,
+// fractional_to_decimal and fractional_to_ticks, over every valid quote from 99 to 101.
+// usage: fractionalbench [million conversions]
+int main(int argc, char* argv[]) {
+
+    long long conversions = (argc > 1 ? std::stoll(argv[1]) : 20) * 1000000;
+
+    std::vector<std::string> quotes;
+    const char* suffixes[] = { "", "1", "2", "3", "+", "5", "6", "7" };
+    for (int whole = 99; whole <= 101; whole++)
+    {
+        for (int x32 = 0; x32 < 32; x32++)
+        {
+            for (const char* suffix : suffixes) quotes.push_back(std::to_string(whole) + "-" + (x32 < 10 ? "0" : "") + std::to_string(x32) + suffix);
+        }
+    }
+    int rounds = static_cast<int>(conversions / static_cast<long long>(quotes.size())) + 1;
+
+    double scalar = run("scalar substr/stoi", quotes, rounds, [](const std::string& _quote) { return scalar_fractional_to_decimal(_quote); });
+    double decimal = run("fractional_to_decimal", quotes, rounds, [](const std::string& _quote) { return fractional_to_decimal(_quote); });
+    double ticks = run("fractional_to_ticks", quotes, rounds, [](const std::string& _quote)
+    {
+        int value = 0;
+        fractional_to_ticks(_quote.data(), _quote.size(), value);
+        return static_cast<double>(value) / TICKS_PER_POINT;
+    });
+
+    //the float based routine rounds some quotes, so its sum is only close to the others
+    std::cout << "checksums " << scalar << " " << decimal << " " << ticks << std::endl;
+    return decimal == ticks ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "..\inquiryservice\inquiryservice.hpp"
+#include "..\pricingservice\pricingservice.hpp"
+
+// Generate inquiry lines in the format of inquiries.txt: id,ticker,side,quantity,price
+std::vector<std::string> generate_inquiries(long _count, unsigned _seed)
+{
+    std::mt19937_64 rng(_seed);
+    std::vector<std::string> lines;
+    lines.reserve(_count);
+    for (long i = 0; i < _count; i++)
+    {
+        Uuid id = { rng(), rng() };
+        const Bond& product = get_product_at<Bond>(static_cast<int>(rng() % get_product_count()));
+        double price = 99.0 + (rng() % 512) / 256.0;
+        long quantity = 100000 + 1000 * static_cast<long>(rng() % 50000);
+        lines.push_back(uuid_to_string(id) + "," + product.GetTicker() + "," + (rng() % 2 == 0 ? "BUY" : "SELL") + "," + std::to_string(quantity) + "," + decimal_to_fractional(price));
+    }
+    return lines;
+}
+
+// Takes the quote latency, from the inquiry line reaching the connector to the quote being sent
+class QuoteTimer : public ServiceListener<Inquiry<Bond>>
+{
+public:
+    std::chrono::steady_clock::time_point received;
+    std::vector<long long> latencies;
+    long done = 0;
+
+    void ProcessAdd(Inquiry<Bond>& _data)
+    {
+        if (_data.GetState() == QUOTED) latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - received).count());
+        else if (_data.GetState() == DONE) done++;
+    }
+    void ProcessRemove(Inquiry<Bond>& _data) {}
+    void ProcessUpdate(Inquiry<Bond>& _data) {}
+};
+
+// Inquiry quoting throughput and latency on generated inquiries: every product is priced, then
+// each inquiry line goes through the connector, is quoted and accepted by the simulated client.
+// With --generate the inquiries are written to a file instead, for the inquiry executable.
+// usage: inquirybench [inquiries]
+//        inquirybench --generate inquiries file
+int main(int argc, char* argv[]) {
+
+    if (argc > 3 && std::string(argv[1]) == "--generate")
+    {
+        std::ofstream output(argv[3]);
+        for (const std::string& line : generate_inquiries(std::stol(argv[2]), 1)) output << line << "\n";
+        return output ? 0 : 1;
+    }
+
+    long count = argc > 1 ? std::stol(argv[1]) : 1000000;
+    std::vector<std::string> lines = generate_inquiries(count, 1);
+
+    ReplayClock clock(0, 1, &SharedTimerWheel());
+    InquiryService<Bond> service(30000, &clock);
+    for (int i = 0; i < get_product_count(); i++)
+    {
+        Price<Bond> price(get_product_at<Bond>(i), 100.0, 1.0 / 128);
+        service.UpdatePrice(price);
+    }
+    QuoteTimer timer;
+    timer.latencies.reserve(count);
+    service.AddListener(&timer);
+
+    InquiryDataConnector<Bond>* connector = service.GetConnector();
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& line : lines)
+    {
+        timer.received = std::chrono::steady_clock::now();
+        connector->OnLine(line);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::vector<long long>& latencies = timer.latencies;
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double _p) { return latencies.empty() ? 0 : latencies[static_cast<size_t>(_p * (latencies.size() - 1))]; };
+
+    std::cout << count << " inquiries, " << latencies.size() << " quoted, " << timer.done << " done, " << service.GetLiveInquiryCount() << " live" << std::endl;
+    std::cout << static_cast<long long>(latencies.size() / seconds) << " quotes/s, " << seconds * 1e9 / count << " ns per inquiry" << std::endl;
+    std::cout << "quote latency ns: p50 " << percentile(0.5) << ", p99 " << percentile(0.99) << ", p99.9 " << percentile(0.999) << ", max " << percentile(1.0) << std::endl;
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include "..\historicaldataservice\journalindex.hpp"
+#include "..\bondstaticdata.hpp"
+
+// Write _count generated execution-like records, 1 ms apart and cycling through the products, to an indexed journal
+bool generate_journal(long _count, const std::string& _filename)
+{
+    remove_journal_segment(_filename);
+    JournalWriter writer;
+    if (!writer.Open(_filename)) return false;
+
+    int product_count = get_product_count();
+    char record[128];
+    for (long i = 0; i < _count; i++)
+    {
+        int product = static_cast<int>(i % product_count);
+        int length = snprintf(record, sizeof(record), "%ld,%s,E%010ld,%.8f,%ld,%s", i, get_product_at<Bond>(product).GetProductId().c_str(), i, 99.0 + (i % 512) / 256.0, 1000000L * (1 + i % 5), i % 2 == 0 ? "BID" : "OFFER");
+        writer.Append(string_view(record, static_cast<size_t>(length)), i, product);
+    }
+    return writer.IsOpen();
+}
+
+// Run _queries range queries of _width ms at random times, for one product or all, and print the latency percentiles
+void run(const JournalQuery& _query, long _records, int _queries, Timestamp _width, bool _allProducts, std::mt19937& _rng)
+{
+    std::vector<double> latencies;
+    long long matched = 0;
+    for (int q = 0; q < _queries; q++)
+    {
+        Timestamp from = static_cast<Timestamp>(_rng() % static_cast<uint64_t>(std::max<long>(_records - _width, 1)));
+        int product = _allProducts ? ALL_PRODUCTS : static_cast<int>(_rng() % get_product_count());
+
+        auto start = std::chrono::steady_clock::now();
+        matched += _query.Query(from, from + _width - 1, product, [](const JournalEntry& _entry, string_view _record) {});
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "  " << _width << " ms, " << (_allProducts ? "all products" : "one product") << ": " << matched / _queries << " records per query, latency us p50 " << latencies[latencies.size() / 2]
+        << ", p99 " << latencies[latencies.size() * 99 / 100] << ", max " << latencies.back() << std::endl;
+}
+
+// Range query latency over a large indexed journal: records 1 ms apart cycling through the
+// products are written with JournalWriter, then queries of windows from 1 s to 1 hour, for one
+// product and for all, are timed at random times, followed by one query of the whole journal.
+// usage: journalbench [million records] [queries]
+//        journalbench --generate count journal
+int main(int argc, char* argv[]) {
+
+    if (argc > 3 && std::string(argv[1]) == "--generate")
+    {
+        if (!generate_journal(std::stol(argv[2]), argv[3]))
+        {
+            std::cerr << "Failed to write " << argv[3] << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    long records = (argc > 1 ? std::stol(argv[1]) : 20) * 1000000L;
+    int queries = argc > 2 ? std::stoi(argv[2]) : 1000;
+    std::string filename = "journalbench.txt";
+
+    auto start = std::chrono::steady_clock::now();
+    if (!generate_journal(records, filename))
+    {
+        std::cerr << "Failed to write " << filename << std::endl;
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << records << " records written and indexed in " << seconds << " s, " << static_cast<long long>(records / seconds) << " records/s" << std::endl;
+
+    JournalQuery query;
+    if (!query.Open(filename))
+    {
+        std::cerr << "Failed to open " << filename << " and its index" << std::endl;
+        return 1;
+    }
+
+    std::mt19937 rng(7);
+    Timestamp widths[] = { 1000, 60000, 3600000 };
+    for (Timestamp width : widths)
+    {
+        run(query, records, queries, width, false, rng);
+        run(query, records, queries, width, true, rng);
+    }
+
+    auto scan_start = std::chrono::steady_clock::now();
+    size_t scanned = query.Query(0, INT64_MAX, ALL_PRODUCTS, [](const JournalEntry& _entry, string_view _record) {});
+    double scan_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - scan_start).count();
+    std::cout << "  whole journal: " << scanned << " records in " << scan_seconds << " s" << std::endl;
+
+    remove_journal_segment(filename);
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include "..\pricingservice\pricingservice.hpp"
+
+// Counts the prices received by the pricing service, with a checksum of their mids to compare runs
+class PriceChecksum : public ServiceListener<Price<Bond>>
+{
+public:
+    long count = 0;
+    double mid_sum = 0;
+
+    void ProcessAdd(Price<Bond>& _data) { count++; mid_sum += _data.GetMid(); }
+    void ProcessRemove(Price<Bond>& _data) {}
+    void ProcessUpdate(Price<Bond>& _data) {}
+};
+
+// Read the file once through a fresh pricing service, serially when _threads is 0, and print the rate
+bool run(const std::string& _filename, int _threads, PriceChecksum& _checksum)
+{
+    ReplayClock clock(0, 1, &SharedTimerWheel());
+    PricingService<Bond> pricing_service(&clock);
+    pricing_service.AddListener(&_checksum);
+
+    auto start = std::chrono::steady_clock::now();
+    if (_threads == 0)
+    {
+        std::ifstream file(_filename);
+        if (!file.is_open()) return false;
+        pricing_service.GetConnector()->Subscribe(file);
+    }
+    else if (pricing_service.GetConnector()->SubscribeParallel(_filename, _threads) < 0) return false;
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << (_threads == 0 ? std::string("serial") : std::to_string(_threads) + " threads") << ": " << _checksum.count << " prices in " << seconds << " s, " << static_cast<long long>(_checksum.count / seconds) << " prices/s" << std::endl;
+    return true;
+}
+
+// Thread scaling of parallel price ingest: the price file is copied into a larger generated file,
+// which is read once serially and then with SubscribeParallel on 1 to max threads. Every run must
+// pass the same prices to the service as the serial read.
+// usage: parallelingestbench [price file] [max threads] [copies]
+int main(int argc, char* argv[]) {
+
+    std::string source = argc > 1 ? argv[1] : "prices.txt";
+    int max_threads = argc > 2 ? std::stoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+    int copies = argc > 3 ? std::stoi(argv[3]) : 20;
+    if (max_threads < 1) max_threads = 1;
+
+    std::ifstream input(source, std::ios::binary);
+    if (!input.is_open())
+    {
+        std::cerr << "Failed to open " << source << std::endl;
+        return 1;
+    }
+    std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    if (!content.empty() && content.back() != '\n') content += '\n';
+
+    std::string filename = "parallelingestbench.txt";
+    {
+        std::ofstream output(filename, std::ios::binary);
+        for (int c = 0; c < copies; c++) output << content;
+    }
+
+    PriceChecksum serial;
+    bool ok = run(filename, 0, serial);
+    for (int t = 1; ok && t <= max_threads; t++)
+    {
+        PriceChecksum parallel;
+        ok = run(filename, t, parallel);
+        if (ok && (parallel.count != serial.count || parallel.mid_sum != serial.mid_sum))
+        {
+            std::cerr << t << " threads passed different prices than the serial read" << std::endl;
+            ok = false;
+        }
+    }
+
+    std::remove(filename.c_str());
+    if (!ok) return 1;
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include "..\pretraderiskservice\pretraderiskservice.hpp"
+
+// Discards the orders passing the checks
+class OrderSink : public ServiceListener<AlgoExecution<Bond>>
+{
+public:
+    long count = 0;
+
+    void ProcessAdd(AlgoExecution<Bond>& _data) { count++; }
+    void ProcessRemove(AlgoExecution<Bond>& _data) {}
+    void ProcessUpdate(AlgoExecution<Bond>& _data) {}
+};
+
+// Throughput of the pre-trade checks: a pool of generated orders (random product, side, size and
+// price around the book, 1 ms apart, with the order rate throttle on) is run through CheckOrder,
+// then through ProcessOrder with a listener taking the accepted orders.
+// usage: pretraderiskbench [million checks]
+int main(int argc, char* argv[]) {
+
+    long checks = (argc > 1 ? std::stol(argv[1]) : 20) * 1000000L;
+    const int pool_size = 4096;
+
+    ReplayClock clock(0);
+    PreTradeRiskService<Bond> service(&clock);
+    OrderSink sink;
+    service.AddListener(&sink);
+
+    //every product has a book and a throttle that rejects part of the flow
+    int product_count = get_product_count();
+    ProductRiskLimits limits = DEFAULT_RISK_LIMITS;
+    limits.ordersPerSecond = 50;
+    limits.orderBurst = 10;
+    for (int i = 0; i < product_count; i++)
+    {
+        const Bond& product = get_product_at<Bond>(i);
+        service.SetLimits(product, limits);
+        OrderBook<Bond> book(product, { Order(99.5, 10000000, BID) }, { Order(99.6, 10000000, OFFER) });
+        service.UpdateMarket(book);
+    }
+
+    std::mt19937 rng(7);
+    std::vector<ExecutionOrder<Bond>> orders;
+    for (int i = 0; i < pool_size; i++)
+    {
+        const Bond& product = get_product_at<Bond>(static_cast<int>(rng() % product_count));
+        PricingSide side = rng() % 2 == 0 ? BID : OFFER;
+        double price = 98.0 + (rng() % 4000) / 1000.0;
+        long quantity = 1000000 * (1 + static_cast<long>(rng() % 120));
+        orders.push_back(ExecutionOrder<Bond>(product, side, "BENCH" + std::to_string(i), MARKET, price, quantity, 0, "", false));
+    }
+
+    long results[RISK_ORDER_RATE + 1] = {};
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < checks; i++)
+    {
+        ExecutionOrder<Bond>& order = orders[i % pool_size];
+        order.SetTimestamp(i);
+        results[service.CheckOrder(order)]++;
+    }
+    auto checked = std::chrono::steady_clock::now();
+
+    std::vector<AlgoExecution<Bond>> executions;
+    for (auto& order : orders) executions.push_back(AlgoExecution<Bond>(order.GetProduct(), order.GetPricingSide(), order.GetOrderId(), MARKET, order.GetPrice(), order.GetVisibleQuantity(), 0, "", false));
+    long processed = checks / 10;
+    auto process_start = std::chrono::steady_clock::now();
+    for (long i = 0; i < processed; i++)
+    {
+        AlgoExecution<Bond>& execution = executions[i % pool_size];
+        execution.GetExecutionOrder()->SetTimestamp(checks + i);
+        service.ProcessOrder(execution);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double check_ns = std::chrono::duration<double, std::nano>(checked - start).count() / checks;
+    double process_ns = std::chrono::duration<double, std::nano>(end - process_start).count() / processed;
+    std::cout << "CheckOrder: " << checks << " checks, " << check_ns << " ns per check, " << static_cast<long>(1e9 / check_ns) << " checks/s" << std::endl;
+    for (int r = 0; r <= RISK_ORDER_RATE; r++)
+    {
+        if (results[r] > 0) std::cout << "  " << RISK_CHECK_NAMES[r] << " " << results[r] << std::endl;
+    }
+    std::cout << "ProcessOrder: " << processed << " orders, " << process_ns << " ns per order, " << sink.count << " forwarded, " << service.GetRejectedCount() << " rejected" << std::endl;
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include "..\pricingservice\pricingservice.hpp"
+#include "..\tradebookingservice\tradebookingservice.hpp"
+
+// Heap bytes requested through operator new, to measure what storing a message allocates
+long long allocated_bytes = 0;
+
+void* operator new(std::size_t _size)
+{
+    allocated_bytes += static_cast<long long>(_size);
+    void* memory = std::malloc(_size > 0 ? _size : 1);
+    if (memory == nullptr) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* _memory) noexcept { std::free(_memory); }
+void operator delete(void* _memory, std::size_t) noexcept { std::free(_memory); }
+
+// Price as it was before ProductRef: the product held by value
+struct PriceBefore
+{
+    Bond product;
+    double mid;
+    double bidOfferSpread;
+    Timestamp timestamp = NO_TIMESTAMP;
+
+    PriceBefore(const Bond& _product, double _mid, double _bidOfferSpread) : product(_product), mid(_mid), bidOfferSpread(_bidOfferSpread) {}
+};
+
+// Trade as it was before ProductRef: the product held by value
+struct TradeBefore
+{
+    Bond product;
+    string tradeId;
+    double price;
+    string book;
+    long quantity;
+    Side side;
+    Timestamp timestamp = NO_TIMESTAMP;
+
+    TradeBefore(const Bond& _product, string _tradeId, double _price, string _book, long _quantity, Side _side) :
+        product(_product), tradeId(_tradeId), price(_price), book(_book), quantity(_quantity), side(_side) {}
+};
+
+// Copy a pool of messages _copies times and store _stored copies, printing the copy cost and the memory per stored message
+template<typename V>
+void run(const char* _name, const std::vector<V>& _pool, long _copies, long _stored)
+{
+    std::vector<V> target(_pool);
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < _copies; i++)
+    {
+        size_t index = static_cast<size_t>(i) % _pool.size();
+        target[index] = _pool[index];
+    }
+    auto end = std::chrono::steady_clock::now();
+    double copy_ns = std::chrono::duration<double, std::nano>(end - start).count() / _copies;
+
+    //a stored message takes its own size in the container plus whatever it allocates
+    std::vector<V> stored;
+    stored.reserve(_stored);
+    long long before = allocated_bytes;
+    for (long i = 0; i < _stored; i++) stored.push_back(_pool[static_cast<size_t>(i) % _pool.size()]);
+    double heap = static_cast<double>(allocated_bytes - before) / _stored;
+
+    std::cout << _name << ": " << sizeof(V) << " bytes + " << heap << " heap bytes per stored message, " << copy_ns << " ns per copy" << std::endl;
+}
+
+// Cost of holding the product in messages, before and after ProductRef: prices and trades over
+// the products are copied (assignment into existing messages, as services replace their latest
+// value) and stored, reporting the bytes and heap allocations per stored message and ns per copy.
+// usage: productrefbench [million copies] [stored messages]
+int main(int argc, char* argv[]) {
+
+    long copies = (argc > 1 ? std::stol(argv[1]) : 20) * 1000000L;
+    long stored = argc > 2 ? std::stol(argv[2]) : 1000000;
+    const int pool_size = 4096;
+
+    std::vector<PriceBefore> prices_before;
+    std::vector<Price<Bond>> prices;
+    std::vector<TradeBefore> trades_before;
+    std::vector<Trade<Bond>> trades;
+    const char* books[] = { "TRSY1", "TRSY2", "TRSY3" };
+    for (int i = 0; i < pool_size; i++)
+    {
+        const Bond& product = get_product_at<Bond>(i % get_product_count());
+        double mid = 99.0 + (i % 512) / 256.0;
+        prices_before.push_back(PriceBefore(product, mid, 1.0 / 128));
+        prices.push_back(Price<Bond>(product, mid, 1.0 / 128));
+        std::string trade_id = "T" + std::to_string(1000000000 + i);
+        trades_before.push_back(TradeBefore(product, trade_id, mid, books[i % 3], 1000000, i % 2 == 0 ? BUY : SELL));
+        trades.push_back(Trade<Bond>(product, trade_id, mid, books[i % 3], 1000000, i % 2 == 0 ? BUY : SELL));
+    }
+
+    std::cout << "Bond: " << sizeof(Bond) << " bytes, ProductRef: " << sizeof(ProductRef<Bond>) << " bytes" << std::endl;
+    run("Price, product by value", prices_before, copies, stored);
+    run("Price, ProductRef", prices, copies, stored);
+    run("Trade, product by value", trades_before, copies, stored);
+    run("Trade, ProductRef", trades, copies, stored);
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "..\pricingservice\pricingservice.hpp"
+#include "..\streamingservice\streamingservice.hpp"
+#include "..\marketdataservice\marketdataservice.hpp"
+#include "..\tradebookingservice\tradebookingservice.hpp"
+#include "..\tradebookingservice\positionservice.hpp"
+#include "..\tradebookingservice\riskservice.hpp"
+#include "..\pretraderiskservice\pretraderiskservice.hpp"
+
+// Counts the events reaching the end of a chain of services
+template<typename V>
+class EventCounter : public ServiceListener<V>
+{
+public:
+    long count = 0;
+
+    void ProcessAdd(V& _data) { count++; }
+    void ProcessRemove(V& _data) {}
+    void ProcessUpdate(V& _data) { count++; }
+};
+
+// Write a security master reference file of _count generated securities
+bool generate_securities(int _count, const std::string& _filename)
+{
+    std::ofstream file(_filename);
+    if (!file.is_open()) return false;
+
+    file << "ticker,cusip,coupon,maturity,pv01" << std::endl;
+    for (int i = 0; i < _count; i++)
+    {
+        char cusip[16];
+        snprintf(cusip, sizeof(cusip), "9BM%06d", i);
+        int years = 1 + i % 30;
+        file << "B" << i << "," << cusip << "," << 0.125 * (i % 48) << "," << 2024 + years << "/" << 1 + i % 12 << "/15," << 0.0095 * years << "\n";
+    }
+    return true;
+}
+
+// Time _count calls of _step and print the cost per message
+template<typename F>
+void run(const char* _name, long _count, F _step)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < _count; i++) _step(i);
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / _count;
+    std::cout << "  " << _name << ": " << ns << " ns per message, " << static_cast<long long>(1e9 / ns) << " messages/s" << std::endl;
+}
+
+// Run every service over a universe of _products generated securities, messages cycling through the products
+int run_universe(int _products, long _messages)
+{
+    std::string filename = "securitymasterbench_" + std::to_string(_products) + ".csv";
+    if (!generate_securities(_products, filename) || !load_security_master(filename)) return 1;
+    int count = get_product_count();
+    std::cout << count << " products" << std::endl;
+
+    //lookups of every product by ticker and by CUSIP
+    std::vector<std::string> tickers, cusips;
+    for (int i = 0; i < count; i++)
+    {
+        tickers.push_back(get_product_at<Bond>(i).GetTicker());
+        cusips.push_back(get_product_at<Bond>(i).GetProductId());
+    }
+    long found = 0;
+    run("ticker and CUSIP lookup", _messages, [&](long _i)
+    {
+        found += get_ticker_index(tickers[_i % count]) + get_product_index(cusips[_i % count]);
+    });
+
+    //prices through pricing, algo streaming and streaming
+    ReplayClock price_clock(0, 1, &SharedTimerWheel());
+    PricingService<Bond> pricing_service(&price_clock);
+    AlgoStreamingService<Bond> algo_streaming_service;
+    pricing_service.AddListener(algo_streaming_service.GetListener());
+    StreamingService<Bond> streaming_service(100, &price_clock);
+    algo_streaming_service.AddListener(streaming_service.GetListener());
+    EventCounter<PriceStream<Bond>> quotes;
+    streaming_service.AddListener(&quotes);
+    run("pricing to streaming", _messages, [&](long _i)
+    {
+        Price<Bond> price(get_product_at<Bond>(static_cast<int>(_i % count)), 99.0 + (_i % 512) / 256.0, 1.0 / 128);
+        price.SetTimestamp(price_clock.Stamp());
+        pricing_service.OnMessage(std::move(price));
+    });
+
+    //books of 5 levels a side
+    ReplayClock book_clock(0);
+    MarketDataService<Bond> market_data_service(5, &book_clock);
+    EventCounter<OrderBook<Bond>> books;
+    market_data_service.AddListener(&books);
+    std::vector<Order> bids, offers;
+    for (int level = 0; level < 5; level++)
+    {
+        bids.push_back(Order(99.5 - level / 256.0, 10000000 * (level + 1), BID));
+        offers.push_back(Order(99.5 + (level + 1) / 256.0, 10000000 * (level + 1), OFFER));
+    }
+    run("market data", _messages, [&](long _i)
+    {
+        OrderBook<Bond> book(get_product_at<Bond>(static_cast<int>(_i % count)), bids, offers);
+        market_data_service.OnMessage(book);
+    });
+
+    //trades through booking, positions and risk
+    TradeBookingService<Bond> booking_service;
+    PositionService<Bond> position_service;
+    booking_service.AddListener(position_service.GetListener());
+    RiskService<Bond> risk_service;
+    position_service.AddListener(risk_service.GetListener());
+    EventCounter<PV01<Bond>> risks;
+    risk_service.AddListener(&risks);
+    std::vector<Trade<Bond>> trades;
+    const char* trade_books[] = { "TRSY1", "TRSY2", "TRSY3" };
+    for (int i = 0; i < count * 4; i++)
+    {
+        trades.push_back(Trade<Bond>(get_product_at<Bond>(i % count), "BENCH" + std::to_string(i), 99.5, trade_books[i % 3], 1000000, i % 2 == 0 ? BUY : SELL));
+    }
+    run("booking to risk", _messages, [&](long _i)
+    {
+        booking_service.OnMessage(trades[_i % trades.size()]);
+    });
+
+    //pre-trade checks against a book per product
+    ReplayClock risk_clock(0);
+    PreTradeRiskService<Bond> pre_trade_service(&risk_clock);
+    std::vector<ExecutionOrder<Bond>> orders;
+    for (int i = 0; i < count; i++)
+    {
+        OrderBook<Bond> book(get_product_at<Bond>(i), { Order(99.5, 10000000, BID) }, { Order(99.6, 10000000, OFFER) });
+        pre_trade_service.UpdateMarket(book);
+    }
+    for (int i = 0; i < count * 4; i++)
+    {
+        orders.push_back(ExecutionOrder<Bond>(get_product_at<Bond>(i % count), i % 2 == 0 ? BID : OFFER, "BENCH" + std::to_string(i), MARKET, 99.55, 1000000, 0, "", false));
+    }
+    long accepted = 0;
+    run("pre-trade checks", _messages, [&](long _i)
+    {
+        ExecutionOrder<Bond>& order = orders[_i % orders.size()];
+        order.SetTimestamp(_i);
+        if (pre_trade_service.CheckOrder(order) == RISK_ACCEPTED) accepted++;
+    });
+
+    std::remove(filename.c_str());
+    std::remove((filename + ".cache").c_str());
+    return found >= 0 && quotes.count + books.count + risks.count + accepted > 0 ? 0 : 1;
+}
+
+// Scaling of the services with the size of the security master: for 7, 10, 100 and 1000 generated
+// securities, each universe in its own process, lookups, prices to quotes, books, trades to risk
+// and pre-trade checks are timed with messages cycling through every product.
+// usage: securitymasterbench [million messages]
+//        securitymasterbench --products count [million messages]
+//        securitymasterbench --generate count file
+int main(int argc, char* argv[]) {
+
+    if (argc > 3 && std::string(argv[1]) == "--generate")
+    {
+        if (!generate_securities(std::stoi(argv[2]), argv[3]))
+        {
+            std::cerr << "Failed to write " << argv[3] << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 2 && std::string(argv[1]) == "--products")
+    {
+        return run_universe(std::stoi(argv[2]), (argc > 3 ? std::stol(argv[3]) : 2) * 1000000L);
+    }
+
+    //the security master is loaded once per process, so every universe runs in a fresh one
+    std::string millions = argc > 1 ? argv[1] : "2";
+    int universes[] = { 7, 10, 100, 1000 };
+    for (int products : universes)
+    {
+        std::string command = std::string("\"") + argv[0] + "\" --products " + std::to_string(products) + " " + millions;
+        if (std::system(command.c_str()) != 0) return 1;
+    }
+    return 0;
+}
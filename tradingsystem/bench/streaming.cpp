@@ -0,0 +1,68 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include "..\pricingservice\pricingservice.hpp"
+#include "..\streamingservice\streamingservice.hpp"
+
+// Counts the prices received by the pricing service
+class PriceCounter : public ServiceListener<Price<Bond>>
+{
+public:
+    long count = 0;
+
+    void ProcessAdd(Price<Bond>& _data) { count++; }
+    void ProcessRemove(Price<Bond>& _data) {}
+    void ProcessUpdate(Price<Bond>& _data) {}
+};
+
+// Counts the quotes published by the streaming service
+class QuoteCounter : public ServiceListener<PriceStream<Bond>>
+{
+public:
+    long count = 0;
+
+    void ProcessAdd(PriceStream<Bond>& _data) { count++; }
+    void ProcessRemove(PriceStream<Bond>& _data) {}
+    void ProcessUpdate(PriceStream<Bond>& _data) {}
+};
+
+// Replay throughput of the quoting path: a price file is replayed on a replay clock through
+// PricingService, AlgoStreamingService (inventory skew) and StreamingService (100 ms minimum
+// quote life), without persisting the quotes. Reports prices and published quotes per second.
+// usage: streamingbench [price file] [repeats]
+int main(int argc, char* argv[]) {
+
+    std::string filename = argc > 1 ? argv[1] : "prices.txt";
+    int repeats = argc > 2 ? std::stoi(argv[2]) : 1;
+
+    ReplayClock* clock = new ReplayClock(0, 1, &SharedTimerWheel());
+    PricingService<Bond>* pricing_service = new PricingService<Bond>(clock);
+    AlgoStreamingService<Bond>* algo_streaming_service = new AlgoStreamingService<Bond>();
+    pricing_service->AddListener(algo_streaming_service->GetListener());
+    StreamingService<Bond>* streaming_service = new StreamingService<Bond>(100, clock);
+    algo_streaming_service->AddListener(streaming_service->GetListener());
+    PriceCounter prices;
+    pricing_service->AddListener(&prices);
+    QuoteCounter counter;
+    streaming_service->AddListener(&counter);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        std::ifstream file(filename);
+        if (!file.is_open())
+        {
+            std::cerr << "Failed to open " << filename << std::endl;
+            return 1;
+        }
+        pricing_service->GetConnector()->Subscribe(file);
+    }
+    streaming_service->Flush();
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << prices.count << " prices in " << seconds << " s: " << static_cast<long long>(prices.count / seconds) << " prices/s, " << seconds * 1e9 / prices.count << " ns per price" << std::endl;
+    std::cout << counter.count << " quotes published (" << static_cast<long long>(counter.count / seconds) << " quotes/s), " << streaming_service->GetSuppressedCount() << " suppressed" << std::endl;
+    return 0;
+}
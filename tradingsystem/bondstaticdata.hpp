@@ -1,6 +1,10 @@
 /**
  * bondstaticdata.hpp
  * Contains static data for the 7 current on-the-run US treasuries.
+ * The securities table is a constexpr array with perfect hashed lookup by ticker and by CUSIP,
+ * and products are built once and handed out by reference. A security master loaded at startup
+ * (load_security_master) replaces the table for larger universes. Value types refer to products
+ * through a ProductRef into this registry instead of holding a copy.
  *
  * @author Krystal Lin
  */
@@ -9,48 +13,228 @@
 #define BONDSTATICDATA_HPP
 
 #include <string>
-#include <map>
+#include <string_view>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include "products.hpp"
+#include "securitymaster.hpp"
 #include <type_traits>
 
-static std::map<std::string, std::string> CUSIP_MAPPING = { {"2Y","91282CJL6"},
-														   {"3Y","91282CJP7"},
-														   {"5Y","91282CJN2"},
-														   {"7Y","91282CJM4"},
-														   {"10Y","91282CJJ1"},
-														   {"20Y","912810TW8"},
-														   {"30Y","912810TV0"} };
+// Number of products in the built in static data
+const int PRODUCT_COUNT = 7;
+
+/**
+ * Static data of one security.
+ */
+struct SecurityStatic
+{
+	string_view ticker;
+	string_view cusip;
+	float coupon;
+	int maturityYear;
+	int maturityMonth;
+	int maturityDay;
+	double pv01;
+};
+
+// Securities in product index order. PV01 from bbg ASOF 12/22/2023
+constexpr SecurityStatic SECURITIES[PRODUCT_COUNT] = {
+	{ "2Y", "91282CJL6", 4.875f, 2025, 11, 30, 0.0184433 },
+	{ "3Y", "91282CJP7", 4.375f, 2026, 12, 15, 0.027892 },
+	{ "5Y", "91282CJN2", 4.375f, 2028, 11, 30, 0.0451297 },
+	{ "7Y", "91282CJM4", 4.375f, 2030, 11, 30, 0.0613336 },
+	{ "10Y", "91282CJJ1", 4.5f, 2033, 11, 15, 0.0840999 },
+	{ "20Y", "912810TW8", 4.75f, 2043, 11, 15, 0.1410550 },
+	{ "30Y", "912810TV0", 4.75f, 2053, 11, 15, 0.1890362 } };
+
+// Number of hash slots per key; a power of two above PRODUCT_COUNT
+const int SECURITY_HASH_SLOTS = 16;
+
+/**
+ * Collision free hash of the tickers or CUSIPs of the securities: the seed puts every key in its
+ * own slot, and each slot holds the product index of its key or -1.
+ */
+struct SecurityHash
+{
+	uint32_t seed;
+	array<int8_t, SECURITY_HASH_SLOTS> slots;
+};
+
+// Find a seed that hashes every key to its own slot, at compile time
+constexpr SecurityHash make_security_hash(bool _byCusip)
+{
+	for (uint32_t seed = 0; ; seed++)
+	{
+		SecurityHash hash = { seed, {} };
+		for (auto& slot : hash.slots) slot = -1;
+
+		bool collision = false;
+		for (int i = 0; i < PRODUCT_COUNT && !collision; i++)
+		{
+			string_view key = _byCusip ? SECURITIES[i].cusip : SECURITIES[i].ticker;
+			int8_t& slot = hash.slots[security_hash(key, seed) & (SECURITY_HASH_SLOTS - 1)];
+			if (slot >= 0) collision = true;
+			else slot = static_cast<int8_t>(i);
+		}
+		if (!collision) return hash;
+	}
+}
+
+constexpr SecurityHash TICKER_HASH = make_security_hash(false);
+constexpr SecurityHash CUSIP_HASH = make_security_hash(true);
+
+// Get the built in index of a product by ticker. -1 if the ticker is unknown.
+constexpr int get_static_ticker_index(string_view _ticker)
+{
+	int index = TICKER_HASH.slots[security_hash(_ticker, TICKER_HASH.seed) & (SECURITY_HASH_SLOTS - 1)];
+	return index >= 0 && SECURITIES[index].ticker == _ticker ? index : -1;
+}
+
+// Get the built in index of a product by cusip. -1 if the cusip is unknown.
+constexpr int get_static_product_index(string_view _cusip)
+{
+	int index = CUSIP_HASH.slots[security_hash(_cusip, CUSIP_HASH.seed) & (SECURITY_HASH_SLOTS - 1)];
+	return index >= 0 && SECURITIES[index].cusip == _cusip ? index : -1;
+}
+
+static_assert(get_static_ticker_index("10Y") == 4 && get_static_product_index("912810TV0") == 6 && get_static_ticker_index("1Y") == -1);
+
+// Security master loaded at startup; the built in table is used while it is null
+SecurityMaster* LOADED_SECURITY_MASTER = nullptr;
+
+// Load the securities of a reference file in place of the built in table; call before creating services. False if it cannot be read.
+bool load_security_master(const string& _filename)
+{
+	static SecurityMaster master;
+	if (!master.Load(_filename))
+	{
+		std::cerr << "Failed to load security master " << _filename << std::endl;
+		return false;
+	}
+	LOADED_SECURITY_MASTER = &master;
+	return true;
+}
+
+// Number of products; product indices run from 0 to get_product_count() - 1
+int get_product_count()
+{
+	return LOADED_SECURITY_MASTER != nullptr ? LOADED_SECURITY_MASTER->GetCount() : PRODUCT_COUNT;
+}
+
+// Get the dense index of a product by ticker. -1 if the ticker is unknown.
+int get_ticker_index(string_view _ticker)
+{
+	return LOADED_SECURITY_MASTER != nullptr ? LOADED_SECURITY_MASTER->FindTicker(_ticker) : get_static_ticker_index(_ticker);
+}
+
+// Get the dense index of a product, used to address per product arrays. -1 if the cusip is unknown.
+int get_product_index(string_view _cusip)
+{
+	return LOADED_SECURITY_MASTER != nullptr ? LOADED_SECURITY_MASTER->FindCusip(_cusip) : get_static_product_index(_cusip);
+}
 
 
 template <typename T>
-T get_product(string ticker);  // Declaration only
+const T& get_product_at(int _index);  // Declaration only
 
-// Get Bond object for US Treasury
+// Get the Bond object of a product index, built once; a default Bond if the index is out of range
 template <>
-Bond get_product(string ticker)
-{
-	if (ticker == "2Y")  return Bond("91282CJL6", CUSIP, "2Y", 4.875, from_string("2025/11/30"));
-	else if (ticker == "3Y") return Bond("91282CJP7", CUSIP, "3Y", 4.375, from_string("2026/12/15"));
-	else if (ticker == "5Y") return Bond("91282CJN2", CUSIP, "5Y", 4.375, from_string("2028/11/30"));
-	else if (ticker == "7Y") return Bond("91282CJM4", CUSIP, "7Y", 4.375, from_string("2030/11/30"));
-	else if (ticker == "10Y") return Bond("91282CJJ1", CUSIP, "10Y", 4.5, from_string("2033/11/15"));
-	else if (ticker == "20Y") return Bond("912810TW8", CUSIP, "20Y", 4.75, from_string("2043/11/15"));
-	else if (ticker == "30Y") return Bond("912810TV0", CUSIP, "30Y", 4.75, from_string("2053/11/15"));
-}
-
-
-// Get PV01 value for US Treasury. From bbg ASOF 12/22/2023
-double get_pv01(string _cusip)
-{
-	double _pv01 = 0;
-	if (_cusip == "91282CJL6") _pv01 = 0.0184433;
-	else if (_cusip == "91282CJP7") _pv01 = 0.027892;
-	else if (_cusip == "91282CJN2") _pv01 = 0.0451297;
-	else if (_cusip == "91282CJM4") _pv01 = 0.0613336;
-	else if (_cusip == "91282CJJ1") _pv01 = 0.0840999;
-	else if (_cusip == "912810TW8") _pv01 = 0.1410550;
-	else if (_cusip == "912810TV0") _pv01 = 0.1890362;
-	return _pv01;
+const Bond& get_product_at(int _index)
+{
+	static const Bond unknown;
+	static const array<Bond, PRODUCT_COUNT> bonds = []()
+	{
+		array<Bond, PRODUCT_COUNT> built;
+		for (int i = 0; i < PRODUCT_COUNT; i++)
+		{
+			const SecurityStatic& security = SECURITIES[i];
+			built[i] = Bond(string(security.cusip), CUSIP, string(security.ticker), security.coupon, date(security.maturityYear, security.maturityMonth, security.maturityDay));
+		}
+		return built;
+	}();
+	if (_index < 0 || _index >= get_product_count()) return unknown;
+	return LOADED_SECURITY_MASTER != nullptr ? LOADED_SECURITY_MASTER->GetBond(_index) : bonds[_index];
+}
+
+// Get the product for a ticker; a default product if the ticker is unknown
+template <typename T>
+const T& get_product(string_view ticker)
+{
+	return get_product_at<T>(get_ticker_index(ticker));
+}
+
+
+// Get the shared instance of a product: the registry's for known products, an interned copy for others
+template <typename T>
+const T& intern_product(const T& _product)
+{
+	int index = get_product_index(_product.GetProductId());
+	if (index >= 0) return get_product_at<T>(index);
+
+	static mutex lock;
+	static unordered_map<string, unique_ptr<T>> others;
+	lock_guard<mutex> guard(lock);
+	unique_ptr<T>& other = others[_product.GetProductId()];
+	if (!other) other = make_unique<T>(_product);
+	return *other;
+}
+
+/**
+ * Lightweight immutable handle to a shared product, so copying a value type copies a pointer
+ * instead of the product's strings. Products are never freed, so handles stay valid; load the
+ * security master before creating any.
+ * Type T is the product type.
+ */
+template <typename T>
+class ProductRef
+{
+
+private:
+
+	const T* product;
+
+public:
+
+	// Handle to a default constructed product
+	ProductRef();
+
+	// Handle to the shared instance of _product
+	ProductRef(const T& _product);
+
+	// Get the product
+	const T& Get() const;
+
+};
+
+template <typename T>
+ProductRef<T>::ProductRef()
+{
+	static const T none;
+	product = &none;
+}
+
+template <typename T>
+ProductRef<T>::ProductRef(const T& _product)
+{
+	product = &intern_product(_product);
+}
+
+template <typename T>
+const T& ProductRef<T>::Get() const
+{
+	return *product;
+}
+
+
+// Get PV01 value for US Treasury; 0 if the cusip is unknown
+double get_pv01(string_view _cusip)
+{
+	int index = get_product_index(_cusip);
+	if (index < 0) return 0;
+	return LOADED_SECURITY_MASTER != nullptr ? LOADED_SECURITY_MASTER->GetPV01(index) : SECURITIES[index].pv01;
 }
 
 
@@ -0,0 +1,188 @@
+/**
+ * clock.hpp
+ * Pluggable clocks injected into services and connectors: wall clock, monotonic clock, and a
+ * replay clock driven by the data being replayed for deterministic backtests.
+ * All times are milliseconds since epoch.
+ *
+ * @author Krystal Lin
+ */
+
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+#include <chrono>
+#include "timerwheel.hpp"
+
+// Event time in milliseconds since epoch
+typedef long long Timestamp;
+
+// Marker for data that does not carry its own event time
+const Timestamp NO_TIMESTAMP = -1;
+
+/**
+ * Base class for clocks.
+ * Connectors call Stamp for every event they ingest to get its timestamp; a clock with an
+ * attached timer wheel advances the wheel to that time first, so timers due before an event
+ * fire before the event is dispatched.
+ */
+class Clock
+{
+
+protected:
+
+	TimerWheel* timer_wheel;
+
+public:
+
+	// Constructor, optionally attaching the timer wheel driven by this clock
+	Clock(TimerWheel* _timerWheel = nullptr);
+
+	// Get the current time
+	virtual Timestamp Now() = 0;
+
+	// Get the timestamp of an ingested event; _eventTime is the time carried by the data, if any
+	virtual Timestamp Stamp(Timestamp _eventTime = NO_TIMESTAMP);
+
+	// Fire the timers due by the current time; for idle periods without events to stamp
+	void AdvanceTimers();
+
+	// Get the timer wheel driven by this clock, nullptr if none
+	TimerWheel* GetTimerWheel() const;
+
+};
+
+/**
+ * Wall clock, the time of day of the system. Can jump if the system time is adjusted.
+ */
+class WallClock : public Clock
+{
+
+public:
+
+	WallClock(TimerWheel* _timerWheel = nullptr);
+
+	Timestamp Now();
+
+};
+
+/**
+ * Monotonic clock: steady clock anchored on the wall clock when created, so timestamps read
+ * like wall clock times but never go backwards.
+ */
+class MonotonicClock : public Clock
+{
+
+private:
+
+	Timestamp origin;
+	std::chrono::steady_clock::time_point steady_origin;
+
+public:
+
+	MonotonicClock(TimerWheel* _timerWheel = nullptr);
+
+	Timestamp Now();
+
+};
+
+/**
+ * Replay clock: time only moves with the replayed data. Events that carry a timestamp set the
+ * clock to it (never backwards), events that do not move it forward by a fixed step. The same
+ * input therefore always produces the same timestamps and timer firings, and a day of data runs
+ * as fast as it can be processed.
+ */
+class ReplayClock : public Clock
+{
+
+private:
+
+	Timestamp now;
+	Timestamp step;
+
+public:
+
+	// Constructor; _start is the time before the first event, _step the time between events without a timestamp
+	ReplayClock(Timestamp _start, Timestamp _step = 1, TimerWheel* _timerWheel = nullptr);
+
+	Timestamp Now();
+
+	Timestamp Stamp(Timestamp _eventTime = NO_TIMESTAMP);
+
+	// Move the clock to _time, advancing the attached timer wheel
+	void SetTime(Timestamp _time);
+
+};
+
+Clock::Clock(TimerWheel* _timerWheel)
+{
+	timer_wheel = _timerWheel;
+}
+
+Timestamp Clock::Stamp(Timestamp _eventTime)
+{
+	Timestamp time = _eventTime != NO_TIMESTAMP ? _eventTime : Now();
+	if (timer_wheel != nullptr) timer_wheel->Advance(time);
+	return time;
+}
+
+void Clock::AdvanceTimers()
+{
+	if (timer_wheel != nullptr) timer_wheel->Advance(Now());
+}
+
+TimerWheel* Clock::GetTimerWheel() const
+{
+	return timer_wheel;
+}
+
+WallClock::WallClock(TimerWheel* _timerWheel) : Clock(_timerWheel)
+{
+}
+
+Timestamp WallClock::Now()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+MonotonicClock::MonotonicClock(TimerWheel* _timerWheel) : Clock(_timerWheel)
+{
+	origin = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	steady_origin = std::chrono::steady_clock::now();
+}
+
+Timestamp MonotonicClock::Now()
+{
+	return origin + std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - steady_origin).count();
+}
+
+ReplayClock::ReplayClock(Timestamp _start, Timestamp _step, TimerWheel* _timerWheel) : Clock(_timerWheel)
+{
+	now = _start;
+	step = _step;
+}
+
+Timestamp ReplayClock::Now()
+{
+	return now;
+}
+
+Timestamp ReplayClock::Stamp(Timestamp _eventTime)
+{
+	SetTime(_eventTime != NO_TIMESTAMP ? _eventTime : now + step);
+	return now;
+}
+
+void ReplayClock::SetTime(Timestamp _time)
+{
+	if (_time > now) now = _time;
+	if (timer_wheel != nullptr) timer_wheel->Advance(now);
+}
+
+// Clock used by services that are not given one: wall clock driving the shared timer wheel
+Clock& DefaultClock()
+{
+	static WallClock clock(&SharedTimerWheel());
+	return clock;
+}
+
+#endif
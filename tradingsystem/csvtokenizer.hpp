@@ -0,0 +1,246 @@
+/**
+ * csvtokenizer.hpp
+ * Vectorized tokenizer for the comma separated input files: finds every comma and newline of a
+ * block of text at once with SIMD compares (AVX2 or SSE2, scalar otherwise) and hands out the
+ * fields of each line as pointers into the block, without copying them into strings. Numeric
+ * fields are parsed where they lie, so reading a line allocates nothing.
+ *
+ * @author Krystal Lin
+ */
+
+#ifndef CSVTOKENIZER_HPP
+#define CSVTOKENIZER_HPP
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <vector>
+#include <istream>
+#include <functional>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include "util.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CSV_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CSV_SSE2
+#endif
+
+using namespace std;
+
+// Most fields kept per line; further fields are ignored
+const int CSV_MAX_FIELDS = 16;
+
+// Flag on a separator offset marking a newline rather than a comma
+const uint32_t CSV_NEWLINE = 0x80000000u;
+
+/**
+ * Fields of one line, pointing into the text they were found in; valid while that text is.
+ */
+struct CsvLine
+{
+	const char* fields[CSV_MAX_FIELDS];
+	uint32_t lengths[CSV_MAX_FIELDS];
+	int count;
+
+	// Get a field as a view, empty if the line has fewer fields
+	string_view View(int _index) const;
+
+	// Get a field as a string, empty if the line has fewer fields
+	string Field(int _index) const;
+
+	// Parse a field as a decimal number in place; 0 if it is missing or not a number
+	double Number(int _index) const;
+
+	// Parse a field as an integer in place; 0 if it is missing or not an integer
+	long long Integer(int _index) const;
+};
+
+string_view CsvLine::View(int _index) const
+{
+	return _index < count ? string_view(fields[_index], lengths[_index]) : string_view();
+}
+
+string CsvLine::Field(int _index) const
+{
+	return _index < count ? string(fields[_index], lengths[_index]) : string();
+}
+
+double CsvLine::Number(int _index) const
+{
+	double value = 0;
+	if (_index < count) from_chars(fields[_index], fields[_index] + lengths[_index], value);
+	return value;
+}
+
+long long CsvLine::Integer(int _index) const
+{
+	long long value = 0;
+	if (_index < count) from_chars(fields[_index], fields[_index] + lengths[_index], value);
+	return value;
+}
+
+// Append the offset of every comma and newline of a block (under 2GB) to _separators, newlines flagged with CSV_NEWLINE
+void scan_separators(const char* _data, size_t _size, vector<uint32_t>& _separators)
+{
+	size_t i = 0;
+
+	//compare a register of bytes against both separators and walk the set bits of the masks
+#if defined(CSV_AVX2)
+	const __m256i comma = _mm256_set1_epi8(',');
+	const __m256i newline = _mm256_set1_epi8('\n');
+	for (; i + 32 <= _size; i += 32)
+	{
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_data + i));
+		uint32_t newlines = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, comma))) | newlines;
+		while (mask != 0)
+		{
+			int bit = lowest_bit(mask);
+			uint32_t offset = static_cast<uint32_t>(i + bit);
+			_separators.push_back((newlines >> bit) & 1 ? offset | CSV_NEWLINE : offset);
+			mask &= mask - 1;
+		}
+	}
+#elif defined(CSV_SSE2)
+	const __m128i comma = _mm_set1_epi8(',');
+	const __m128i newline = _mm_set1_epi8('\n');
+	for (; i + 16 <= _size; i += 16)
+	{
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_data + i));
+		uint32_t newlines = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+		uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, comma))) | newlines;
+		while (mask != 0)
+		{
+			int bit = lowest_bit(mask);
+			uint32_t offset = static_cast<uint32_t>(i + bit);
+			_separators.push_back((newlines >> bit) & 1 ? offset | CSV_NEWLINE : offset);
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	for (; i < _size; i++)
+	{
+		if (_data[i] == ',') _separators.push_back(static_cast<uint32_t>(i));
+		else if (_data[i] == '\n') _separators.push_back(static_cast<uint32_t>(i) | CSV_NEWLINE);
+	}
+}
+
+// Split one line (without its newline) into fields
+void tokenize_line(const char* _begin, const char* _end, CsvLine& _line)
+{
+	if (_end > _begin && _end[-1] == '\r') _end--;
+
+	_line.count = 0;
+	const char* field = _begin;
+	while (_line.count < CSV_MAX_FIELDS)
+	{
+		const char* comma = static_cast<const char*>(memchr(field, ',', static_cast<size_t>(_end - field)));
+		const char* field_end = comma != nullptr ? comma : _end;
+		_line.fields[_line.count] = field;
+		_line.lengths[_line.count] = static_cast<uint32_t>(field_end - field);
+		_line.count++;
+		if (comma == nullptr) break;
+		field = comma + 1;
+	}
+}
+
+/**
+ * Reads a stream of comma separated lines block by block, scanning each block for separators in
+ * one pass and passing every non empty line to a callback as fields. A line cut by the end of
+ * a block is carried to the next one; the last line needs no newline.
+ */
+class CsvReader
+{
+
+private:
+
+	vector<char> buffer;
+	vector<uint32_t> separators;
+
+	// Add the field [_begin, _end) of the buffer to _line, trimming a carriage return before a newline
+	void AddField(CsvLine& _line, size_t _begin, size_t _end, bool _lastOnLine);
+
+public:
+
+	// Constructor; _blockSize bytes are read and scanned at a time
+	CsvReader(size_t _blockSize = 1 << 20);
+
+	// Pass every line of _input to _onLine
+	void Read(istream& _input, const function<void(const CsvLine&)>& _onLine);
+
+};
+
+CsvReader::CsvReader(size_t _blockSize)
+{
+	buffer = vector<char>(_blockSize > 0 ? _blockSize : 1);
+	separators.reserve(buffer.size() / 4);
+}
+
+void CsvReader::AddField(CsvLine& _line, size_t _begin, size_t _end, bool _lastOnLine)
+{
+	if (_line.count >= CSV_MAX_FIELDS) return;
+	if (_lastOnLine && _end > _begin && buffer[_end - 1] == '\r') _end--;
+	_line.fields[_line.count] = &buffer[_begin];
+	_line.lengths[_line.count] = static_cast<uint32_t>(_end - _begin);
+	_line.count++;
+}
+
+void CsvReader::Read(istream& _input, const function<void(const CsvLine&)>& _onLine)
+{
+	size_t filled = 0;
+	while (true)
+	{
+		_input.read(&buffer[filled], static_cast<streamsize>(buffer.size() - filled));
+		size_t requested = buffer.size() - filled;
+		size_t received = static_cast<size_t>(_input.gcount());
+		filled += received;
+		bool end = received < requested;
+		if (filled == 0) return;
+
+		separators.clear();
+		scan_separators(&buffer[0], filled, separators);
+
+		CsvLine line;
+		line.count = 0;
+		size_t field_start = 0;
+		size_t line_start = 0;
+		for (uint32_t separator : separators)
+		{
+			size_t offset = separator & ~CSV_NEWLINE;
+			bool newline = (separator & CSV_NEWLINE) != 0;
+			AddField(line, field_start, offset, newline);
+			field_start = offset + 1;
+
+			if (newline)
+			{
+				if (line.count > 1 || line.lengths[0] > 0) _onLine(line);
+				line.count = 0;
+				line_start = field_start;
+			}
+		}
+
+		if (end)
+		{
+			//last line without a newline
+			if (line_start < filled)
+			{
+				AddField(line, field_start, filled, true);
+				if (line.count > 1 || line.lengths[0] > 0) _onLine(line);
+			}
+			return;
+		}
+
+		//carry the unfinished line to the front; a line longer than the buffer grows it
+		if (line_start == 0) buffer.resize(buffer.size() * 2);
+		memmove(&buffer[0], &buffer[line_start], filled - line_start);
+		filled -= line_start;
+	}
+}
+
+#endif
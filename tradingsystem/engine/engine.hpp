@@ -0,0 +1,314 @@
+/**
+ * engine.hpp
+ * Building blocks of the single process trading engine: configuration, per pipeline mailboxes
+ * and clocks, cross thread listeners and thread pinning.
+ *
+ * @author Krystal Lin
+ */
+#ifndef ENGINE_HPP
+#define ENGINE_HPP
+
+#include <string>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "..\soa.hpp"
+
+using namespace std;
+
+/**
+ * Engine configuration read from a file of "key = value" lines; '#' starts a comment.
+ */
+class EngineConfig
+{
+
+private:
+
+	map<string, string> values;
+
+	static string Trim(const string& _text);
+
+public:
+
+	// Load the configuration; false if the file cannot be opened
+	bool Load(const string& _filename);
+
+	// Get a value, or _default if the key is not set
+	string Get(const string& _key, const string& _default = "") const;
+	long long GetInt(const string& _key, long long _default) const;
+	bool GetBool(const string& _key, bool _default) const;
+
+	// Check whether a key is set
+	bool Has(const string& _key) const;
+
+};
+
+string EngineConfig::Trim(const string& _text)
+{
+	size_t first = _text.find_first_not_of(" \t\r");
+	if (first == string::npos) return "";
+	size_t last = _text.find_last_not_of(" \t\r");
+	return _text.substr(first, last - first + 1);
+}
+
+bool EngineConfig::Load(const string& _filename)
+{
+	ifstream file(_filename);
+	if (!file.is_open()) return false;
+
+	string line;
+	while (getline(file, line))
+	{
+		size_t comment = line.find('#');
+		if (comment != string::npos) line = line.substr(0, comment);
+
+		size_t equals = line.find('=');
+		if (equals == string::npos) continue;
+
+		string key = Trim(line.substr(0, equals));
+		if (!key.empty()) values[key] = Trim(line.substr(equals + 1));
+	}
+	return true;
+}
+
+string EngineConfig::Get(const string& _key, const string& _default) const
+{
+	auto it = values.find(_key);
+	return it != values.end() ? it->second : _default;
+}
+
+long long EngineConfig::GetInt(const string& _key, long long _default) const
+{
+	auto it = values.find(_key);
+	return it != values.end() && !it->second.empty() ? std::stoll(it->second) : _default;
+}
+
+bool EngineConfig::GetBool(const string& _key, bool _default) const
+{
+	auto it = values.find(_key);
+	if (it == values.end()) return _default;
+	return it->second == "true" || it->second == "on" || it->second == "1" || it->second == "yes";
+}
+
+bool EngineConfig::Has(const string& _key) const
+{
+	return values.find(_key) != values.end();
+}
+
+/**
+ * Queue of work posted to a pipeline by other threads.
+ * The pipeline thread drains it between the events it ingests, so everything a pipeline owns is
+ * only touched by its own thread.
+ */
+class Mailbox
+{
+
+private:
+
+	mutex lock;
+	condition_variable signal;
+	vector<function<void()>> tasks;
+	atomic<bool> has_tasks;
+
+public:
+
+	Mailbox();
+
+	// Queue a task for the owning thread
+	void Post(function<void()> _task);
+
+	// Run the queued tasks on the calling thread; false if there were none
+	bool Drain();
+
+	// Drain until _stop returns true; sleeps while there is nothing to do
+	void RunUntil(function<bool()> _stop);
+
+	// Wake a thread waiting in RunUntil so it re-checks its stop condition
+	void Wake();
+
+};
+
+Mailbox::Mailbox()
+{
+	has_tasks = false;
+}
+
+void Mailbox::Post(function<void()> _task)
+{
+	{
+		lock_guard<mutex> guard(lock);
+		tasks.push_back(std::move(_task));
+		has_tasks.store(true, memory_order_release);
+	}
+	signal.notify_one();
+}
+
+bool Mailbox::Drain()
+{
+	//cheap check first, this runs for every ingested event
+	if (!has_tasks.load(memory_order_acquire)) return false;
+
+	vector<function<void()>> batch;
+	{
+		lock_guard<mutex> guard(lock);
+		batch.swap(tasks);
+		has_tasks.store(false, memory_order_release);
+	}
+
+	for (auto& task : batch) task();
+	return !batch.empty();
+}
+
+void Mailbox::RunUntil(function<bool()> _stop)
+{
+	while (true)
+	{
+		Drain();
+
+		unique_lock<mutex> guard(lock);
+		if (tasks.empty() && _stop()) return;
+		signal.wait_for(guard, chrono::milliseconds(10), [this] { return !tasks.empty(); });
+	}
+}
+
+void Mailbox::Wake()
+{
+	{
+		lock_guard<mutex> guard(lock);
+	}
+	signal.notify_all();
+}
+
+/**
+ * Clock of a pipeline: delegates to the underlying clock and drains the pipeline mailbox every
+ * time the pipeline connector stamps an event, so updates from other pipelines are applied
+ * between events on the pipeline's own thread.
+ */
+class PipelineClock : public Clock
+{
+
+private:
+
+	Clock* clock;
+	Mailbox* mailbox;
+
+public:
+
+	PipelineClock(Clock* _clock, Mailbox* _mailbox);
+
+	Timestamp Now();
+
+	Timestamp Stamp(Timestamp _eventTime = NO_TIMESTAMP);
+
+};
+
+PipelineClock::PipelineClock(Clock* _clock, Mailbox* _mailbox) : Clock(_clock->GetTimerWheel())
+{
+	clock = _clock;
+	mailbox = _mailbox;
+}
+
+Timestamp PipelineClock::Now()
+{
+	return clock->Now();
+}
+
+Timestamp PipelineClock::Stamp(Timestamp _eventTime)
+{
+	mailbox->Drain();
+	return clock->Stamp(_eventTime);
+}
+
+/**
+ * Listener forwarding events to a listener owned by another pipeline: each event is copied and
+ * posted to the mailbox of that pipeline, which calls the target listener on its own thread.
+ * Type V is the data type of the events.
+ */
+template<typename V>
+class MailboxListener : public ServiceListener<V>
+{
+
+private:
+
+	ServiceListener<V>* target;
+	Mailbox* mailbox;
+
+public:
+
+	// Constructor; _target is called from the thread draining _mailbox
+	MailboxListener(ServiceListener<V>* _target, Mailbox* _mailbox);
+
+	// Listener callback to process an add event to the Service
+	void ProcessAdd(V& _data);
+
+	// Listener callback to process a remove event to the Service
+	void ProcessRemove(V& _data);
+
+	// Listener callback to process an update event to the Service
+	void ProcessUpdate(V& _data);
+
+};
+
+template<typename V>
+MailboxListener<V>::MailboxListener(ServiceListener<V>* _target, Mailbox* _mailbox)
+{
+	target = _target;
+	mailbox = _mailbox;
+}
+
+template<typename V>
+void MailboxListener<V>::ProcessAdd(V& _data)
+{
+	ServiceListener<V>* t = target;
+	mailbox->Post([t, _data]() mutable { t->ProcessAdd(_data); });
+}
+
+template<typename V>
+void MailboxListener<V>::ProcessRemove(V& _data)
+{
+	ServiceListener<V>* t = target;
+	mailbox->Post([t, _data]() mutable { t->ProcessRemove(_data); });
+}
+
+template<typename V>
+void MailboxListener<V>::ProcessUpdate(V& _data)
+{
+	ServiceListener<V>* t = target;
+	mailbox->Post([t, _data]() mutable { t->ProcessUpdate(_data); });
+}
+
+// Pin a thread to a core; negative cores leave the thread unpinned. False if pinning failed.
+bool pin_thread(std::thread& _thread, int _core)
+{
+	if (_core < 0) return true;
+#ifdef _WIN32
+	return SetThreadAffinityMask(_thread.native_handle(), 1ULL << _core) != 0;
+#elif defined(__linux__)
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(_core, &cpus);
+	return pthread_setaffinity_np(_thread.native_handle(), sizeof(cpu_set_t), &cpus) == 0;
+#else
+	return false;
+#endif
+}
+
+#endif
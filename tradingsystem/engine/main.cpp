@@ -0,0 +1,361 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "engine.hpp"
+#include "..\util.hpp"
+#include "..\products.hpp"
+#include "..\pricingservice\pricingservice.hpp"
+#include "..\streamingservice\streamingservice.hpp"
+#include "..\guiservice\guiservice.hpp"
+#include "..\marketdataservice\marketdataservice.hpp"
+#include "..\executionservice\executionservice.hpp"
+#include "..\pretraderiskservice\pretraderiskservice.hpp"
+#include "..\tradebookingservice\tradebookingservice.hpp"
+#include "..\tradebookingservice\positionservice.hpp"
+#include "..\tradebookingservice\riskservice.hpp"
+#include "..\inquiryservice\inquiryservice.hpp"
+#include "..\historicaldataservice\historicaldataservice.hpp"
+#include "..\filefollower.hpp"
+#ifndef _WIN32
+#include "..\marketdataservice\marketdatafeed.hpp"
+#endif
+
+/**
+ * A pipeline of the engine: the services fed by one input, run on one thread.
+ * Services of a pipeline are only touched by its thread; other pipelines reach them through
+ * its mailbox.
+ */
+struct Pipeline
+{
+	string name;
+	string input;
+	string connector; //"file", or the udp:// or tcp:// address of a binary feed
+	int core;
+	Pipeline* after; //pipeline whose input has to be consumed before this one starts
+	bool follow; //keep reading what is appended to the input until the engine is interrupted
+	TimerWheel timer_wheel;
+	Mailbox mailbox;
+	PipelineClock* clock;
+	function<void(ifstream&)> subscribe;
+	function<void(const string&)> on_line;
+	function<void()> receive; //takes the input from a feed instead of the file
+	atomic<bool> caught_up; //everything written to the input so far has been read
+	atomic<bool> input_done;
+};
+
+// Create a pipeline from the "<name>.*" keys of the configuration; nullptr if it is disabled
+// With _feed the connector may also be the udp://host:port or tcp://host:port address of a binary feed
+Pipeline* create_pipeline(const EngineConfig& _config, const string& _name, const string& _defaultInput, bool _feed = false)
+{
+	if (!_config.GetBool(_name + ".enabled", true)) return nullptr;
+
+	string connector = _config.Get(_name + ".connector", "file");
+	bool feed = false;
+#ifndef _WIN32
+	FeedTransport transport;
+	string host;
+	int port;
+	feed = _feed && parse_feed_address(connector, transport, host, port);
+#endif
+	if (connector != "file" && !feed)
+	{
+		std::cerr << "Unknown connector " << connector << " for pipeline " << _name << std::endl;
+		return nullptr;
+	}
+
+	Pipeline* pipeline = new Pipeline();
+	pipeline->name = _name;
+	pipeline->input = _config.Get(_name + ".input", _defaultInput);
+	pipeline->connector = connector;
+	pipeline->core = static_cast<int>(_config.GetInt(_name + ".core", -1));
+	pipeline->after = nullptr;
+	pipeline->follow = _config.GetBool(_name + ".follow", false);
+	pipeline->caught_up = false;
+	pipeline->input_done = false;
+
+	//replay runs every pipeline on time taken from its own input
+	Clock* clock;
+	if (_config.GetBool("replay", false)) clock = new ReplayClock(0, 1, &pipeline->timer_wheel);
+	else clock = new WallClock(&pipeline->timer_wheel);
+	pipeline->clock = new PipelineClock(clock, &pipeline->mailbox);
+
+	return pipeline;
+}
+
+// Get how the historical data journals are split into segments from the "journal.*" keys of the configuration
+JournalPolicy create_journal_policy(const EngineConfig& _config)
+{
+	JournalPolicy policy;
+	policy.segmentBytes = static_cast<uint64_t>(_config.GetInt("journal.segment_mb", 0)) << 20;
+	policy.segmentMillis = _config.GetInt("journal.segment_minutes", 0) * 60000;
+	policy.retainSegments = static_cast<int>(_config.GetInt("journal.retain", 0));
+	return policy;
+}
+
+// Get the journal policy of the services of a pipeline: segment ages are measured on the pipeline clock
+JournalPolicy pipeline_journal_policy(JournalPolicy _policy, Pipeline* _pipeline)
+{
+	_policy.clock = _pipeline->clock;
+	return _policy;
+}
+
+// Thread body of a pipeline: consume the input, then keep serving the mailbox until every input is consumed
+void run_pipeline(Pipeline* _pipeline, atomic<int>* _inputsRemaining, vector<Pipeline*>* _pipelines)
+{
+	if (_pipeline->after != nullptr)
+	{
+		Pipeline* after = _pipeline->after;
+		_pipeline->mailbox.RunUntil([after] { return after->caught_up.load(); });
+	}
+
+	if (_pipeline->receive)
+	{
+		_pipeline->receive();
+	}
+	else if (!_pipeline->input.empty() && _pipeline->follow && _pipeline->on_line)
+	{
+		//mail and timers are serviced between lines and while waiting for more
+		FileFollower follower(_pipeline->input);
+		follower.Follow(_pipeline->on_line, [_pipeline, &follower]
+			{
+				if (follower.IsAtEnd()) _pipeline->caught_up = true;
+				_pipeline->mailbox.Drain();
+				_pipeline->clock->AdvanceTimers();
+				return stop_requested();
+			});
+	}
+	else if (!_pipeline->input.empty() && _pipeline->subscribe)
+	{
+		std::ifstream file(_pipeline->input);
+		_pipeline->subscribe(file);
+	}
+
+	_pipeline->caught_up = true;
+	_pipeline->input_done = true;
+	(*_inputsRemaining)--;
+	for (auto& p : *_pipelines) p->mailbox.Wake();
+
+	_pipeline->mailbox.RunUntil([_inputsRemaining] { return _inputsRemaining->load() == 0; });
+}
+
+int main(int argc, char* argv[])
+{
+	std::string config_file = argc > 1 ? argv[1] : "engine.cfg";
+	EngineConfig config;
+	if (!config.Load(config_file))
+	{
+		std::cerr << "Failed to open config " << config_file << std::endl;
+		return 1;
+	}
+
+	//products come from a security master file when one is configured, before any service sizes its per product state
+	string securities = config.Get("securities");
+	if (!securities.empty() && !load_security_master(securities)) return 1;
+
+	//retention only applies to segments, so on its own it would silently keep everything
+	JournalPolicy journal_policy = create_journal_policy(config);
+	if (journal_policy.retainSegments > 0 && journal_policy.segmentBytes == 0 && journal_policy.segmentMillis == 0)
+	{
+		std::cerr << "journal.retain needs journal.segment_mb or journal.segment_minutes" << std::endl;
+		return 1;
+	}
+
+	Pipeline* pricing = create_pipeline(config, "pricing", "prices.txt");
+	Pipeline* market_data = create_pipeline(config, "marketdata", "marketdata.txt", true);
+	Pipeline* booking = create_pipeline(config, "booking", "trades.txt");
+	Pipeline* inquiry = create_pipeline(config, "inquiry", "inquiries.txt");
+
+	//fills from market data are booked, so market data needs the booking pipeline
+	if (market_data != nullptr && booking == nullptr)
+	{
+		std::cerr << "The marketdata pipeline needs the booking pipeline" << std::endl;
+		return 1;
+	}
+
+	//booking: trades from file and from fills, positions and risk shared by the other pipelines
+	TradeBookingService<Bond>* trade_booking_service = nullptr;
+	PositionService<Bond>* position_service = nullptr;
+	RiskService<Bond>* risk_service = nullptr;
+	if (booking != nullptr)
+	{
+		trade_booking_service = new TradeBookingService<Bond>(booking->clock);
+		position_service = new PositionService<Bond>();
+		trade_booking_service->AddListener(position_service->GetListener());
+		risk_service = new RiskService<Bond>();
+		position_service->AddListener(risk_service->GetListener());
+
+		HistoricalDataService<Position<Bond>>* historical_position_service = new HistoricalDataService<Position<Bond>>(PositionType, pipeline_journal_policy(journal_policy, booking));
+		position_service->AddListener(historical_position_service->GetListener());
+		HistoricalDataService<PV01<Bond>>* historical_risk_service = new HistoricalDataService<PV01<Bond>>(RiskType, pipeline_journal_policy(journal_policy, booking));
+		risk_service->AddListener(historical_risk_service->GetListener());
+
+		booking->subscribe = [trade_booking_service](ifstream& _file) { trade_booking_service->GetConnector()->Subscribe(_file); };
+		booking->on_line = [trade_booking_service](const string& _line) { trade_booking_service->GetConnector()->OnLine(_line); };
+	}
+
+	//pricing: streaming with inventory skew, GUI
+	PricingService<Bond>* pricing_service = nullptr;
+	StreamingService<Bond>* streaming_service = nullptr;
+	GUIService<Bond>* gui_service = nullptr;
+	if (pricing != nullptr)
+	{
+		pricing_service = new PricingService<Bond>(pricing->clock);
+		AlgoStreamingService<Bond>* algo_streaming_service = new AlgoStreamingService<Bond>();
+		pricing_service->AddListener(algo_streaming_service->GetListener());
+		streaming_service = new StreamingService<Bond>(config.GetInt("streaming.min_quote_life", 100), pricing->clock);
+		algo_streaming_service->AddListener(streaming_service->GetListener());
+
+		HistoricalDataService<PriceStream<Bond>>* historical_streaming_service = new HistoricalDataService<PriceStream<Bond>>(StreamingType, pipeline_journal_policy(journal_policy, pricing));
+		streaming_service->AddListener(historical_streaming_service->GetListener());
+
+		gui_service = new GUIService<Bond>(static_cast<int>(config.GetInt("gui.throttle", 300)), static_cast<int>(config.GetInt("gui.max_updates", 1000)), pricing->clock);
+		pricing_service->AddListener(gui_service->GetListener());
+
+		if (position_service != nullptr)
+		{
+			position_service->AddListener(new MailboxListener<Position<Bond>>(algo_streaming_service->GetPositionListener(), &pricing->mailbox));
+			risk_service->AddListener(new MailboxListener<PV01<Bond>>(algo_streaming_service->GetRiskListener(), &pricing->mailbox));
+		}
+
+		pricing->subscribe = [pricing_service](ifstream& _file) { pricing_service->GetConnector()->Subscribe(_file); };
+		pricing->on_line = [pricing_service](const string& _line) { pricing_service->GetConnector()->OnLine(_line); };
+	}
+
+	//market data: algo execution behind the pre-trade checks, fills booked by the booking pipeline
+	if (market_data != nullptr)
+	{
+		MarketDataService<Bond>* market_data_service = new MarketDataService<Bond>(static_cast<int>(config.GetInt("marketdata.depth", 5)), market_data->clock);
+		PreTradeRiskService<Bond>* pre_trade_risk_service = new PreTradeRiskService<Bond>(market_data->clock);
+		market_data_service->AddListener(pre_trade_risk_service->GetMarketDataListener());
+
+		AlgoExecutionService<Bond>* algo_execution_service = new AlgoExecutionService<Bond>(&market_data->timer_wheel);
+		market_data_service->AddListener(algo_execution_service->GetListener());
+
+		//TWAP, VWAP and POV parent orders worked alongside the aggressor strategy
+		string parents = config.Get("marketdata.parents");
+		if (!parents.empty())
+		{
+			ifstream parents_file(parents);
+			ParentOrderConnector<Bond>(algo_execution_service, market_data->clock).Subscribe(parents_file);
+		}
+		algo_execution_service->AddListener(pre_trade_risk_service->GetAlgoExecutionListener());
+
+		ExecutionService<Bond>* execution_service = new ExecutionService<Bond>();
+		pre_trade_risk_service->AddListener(execution_service->GetListener());
+
+		HistoricalDataService<ExecutionOrder<Bond>>* historical_execution_service = new HistoricalDataService<ExecutionOrder<Bond>>(ExecutionType, pipeline_journal_policy(journal_policy, market_data));
+		execution_service->AddListener(historical_execution_service->GetListener());
+		HistoricalDataService<RejectedOrder<Bond>>* historical_rejection_service = new HistoricalDataService<RejectedOrder<Bond>>(RejectionType, pipeline_journal_policy(journal_policy, market_data));
+		pre_trade_risk_service->AddRejectListener(historical_rejection_service->GetListener());
+
+		execution_service->AddFillListener(new MailboxListener<ExecutionFill<Bond>>(trade_booking_service->GetListener(), &booking->mailbox));
+		position_service->AddListener(new MailboxListener<Position<Bond>>(pre_trade_risk_service->GetPositionListener(), &market_data->mailbox));
+		risk_service->AddListener(new MailboxListener<PV01<Bond>>(pre_trade_risk_service->GetRiskListener(), &market_data->mailbox));
+
+		market_data->subscribe = [market_data_service](ifstream& _file) { market_data_service->GetConnector()->Subscribe(_file); };
+		market_data->on_line = [market_data_service](const string& _line) { market_data_service->GetConnector()->OnLine(_line); };
+
+#ifndef _WIN32
+		//books from a binary feed until it ends, the engine is interrupted or the feed is idle for marketdata.feed_timeout ms
+		if (market_data->connector != "file")
+		{
+			FeedTransport transport;
+			string host;
+			int port;
+			parse_feed_address(market_data->connector, transport, host, port);
+			MarketDataFeedConnector<Bond>* feed_connector = new MarketDataFeedConnector<Bond>(market_data_service, transport, host, port);
+			feed_connector->SetBusyPoll(config.GetBool("marketdata.busy_poll", false));
+			long feed_timeout = static_cast<long>(config.GetInt("marketdata.feed_timeout", FEED_IDLE_TIMEOUT_MS));
+
+			Pipeline* pipeline = market_data;
+			market_data->receive = [pipeline, feed_connector, feed_timeout]
+			{
+				if (!feed_connector->Open())
+				{
+					std::cerr << "Failed to open feed " << pipeline->connector << std::endl;
+					return;
+				}
+				//mail and timers are serviced between receives
+				feed_connector->Run([pipeline]
+					{
+						pipeline->mailbox.Drain();
+						pipeline->clock->AdvanceTimers();
+						return stop_requested();
+					}, feed_timeout);
+				if (!feed_connector->IsEnded()) std::cerr << "Feed " << pipeline->connector << " stopped before its end of stream" << std::endl;
+				std::cout << "Books " << feed_connector->GetBookCount() << ", gaps " << feed_connector->GetGapCount() << " (" << feed_connector->GetLostCount() << " books lost), duplicates " << feed_connector->GetDuplicateCount() << ", malformed " << feed_connector->GetMalformedCount() << std::endl;
+			};
+		}
+#endif
+	}
+
+	//inquiries: quoted from the pricing pipeline prices and the booking pipeline positions
+	if (inquiry != nullptr)
+	{
+		InquiryService<Bond>* inquiry_service = new InquiryService<Bond>(config.GetInt("inquiry.timeout", 30000), inquiry->clock);
+		HistoricalDataService<Inquiry<Bond>>* historical_inquiry_service = new HistoricalDataService<Inquiry<Bond>>(InquiryType, pipeline_journal_policy(journal_policy, inquiry));
+		inquiry_service->AddListener(historical_inquiry_service->GetListener());
+
+		if (pricing_service != nullptr)
+		{
+			pricing_service->AddListener(new MailboxListener<Price<Bond>>(inquiry_service->GetPricingListener(), &inquiry->mailbox));
+		}
+		if (position_service != nullptr)
+		{
+			position_service->AddListener(new MailboxListener<Position<Bond>>(inquiry_service->GetPositionListener(), &inquiry->mailbox));
+		}
+
+		inquiry->subscribe = [inquiry_service](ifstream& _file) { inquiry_service->GetConnector()->Subscribe(_file); };
+		inquiry->on_line = [inquiry_service](const string& _line) { inquiry_service->GetConnector()->OnLine(_line); };
+	}
+
+	vector<Pipeline*> pipelines;
+	for (Pipeline* p : { pricing, market_data, booking, inquiry })
+	{
+		if (p != nullptr) pipelines.push_back(p);
+	}
+
+	//"<name>.after = <other>" holds a pipeline back until another has consumed its input
+	for (Pipeline* p : pipelines)
+	{
+		string after = config.Get(p->name + ".after");
+		for (Pipeline* q : pipelines)
+		{
+			if (q != p && q->name == after) p->after = q;
+		}
+	}
+
+	//pipelines following their input or receiving a feed run until the engine is interrupted
+	for (Pipeline* p : pipelines)
+	{
+		if (p->follow || p->receive) install_stop_handler();
+	}
+
+	//run every pipeline on its own thread, pinned to its core if one is configured
+	atomic<int> inputs_remaining(static_cast<int>(pipelines.size()));
+	vector<std::thread> threads;
+	for (Pipeline* p : pipelines)
+	{
+		threads.emplace_back(run_pipeline, p, &inputs_remaining, &pipelines);
+		if (!pin_thread(threads.back(), p->core))
+		{
+			std::cerr << "Could not pin pipeline " << p->name << " to core " << p->core << std::endl;
+		}
+	}
+	for (auto& t : threads) t.join();
+
+	//all threads are done: deliver what is left in the mailboxes from here
+	bool drained = true;
+	while (drained)
+	{
+		drained = false;
+		for (Pipeline* p : pipelines) drained = p->mailbox.Drain() || drained;
+	}
+
+	if (streaming_service != nullptr) streaming_service->Flush();
+	if (gui_service != nullptr) gui_service->Flush();
+
+	return 0;
+}
@@ -12,8 +12,12 @@
 #include <iostream>
 #include <random>
 #include <set>
+#include <algorithm>
+#include <cstdlib>
 
 #include "..\soa.hpp"
+#include "..\slottable.hpp"
+#include "..\shmtransport.hpp"
 #include "..\marketdataservice\marketdataservice.hpp"
 #include "..\util.hpp"
 
@@ -21,6 +25,9 @@ enum OrderType { FOK, IOC, MARKET, LIMIT, STOP };
 
 enum Market { BROKERTEC, ESPEED, CME };
 
+// Lifecycle states of an order sent to a market
+enum OrderState { ORDER_NEW, ORDER_PARTIALLY_FILLED, ORDER_FILLED, ORDER_CANCELLED, ORDER_REJECTED };
+
 /**
  * An execution order that can be placed on an exchange.
  * Type T is the product type.
@@ -64,14 +71,26 @@ public:
   // Is child order?
   bool IsChildOrder() const;
 
+  // Get the event time of the order
+  Timestamp GetTimestamp() const;
+
+  // Set the event time of the order
+  void SetTimestamp(Timestamp _timestamp);
+
   //key used to persist data in historical data service
   string GetPersistKey() const;
 
   //data persisted in historical data service
   string GetPersistData() const;
 
+  //numeric columns persisted in historical data service
+  static vector<string> GetPersistColumns();
+
+  //values of the persisted columns, in the order of GetPersistColumns
+  void GetPersistValues(double* _values) const;
+
 private:
-  T product;
+  ProductRef<T> product;
   PricingSide side;
   string orderId;
   OrderType orderType;
@@ -80,6 +99,7 @@ private:
   double hiddenQuantity;
   string parentOrderId;
   bool isChildOrder;
+  Timestamp timestamp = NO_TIMESTAMP;
 
 };
 
@@ -100,7 +120,7 @@ ExecutionOrder<T>::ExecutionOrder(const T& _product, PricingSide _side, string _
 template<typename T>
 const T& ExecutionOrder<T>::GetProduct() const
 {
-	return product;
+	return product.Get();
 }
 
 template<typename T>
@@ -151,6 +171,18 @@ bool ExecutionOrder<T>::IsChildOrder() const
 	return isChildOrder;
 }
 
+template<typename T>
+Timestamp ExecutionOrder<T>::GetTimestamp() const
+{
+	return timestamp;
+}
+
+template<typename T>
+void ExecutionOrder<T>::SetTimestamp(Timestamp _timestamp)
+{
+	timestamp = _timestamp;
+}
+
 //key used to persist data in historical data service
 template<typename T>
 string ExecutionOrder<T>::GetPersistKey() const
@@ -162,8 +194,7 @@ string ExecutionOrder<T>::GetPersistKey() const
 template<typename T>
 string ExecutionOrder<T>::GetPersistData() const
 {
-	auto now = std::chrono::system_clock::now();
-	string s = timeToString(now) + " , " + this->GetPersistKey() + " , ";
+	string s = timeToString(timestamp) + " , " + this->GetPersistKey() + " , ";
 
 	string _side = side == BID ? "BID" : "OFFER";
 	s += "Side:" + _side  + " , ";
@@ -173,6 +204,228 @@ string ExecutionOrder<T>::GetPersistData() const
 	return s;
 }
 
+template<typename T>
+vector<string> ExecutionOrder<T>::GetPersistColumns()
+{
+	return { "side", "price", "visibleQuantity", "hiddenQuantity" };
+}
+
+template<typename T>
+void ExecutionOrder<T>::GetPersistValues(double* _values) const
+{
+	_values[0] = side;
+	_values[1] = price;
+	_values[2] = visibleQuantity;
+	_values[3] = hiddenQuantity;
+}
+
+
+/**
+ * A fill received against an execution order.
+ * Type T is the product type.
+ */
+template<typename T>
+class ExecutionFill
+{
+
+public:
+
+  // ctor for a fill
+  ExecutionFill(const T &_product, string _orderId, int _fillNumber, PricingSide _side, double _price, long _quantity, long _leavesQuantity, OrderState _orderState, Timestamp _timestamp);
+
+  //default ctor
+  ExecutionFill() = default;
+
+  // Get the product
+  const T& GetProduct() const;
+
+  // Get the ID of the order that was filled
+  const string& GetOrderId() const;
+
+  // Get the unique ID of this fill, made of the order ID and fill number
+  string GetFillId() const;
+
+  // Get the number of this fill on its order, from 1
+  int GetFillNumber() const;
+
+  //Get the pricing side of the filled order
+  PricingSide GetPricingSide() const;
+
+  // Get the fill price
+  double GetPrice() const;
+
+  // Get the filled quantity
+  long GetQuantity() const;
+
+  // Get the quantity still open on the order after this fill
+  long GetLeavesQuantity() const;
+
+  // Get the state of the order after this fill
+  OrderState GetOrderState() const;
+
+  // Get the event time of the fill
+  Timestamp GetTimestamp() const;
+
+private:
+  ProductRef<T> product;
+  string orderId;
+  int fillNumber;
+  PricingSide side;
+  double price;
+  long quantity;
+  long leavesQuantity;
+  OrderState orderState;
+  Timestamp timestamp = NO_TIMESTAMP;
+
+};
+
+template<typename T>
+ExecutionFill<T>::ExecutionFill(const T& _product, string _orderId, int _fillNumber, PricingSide _side, double _price, long _quantity, long _leavesQuantity, OrderState _orderState, Timestamp _timestamp) :
+	product(_product)
+{
+	orderId = _orderId;
+	fillNumber = _fillNumber;
+	side = _side;
+	price = _price;
+	quantity = _quantity;
+	leavesQuantity = _leavesQuantity;
+	orderState = _orderState;
+	timestamp = _timestamp;
+}
+
+template<typename T>
+const T& ExecutionFill<T>::GetProduct() const
+{
+	return product.Get();
+}
+
+template<typename T>
+const string& ExecutionFill<T>::GetOrderId() const
+{
+	return orderId;
+}
+
+template<typename T>
+string ExecutionFill<T>::GetFillId() const
+{
+	return orderId + "-" + std::to_string(fillNumber);
+}
+
+template<typename T>
+int ExecutionFill<T>::GetFillNumber() const
+{
+	return fillNumber;
+}
+
+template<typename T>
+PricingSide ExecutionFill<T>::GetPricingSide() const
+{
+	return side;
+}
+
+template<typename T>
+double ExecutionFill<T>::GetPrice() const
+{
+	return price;
+}
+
+template<typename T>
+long ExecutionFill<T>::GetQuantity() const
+{
+	return quantity;
+}
+
+template<typename T>
+long ExecutionFill<T>::GetLeavesQuantity() const
+{
+	return leavesQuantity;
+}
+
+template<typename T>
+OrderState ExecutionFill<T>::GetOrderState() const
+{
+	return orderState;
+}
+
+template<typename T>
+Timestamp ExecutionFill<T>::GetTimestamp() const
+{
+	return timestamp;
+}
+
+// Shared memory segment the market data process publishes its fills on
+const string FILLS_SHM_NAME = "/tradingsystem.fills";
+
+// How long a fill subscriber waits without any fill before assuming the publisher died
+const long FILLS_IDLE_TIMEOUT_MS = 30000;
+
+/**
+ * Fixed size encoding of fills sent to other processes over shared memory.
+ * The product travels as its ticker; order IDs longer than the field are truncated.
+ * Type T is the product type.
+ */
+template<typename T>
+struct ShmCodec<ExecutionFill<T>>
+{
+	struct Message
+	{
+		char ticker[SECURITY_TICKER_LENGTH];
+		char orderId[32];
+		int32_t fillNumber;
+		int32_t side;
+		double price;
+		int64_t quantity;
+		int64_t leavesQuantity;
+		int32_t orderState;
+		int64_t timestamp;
+	};
+
+	static const size_t SIZE = sizeof(Message);
+
+	static void Encode(const ExecutionFill<T>& _data, char* _buffer);
+
+	static ExecutionFill<T> Decode(const char* _buffer);
+};
+
+template<typename T>
+void ShmCodec<ExecutionFill<T>>::Encode(const ExecutionFill<T>& _data, char* _buffer)
+{
+	Message message;
+	memset(&message, 0, sizeof(message));
+	strncpy(message.ticker, _data.GetProduct().GetTicker().c_str(), sizeof(message.ticker) - 1);
+	strncpy(message.orderId, _data.GetOrderId().c_str(), sizeof(message.orderId) - 1);
+	message.fillNumber = _data.GetFillNumber();
+	message.side = _data.GetPricingSide();
+	message.price = _data.GetPrice();
+	message.quantity = _data.GetQuantity();
+	message.leavesQuantity = _data.GetLeavesQuantity();
+	message.orderState = _data.GetOrderState();
+	message.timestamp = _data.GetTimestamp();
+	memcpy(_buffer, &message, sizeof(message));
+}
+
+template<typename T>
+ExecutionFill<T> ShmCodec<ExecutionFill<T>>::Decode(const char* _buffer)
+{
+	Message message;
+	memcpy(&message, _buffer, sizeof(message));
+	const T& product = get_product<T>(message.ticker);
+	return ExecutionFill<T>(product, string(message.orderId), message.fillNumber, static_cast<PricingSide>(message.side), message.price, static_cast<long>(message.quantity), static_cast<long>(message.leavesQuantity), static_cast<OrderState>(message.orderState), message.timestamp);
+}
+
+/**
+ * Entry of the execution service order table: the order as sent plus its execution progress.
+ * Type T is the product type.
+ */
+template<typename T>
+struct OrderRecord
+{
+	ExecutionOrder<T> order;
+	Market market;
+	OrderState state;
+	long filledQuantity;
+	int fillCount;
+};
 
 /**
 * AlgoExecution
@@ -248,15 +501,66 @@ public:
 	}
 };
 
+// Parent order algorithms that slice a parent order into child orders
+enum AlgoType { TWAP, VWAP, POV };
+
+/**
+ * A parent order worked by an algo over time through child orders.
+ * TWAP and VWAP parents send one child per slice on a schedule, POV parents send
+ * children in proportion to the volume traded in the market, as seen on book updates.
+ * Whatever is still unsent at the end time expires.
+ * Type T is the product type.
+ */
+template<typename T>
+struct ParentOrder
+{
+	ProductRef<T> product;
+	string parentOrderId;
+	AlgoType algoType;
+	PricingSide side;
+	long totalQuantity;
+	long sentQuantity;
+	long long startTime;
+	long long endTime;
+	int slices; //number of slices for TWAP/VWAP
+	int nextSlice;
+	int profile; //volume profile index for VWAP
+	double participation; //participation rate for POV
+	long marketVolume; //volume traded in the market since a POV parent started
+	int childCount;
+	TimerHandle timer; //pending slice or end timer
+};
+
+// Estimate the volume traded between two snapshots of the top of book: what was taken from a level
+// that is still the best, or the whole level once the price has moved through it
+inline long traded_volume(const BidOffer& _before, const Order& _bid, const Order& _offer)
+{
+	long traded = 0;
+	const Order& bid = _before.GetBidOrder();
+	if (_bid.GetPrice() == bid.GetPrice()) traded += std::max(bid.GetQuantity() - _bid.GetQuantity(), 0L);
+	else if (_bid.GetPrice() < bid.GetPrice()) traded += bid.GetQuantity();
+
+	const Order& offer = _before.GetOfferOrder();
+	if (_offer.GetPrice() == offer.GetPrice()) traded += std::max(offer.GetQuantity() - _offer.GetQuantity(), 0L);
+	else if (_offer.GetPrice() > offer.GetPrice()) traded += offer.GetQuantity();
+	return traded;
+}
+
 /**
 * Pre-declearations to avoid errors.
 */
 template<typename T>
 class AlgoExecutionToMarketDataListener;
 
+template<typename T>
+class AlgoExecutionTimerListener;
+
 /**
 * Service for algo executing orders on an exchange.
 * Keyed on product identifier.
+* Besides the top of book aggressor strategy, the service works TWAP, VWAP and POV parent
+* orders. Parent orders live in a slot table; TWAP/VWAP slices are driven by the timer wheel
+* the service is given (the process wide one by default), POV children by order book updates.
 * Type T is the product type.
 */
 template<typename T>
@@ -272,10 +576,34 @@ private:
 	double tightest_spread;
 	bool bid_side; //indicator that we are on the bid side
 
+	SlotTable<ParentOrder<T>> parent_orders;
+	TimerWheel* timer_wheel;
+	AlgoExecutionTimerListener<T>* timer_listener;
+	map<string, BidOffer> top_of_book; //latest top of book per product
+	map<string, vector<SlotHandle>> pov_orders; //active POV parents per product
+	vector<vector<double>> volume_profiles; //cumulative VWAP volume profiles
+	long parent_count;
+	long expired_quantity; //unsent quantity of the parents that reached their end time
+
+	// Register a parent order and schedule its first slice
+	SlotHandle AddParentOrder(const ParentOrder<T>& _parent);
+
+	// Send a child order of the parent at the current top of book; false if there is no book yet
+	bool SendChildOrder(ParentOrder<T>& _parent, long _quantity, Timestamp _time);
+
+	// Remove a parent order from the service
+	void CompleteParentOrder(SlotHandle _handle);
+
+	// Remove a parent order at its end time, reporting its unsent quantity
+	void ExpireParentOrder(SlotHandle _handle);
+
+	// Send POV children for a product on the volume traded since its last book update
+	void ParticipateInVolume(const string& _productId, long _tradedVolume, Timestamp _time);
+
 public:
 
 	// Constructor and destructor
-	AlgoExecutionService();
+	AlgoExecutionService(TimerWheel* _timerWheel = &SharedTimerWheel(), size_t _expectedParents = 1024);
 	~AlgoExecutionService();
 
 	// Get data on our service given a key
@@ -296,10 +624,44 @@ public:
 	// Execute an order on a market
 	void AlgoExecuteOrder(OrderBook<T>& _orderBook);
 
+	// Work _quantity evenly over [_startTime, _endTime) in _slices child orders
+	SlotHandle SubmitTWAP(const T& _product, PricingSide _side, long _quantity, long long _startTime, long long _endTime, int _slices);
+
+	// Register a volume profile (relative volume per time bucket) for VWAP orders and get its index
+	int AddVolumeProfile(const vector<double>& _weights);
+
+	// Work _quantity over [_startTime, _endTime) following a registered volume profile, one child per bucket
+	SlotHandle SubmitVWAP(const T& _product, PricingSide _side, long _quantity, long long _startTime, long long _endTime, int _profile);
+
+	// Work _quantity as a fraction _participation of the volume traded in the market over [_startTime, _endTime)
+	SlotHandle SubmitPOV(const T& _product, PricingSide _side, long _quantity, double _participation, long long _startTime, long long _endTime);
+
+	// Cancel the unsent quantity of a parent order; false if the parent is no longer active
+	bool CancelParentOrder(SlotHandle _handle);
+
+	// Get an active parent order, nullptr once it is complete or cancelled
+	const ParentOrder<T>* GetParentOrder(SlotHandle _handle) const;
+
+	// Get the number of active parent orders
+	size_t GetActiveParentCount() const;
+
+	// Get the total quantity left unsent by parent orders that reached their end time
+	long GetExpiredQuantity() const;
+
+	// Advance the algo clock, sending every child order that has come due
+	void AdvanceTime(long long _now);
+
+	// Get the current algo clock time
+	long long GetTime() const;
+
+	// Timer callback: send the next slice of a parent order
+	void ProcessSlice(SlotHandle _handle, long long _now);
+
 };
 
 template<typename T>
-AlgoExecutionService<T>::AlgoExecutionService()
+AlgoExecutionService<T>::AlgoExecutionService(TimerWheel* _timerWheel, size_t _expectedParents) :
+	parent_orders(_expectedParents)
 {
 	algo_executions = map<string, AlgoExecution<T>>();
 	listeners = vector<ServiceListener<AlgoExecution<T>>*>();
@@ -307,6 +669,14 @@ AlgoExecutionService<T>::AlgoExecutionService()
 	order_id_gen = new OrderIDGenerator(8);
 	tightest_spread = 1.0 / 128.0;
 	bid_side = true;
+
+	timer_wheel = _timerWheel;
+	timer_listener = new AlgoExecutionTimerListener<T>(this);
+	top_of_book = map<string, BidOffer>();
+	pov_orders = map<string, vector<SlotHandle>>();
+	volume_profiles = vector<vector<double>>();
+	parent_count = 0;
+	expired_quantity = 0;
 }
 
 template<typename T>
@@ -345,9 +715,8 @@ AlgoExecutionToMarketDataListener<T>* AlgoExecutionService<T>::GetListener()
 template<typename T>
 void AlgoExecutionService<T>::AlgoExecuteOrder(OrderBook<T>& _orderBook)
 {
-	T product = _orderBook.GetProduct();
+	const T& product = _orderBook.GetProduct();
 	string product_id = product.GetProductId();
-	string order_id = order_id_gen->generateUniqueID();
 	double price;
 	long qty;
 	PricingSide side;
@@ -359,6 +728,12 @@ void AlgoExecutionService<T>::AlgoExecuteOrder(OrderBook<T>& _orderBook)
 	Order offer_order = _orderBook.GetOfferStack()[0];
 	double offer = offer_order.GetPrice();
 
+	//keep the top of book for parent order slices and work POV parents on the volume traded since the last book
+	auto previous = top_of_book.find(product_id);
+	long traded = previous != top_of_book.end() ? traded_volume(previous->second, bid_order, offer_order) : 0;
+	top_of_book[product_id] = BidOffer(bid_order, offer_order);
+	ParticipateInVolume(product_id, traded, _orderBook.GetTimestamp());
+
 	if (offer - bid <= tightest_spread)
 	{
 		if (bid_side)
@@ -375,7 +750,9 @@ void AlgoExecutionService<T>::AlgoExecuteOrder(OrderBook<T>& _orderBook)
 		}
 		bid_side =!bid_side;
 
+		string order_id = order_id_gen->generateUniqueID();
 		AlgoExecution<T> algo_execution(product, side, order_id, MARKET, price, qty, 0, "", false);
+		algo_execution.GetExecutionOrder()->SetTimestamp(_orderBook.GetTimestamp());
 		algo_executions[product_id] = algo_execution;
 
 		for (auto& l : listeners)
@@ -385,6 +762,286 @@ void AlgoExecutionService<T>::AlgoExecuteOrder(OrderBook<T>& _orderBook)
 	}
 }
 
+template<typename T>
+SlotHandle AlgoExecutionService<T>::SubmitTWAP(const T& _product, PricingSide _side, long _quantity, long long _startTime, long long _endTime, int _slices)
+{
+	ParentOrder<T> parent{ _product, "", TWAP, _side, _quantity, 0, _startTime, _endTime, std::max(_slices, 1), 0, -1, 0.0, 0, 0, INVALID_TIMER_HANDLE };
+	return AddParentOrder(parent);
+}
+
+template<typename T>
+int AlgoExecutionService<T>::AddVolumeProfile(const vector<double>& _weights)
+{
+	double total = 0;
+	for (double w : _weights) total += w;
+
+	//store the profile as cumulative fractions of the parent quantity
+	vector<double> cumulative;
+	double running = 0;
+	for (double w : _weights)
+	{
+		running += w;
+		cumulative.push_back(total > 0 ? running / total : 1.0);
+	}
+	if (!cumulative.empty()) cumulative.back() = 1.0;
+
+	volume_profiles.push_back(cumulative);
+	return static_cast<int>(volume_profiles.size()) - 1;
+}
+
+template<typename T>
+SlotHandle AlgoExecutionService<T>::SubmitVWAP(const T& _product, PricingSide _side, long _quantity, long long _startTime, long long _endTime, int _profile)
+{
+	if (_profile < 0 || _profile >= static_cast<int>(volume_profiles.size()) || volume_profiles[_profile].empty())
+	{
+		std::cerr << "Unknown volume profile " << _profile << std::endl;
+		return INVALID_SLOT_HANDLE;
+	}
+
+	int buckets = static_cast<int>(volume_profiles[_profile].size());
+	ParentOrder<T> parent{ _product, "", VWAP, _side, _quantity, 0, _startTime, _endTime, buckets, 0, _profile, 0.0, 0, 0, INVALID_TIMER_HANDLE };
+	return AddParentOrder(parent);
+}
+
+template<typename T>
+SlotHandle AlgoExecutionService<T>::SubmitPOV(const T& _product, PricingSide _side, long _quantity, double _participation, long long _startTime, long long _endTime)
+{
+	ParentOrder<T> parent{ _product, "", POV, _side, _quantity, 0, _startTime, _endTime, 1, 0, -1, _participation, 0, 0, INVALID_TIMER_HANDLE };
+	return AddParentOrder(parent);
+}
+
+template<typename T>
+SlotHandle AlgoExecutionService<T>::AddParentOrder(const ParentOrder<T>& _parent)
+{
+	if (_parent.totalQuantity <= 0) return INVALID_SLOT_HANDLE;
+
+	SlotHandle handle = parent_orders.Allocate(_parent);
+	ParentOrder<T>* parent = parent_orders.Get(handle);
+
+	//parent ids are sequential so replays produce the same child order ids
+	parent_count++;
+	parent->parentOrderId = "ALGO" + std::to_string(parent_count);
+
+	if (parent->algoType == POV)
+	{	//POV children follow book updates, the timer only ends the order
+		pov_orders[parent->product.Get().GetProductId()].push_back(handle);
+		parent->timer = timer_wheel->Schedule(parent->endTime, timer_listener, handle);
+	}
+	else
+	{
+		parent->timer = timer_wheel->Schedule(parent->startTime, timer_listener, handle);
+	}
+
+	return handle;
+}
+
+template<typename T>
+void AlgoExecutionService<T>::ProcessSlice(SlotHandle _handle, long long _now)
+{
+	ParentOrder<T>* parent = parent_orders.Get(_handle);
+	if (parent == nullptr) return; //parent already complete or cancelled
+	parent->timer = INVALID_TIMER_HANDLE;
+
+	if (parent->algoType == POV)
+	{	//end time reached
+		ExpireParentOrder(_handle);
+		return;
+	}
+
+	//cumulative quantity that should have been sent once this slice goes out
+	int slice = std::min(parent->nextSlice, parent->slices - 1);
+	long target;
+	if (parent->algoType == TWAP)
+	{
+		target = static_cast<long>((static_cast<double>(parent->totalQuantity) * (slice + 1)) / parent->slices);
+	}
+	else
+	{
+		target = static_cast<long>(parent->totalQuantity * volume_profiles[parent->profile][slice]);
+	}
+	if (slice == parent->slices - 1) target = parent->totalQuantity;
+
+	//a slice missed for lack of a book rolls into the next one
+	long child_qty = target - parent->sentQuantity;
+	if (child_qty > 0) SendChildOrder(*parent, child_qty, _now);
+
+	if (parent->sentQuantity >= parent->totalQuantity)
+	{
+		CompleteParentOrder(_handle);
+		return;
+	}
+	if (_now >= parent->endTime)
+	{	//no book to send the rest to before the end time
+		ExpireParentOrder(_handle);
+		return;
+	}
+
+	//after the last slice the rest is tried once more at the end time
+	parent->nextSlice++;
+	long long interval = std::max((parent->endTime - parent->startTime) / parent->slices, 1LL);
+	long long next_time = parent->nextSlice < parent->slices ? parent->startTime + parent->nextSlice * interval : parent->endTime;
+	parent->timer = timer_wheel->Schedule(std::max(next_time, _now + 1), timer_listener, _handle);
+}
+
+template<typename T>
+void AlgoExecutionService<T>::ParticipateInVolume(const string& _productId, long _tradedVolume, Timestamp _time)
+{
+	auto it = pov_orders.find(_productId);
+	if (it == pov_orders.end() || it->second.empty() || _tradedVolume <= 0) return;
+
+	//copy the handles, completing a parent edits the per product list
+	vector<SlotHandle> handles(it->second);
+	for (SlotHandle handle : handles)
+	{
+		ParentOrder<T>* parent = parent_orders.Get(handle);
+		if (parent == nullptr || _time < parent->startTime) continue;
+
+		//each child covers the volume traded since the last one, rounding carried over to the next
+		parent->marketVolume += _tradedVolume;
+		long target = std::min(static_cast<long>(parent->marketVolume * parent->participation), parent->totalQuantity);
+		long child_qty = target - parent->sentQuantity;
+
+		if (child_qty > 0) SendChildOrder(*parent, child_qty, _time);
+		if (parent->sentQuantity >= parent->totalQuantity) CompleteParentOrder(handle);
+	}
+}
+
+template<typename T>
+bool AlgoExecutionService<T>::SendChildOrder(ParentOrder<T>& _parent, long _quantity, Timestamp _time)
+{
+	string product_id = _parent.product.Get().GetProductId();
+	auto book = top_of_book.find(product_id);
+	if (book == top_of_book.end()) return false;
+
+	//children cross the spread: a buying (BID) child takes the offer and a selling (OFFER) child hits the bid
+	double price = _parent.side == BID ? book->second.GetOfferOrder().GetPrice() : book->second.GetBidOrder().GetPrice();
+	_parent.childCount++;
+	_parent.sentQuantity += _quantity;
+	string order_id = _parent.parentOrderId + "-" + std::to_string(_parent.childCount);
+
+	AlgoExecution<T> algo_execution(_parent.product.Get(), _parent.side, order_id, MARKET, price, _quantity, 0, _parent.parentOrderId, true);
+	algo_execution.GetExecutionOrder()->SetTimestamp(_time);
+	algo_executions[product_id] = algo_execution;
+
+	for (auto& l : listeners)
+	{
+		l->ProcessAdd(algo_execution);
+	}
+	return true;
+}
+
+template<typename T>
+void AlgoExecutionService<T>::CompleteParentOrder(SlotHandle _handle)
+{
+	ParentOrder<T>* parent = parent_orders.Get(_handle);
+	if (parent == nullptr) return;
+
+	if (parent->algoType == POV)
+	{
+		vector<SlotHandle>& handles = pov_orders[parent->product.Get().GetProductId()];
+		for (size_t i = 0; i < handles.size(); i++)
+		{
+			if (handles[i] == _handle)
+			{
+				handles[i] = handles.back();
+				handles.pop_back();
+				break;
+			}
+		}
+	}
+
+	if (parent->timer != INVALID_TIMER_HANDLE) timer_wheel->Cancel(parent->timer);
+	parent_orders.Release(_handle);
+}
+
+template<typename T>
+void AlgoExecutionService<T>::ExpireParentOrder(SlotHandle _handle)
+{
+	ParentOrder<T>* parent = parent_orders.Get(_handle);
+	if (parent == nullptr) return;
+
+	long unsent = parent->totalQuantity - parent->sentQuantity;
+	if (unsent > 0)
+	{
+		expired_quantity += unsent;
+		std::cerr << "Parent order " << parent->parentOrderId << " expired with " << unsent << " of " << parent->totalQuantity << " unsent" << std::endl;
+	}
+	CompleteParentOrder(_handle);
+}
+
+template<typename T>
+bool AlgoExecutionService<T>::CancelParentOrder(SlotHandle _handle)
+{
+	if (!parent_orders.IsLive(_handle)) return false;
+
+	CompleteParentOrder(_handle);
+	return true;
+}
+
+template<typename T>
+const ParentOrder<T>* AlgoExecutionService<T>::GetParentOrder(SlotHandle _handle) const
+{
+	return parent_orders.Get(_handle);
+}
+
+template<typename T>
+size_t AlgoExecutionService<T>::GetActiveParentCount() const
+{
+	return parent_orders.Size();
+}
+
+template<typename T>
+long AlgoExecutionService<T>::GetExpiredQuantity() const
+{
+	return expired_quantity;
+}
+
+template<typename T>
+void AlgoExecutionService<T>::AdvanceTime(long long _now)
+{
+	timer_wheel->Advance(_now);
+}
+
+template<typename T>
+long long AlgoExecutionService<T>::GetTime() const
+{
+	return timer_wheel->Now();
+}
+
+/**
+* AlgoExecutionTimerListener receives parent order slice timers for AlgoExecutionService.
+* Type T is the product type.
+*/
+template<typename T>
+class AlgoExecutionTimerListener : public TimerListener
+{
+
+private:
+
+	AlgoExecutionService<T>* service;
+
+public:
+
+	// Constructor
+	AlgoExecutionTimerListener(AlgoExecutionService<T>* _service);
+
+	// Timer callback, the context is the parent order handle
+	void ProcessTimer(uint64_t _context, long long _now);
+
+};
+
+template<typename T>
+AlgoExecutionTimerListener<T>::AlgoExecutionTimerListener(AlgoExecutionService<T>* _service)
+{
+	service = _service;
+}
+
+template<typename T>
+void AlgoExecutionTimerListener<T>::ProcessTimer(uint64_t _context, long long _now)
+{
+	service->ProcessSlice(_context, _now);
+}
+
 /**
 * AlgoExecutionToMarketDataListener listen to updates from MarketDataService.
 * Type T is the product type.
@@ -435,6 +1092,124 @@ void AlgoExecutionToMarketDataListener<T>::ProcessRemove(OrderBook<T>& _data) {}
 template<typename T>
 void AlgoExecutionToMarketDataListener<T>::ProcessUpdate(OrderBook<T>& _data) {}
 
+/**
+* Parent Order Connector reads parent orders for AlgoExecutionService from a file, one per line:
+* algo,ticker,side,quantity,start,end,parameter
+* Times are in ms after the file is read and side is BUY or SELL. The parameter is the number of
+* slices for TWAP, the ';' separated volume profile for VWAP and the participation rate for POV.
+* Type T is the product type.
+*/
+template<typename T>
+class ParentOrderConnector : public Connector<ParentOrder<T>>
+{
+
+private:
+
+	AlgoExecutionService<T>* service;
+	Clock* clock;
+	Timestamp base_time; //time the file is read, parent order times are relative to it
+
+public:
+
+	// Connector and Destructor
+	ParentOrderConnector(AlgoExecutionService<T>* _service, Clock* _clock);
+	~ParentOrderConnector();
+
+	// Publish data to the Connector
+	void Publish(ParentOrder<T>& _data);
+
+	// Subscribe data from the Connector
+	void Subscribe(ifstream& _data);
+
+	// Submit the parent order of one line
+	void OnFields(const CsvLine& _line);
+
+};
+
+template<typename T>
+ParentOrderConnector<T>::ParentOrderConnector(AlgoExecutionService<T>* _service, Clock* _clock)
+{
+	service = _service;
+	clock = _clock;
+	base_time = 0;
+}
+
+template<typename T>
+ParentOrderConnector<T>::~ParentOrderConnector() {}
+
+template<typename T>
+void ParentOrderConnector<T>::Publish(ParentOrder<T>& _data) {}
+
+template<typename T>
+void ParentOrderConnector<T>::Subscribe(ifstream& _data)
+{
+	if (!_data.is_open())
+	{
+		std::cerr << "Failed to open file" << std::endl;
+		return;
+	}
+
+	base_time = clock->Now();
+	CsvReader reader;
+	reader.Read(_data, [this](const CsvLine& _line) { OnFields(_line); });
+
+	_data.close();
+}
+
+template<typename T>
+void ParentOrderConnector<T>::OnFields(const CsvLine& _line)
+{
+	if (_line.count < 7)
+	{
+		std::cerr << "Skipping parent order line with " << _line.count << " fields" << std::endl;
+		return;
+	}
+
+	int index = get_ticker_index(_line.View(1));
+	if (index < 0)
+	{
+		std::cerr << "Unknown ticker " << _line.View(1) << " in parent order" << std::endl;
+		return;
+	}
+
+	//BID is the buy side, as in the pre-trade checks and trade booking
+	const T& product = get_product_at<T>(index);
+	PricingSide side = _line.View(2) == "BUY" ? BID : OFFER;
+	long quantity = static_cast<long>(_line.Integer(3));
+	long long start_time = base_time + _line.Integer(4);
+	long long end_time = base_time + _line.Integer(5);
+
+	string_view algo = _line.View(0);
+	SlotHandle handle = INVALID_SLOT_HANDLE;
+	if (algo == "TWAP")
+	{
+		handle = service->SubmitTWAP(product, side, quantity, start_time, end_time, static_cast<int>(_line.Integer(6)));
+	}
+	else if (algo == "VWAP")
+	{
+		vector<double> weights;
+		string_view profile = _line.View(6);
+		for (size_t begin = 0; begin <= profile.size();)
+		{
+			size_t end = std::min(profile.find(';', begin), profile.size());
+			weights.push_back(atof(string(profile.substr(begin, end - begin)).c_str()));
+			begin = end + 1;
+		}
+		handle = service->SubmitVWAP(product, side, quantity, start_time, end_time, service->AddVolumeProfile(weights));
+	}
+	else if (algo == "POV")
+	{
+		handle = service->SubmitPOV(product, side, quantity, _line.Number(6), start_time, end_time);
+	}
+	else
+	{
+		std::cerr << "Unknown algo " << algo << std::endl;
+		return;
+	}
+
+	if (handle == INVALID_SLOT_HANDLE) std::cerr << "Rejected " << algo << " parent order for " << _line.View(1) << std::endl;
+}
+
 //pre declaration
 template<typename T>
 class ExecutionToAlgoExecutionListener;
@@ -442,6 +1217,10 @@ class ExecutionToAlgoExecutionListener;
 /**
  * Service for executing orders on an exchange.
  * Keyed on product identifier.
+ * Every order sent to a market is tracked in an order table through its lifecycle
+ * (NEW -> PARTIALLY_FILLED -> FILLED, or CANCELLED / REJECTED) and is addressed by the
+ * handle returned from ExecuteOrder. Fills are published to fill listeners; orders leave
+ * the table as soon as they reach a terminal state.
  * Type T is the product type.
  */
 template<typename T>
@@ -451,12 +1230,17 @@ private:
 
 	map<string, ExecutionOrder<T>> execution_orders;
 	vector<ServiceListener<ExecutionOrder<T>>*> listeners;
+	vector<ServiceListener<ExecutionFill<T>>*> fill_listeners;
 	ExecutionToAlgoExecutionListener<T>* listener;
+	SlotTable<OrderRecord<T>> order_table; //live orders, indexed by order handle
+
+	// Move the order to a terminal state and drop it from the order table
+	void RetireOrder(SlotHandle _handle, OrderState _state);
 
 public:
 
 	// Constructor and destructor
-	ExecutionService();
+	ExecutionService(size_t _expectedOrders = 1024);
 	~ExecutionService();
 
 	// Get data on our service given a key
@@ -471,19 +1255,39 @@ public:
 	// Get all listeners on the Service
 	const vector<ServiceListener<ExecutionOrder<T>>*>& GetListeners() const;
 
+	// Add a listener for fill events
+	void AddFillListener(ServiceListener<ExecutionFill<T>>* _listener);
+
+	// Get all fill listeners on the Service
+	const vector<ServiceListener<ExecutionFill<T>>*>& GetFillListeners() const;
+
 	// Get the listener of the service
 	ExecutionToAlgoExecutionListener<T>* GetListener();
 
-	// Execute an order on a market
-	void ExecuteOrder(ExecutionOrder<T>& order, Market market);
+	// Execute an order on a market, returning the handle of the order in the order table
+	SlotHandle ExecuteOrder(ExecutionOrder<T>& order, Market market);
+
+	// Apply a fill reported by the market for a live order; fills without a time take the order time
+	void ApplyFill(SlotHandle _handle, long _quantity, double _price, Timestamp _time = NO_TIMESTAMP);
+
+	// Cancel the open quantity of a live order; false if the order is no longer live
+	bool CancelOrder(SlotHandle _handle);
+
+	// Get a live order, nullptr once it has been filled, cancelled or rejected
+	const OrderRecord<T>* GetOrder(SlotHandle _handle) const;
+
+	// Get the number of live orders
+	size_t GetLiveOrderCount() const;
 
 };
 
 template<typename T>
-ExecutionService<T>::ExecutionService()
+ExecutionService<T>::ExecutionService(size_t _expectedOrders) :
+	order_table(_expectedOrders)
 {
 	execution_orders = map<string, ExecutionOrder<T>>();
 	listeners = vector<ServiceListener<ExecutionOrder<T>>*>();
+	fill_listeners = vector<ServiceListener<ExecutionFill<T>>*>();
 	listener = new ExecutionToAlgoExecutionListener<T>(this);
 }
 
@@ -514,6 +1318,18 @@ const vector<ServiceListener<ExecutionOrder<T>>*>& ExecutionService<T>::GetListe
 	return listeners;
 }
 
+template<typename T>
+void ExecutionService<T>::AddFillListener(ServiceListener<ExecutionFill<T>>* _listener)
+{
+	fill_listeners.push_back(_listener);
+}
+
+template<typename T>
+const vector<ServiceListener<ExecutionFill<T>>*>& ExecutionService<T>::GetFillListeners() const
+{
+	return fill_listeners;
+}
+
 template<typename T>
 ExecutionToAlgoExecutionListener<T>* ExecutionService<T>::GetListener()
 {
@@ -521,15 +1337,112 @@ ExecutionToAlgoExecutionListener<T>* ExecutionService<T>::GetListener()
 }
 
 template<typename T>
-void ExecutionService<T>::ExecuteOrder(ExecutionOrder<T>& order, Market market)
+SlotHandle ExecutionService<T>::ExecuteOrder(ExecutionOrder<T>& order, Market market)
 {
 	string product_id = order.GetProduct().GetProductId();
 	execution_orders[product_id] = order;
 
+	SlotHandle handle = order_table.Allocate(OrderRecord<T>{ order, market, ORDER_NEW, 0, 0 });
+
 	for (auto& l : listeners)
 	{
 		l->ProcessAdd(order);
 	}
+
+	long visible_qty = order.GetVisibleQuantity();
+	long hidden_qty = order.GetHiddenQuantity();
+	if (visible_qty + hidden_qty <= 0)
+	{
+		RetireOrder(handle, ORDER_REJECTED);
+		return handle;
+	}
+
+	//simulated venue: marketable orders are sent at the top of book price and fill immediately.
+	//limit and stop orders rest until the market reports fills or the order is cancelled.
+	switch (order.GetOrderType())
+	{
+	case MARKET:
+		//the visible quantity fills first, the hidden quantity behind it
+		if (visible_qty > 0) ApplyFill(handle, visible_qty, order.GetPrice());
+		if (hidden_qty > 0) ApplyFill(handle, hidden_qty, order.GetPrice());
+		break;
+	case FOK:
+		ApplyFill(handle, visible_qty + hidden_qty, order.GetPrice());
+		break;
+	case IOC:
+		//only the displayed quantity can trade immediately, the rest is cancelled
+		if (visible_qty > 0) ApplyFill(handle, visible_qty, order.GetPrice());
+		CancelOrder(handle);
+		break;
+	default:
+		break;
+	}
+
+	return handle;
+}
+
+template<typename T>
+void ExecutionService<T>::ApplyFill(SlotHandle _handle, long _quantity, double _price, Timestamp _time)
+{
+	OrderRecord<T>* record = order_table.Get(_handle);
+	if (record == nullptr || _quantity <= 0) return;
+
+	const ExecutionOrder<T>& order = record->order;
+	long total_qty = order.GetVisibleQuantity() + order.GetHiddenQuantity();
+	long fill_qty = std::min(_quantity, total_qty - record->filledQuantity);
+
+	record->filledQuantity += fill_qty;
+	record->fillCount++;
+	long leaves_qty = total_qty - record->filledQuantity;
+	record->state = leaves_qty == 0 ? ORDER_FILLED : ORDER_PARTIALLY_FILLED;
+
+	Timestamp fill_time = _time != NO_TIMESTAMP ? _time : order.GetTimestamp();
+	ExecutionFill<T> fill(order.GetProduct(), order.GetOrderId(), record->fillCount, order.GetPricingSide(), _price, fill_qty, leaves_qty, record->state, fill_time);
+
+	if (leaves_qty == 0)
+	{
+		order_table.Release(_handle);
+	}
+
+	for (auto& l : fill_listeners)
+	{
+		l->ProcessAdd(fill);
+	}
+}
+
+template<typename T>
+bool ExecutionService<T>::CancelOrder(SlotHandle _handle)
+{
+	if (!order_table.IsLive(_handle)) return false;
+
+	RetireOrder(_handle, ORDER_CANCELLED);
+	return true;
+}
+
+template<typename T>
+void ExecutionService<T>::RetireOrder(SlotHandle _handle, OrderState _state)
+{
+	OrderRecord<T>* record = order_table.Get(_handle);
+	record->state = _state;
+	ExecutionOrder<T> order = record->order;
+	order_table.Release(_handle);
+
+	for (auto& l : listeners)
+	{
+		l->ProcessRemove(order);
+	}
+}
+
+template<typename T>
+const OrderRecord<T>* ExecutionService<T>::GetOrder(SlotHandle _handle) const
+{
+	return order_table.Get(_handle);
+}
+
+template<typename T>
+size_t ExecutionService<T>::GetLiveOrderCount() const
+{
+	return order_table.Size();
 }
 
 /**
@@ -0,0 +1,245 @@
+/**
+ * filefollower.hpp
+ * Tail follow mode for file connectors: reads the lines of a file and keeps reading the lines an
+ * upstream process appends, so a connector can run as a long running service instead of a batch
+ * replay. Wakes on inotify on Linux and polls elsewhere.
+ *
+ * @author Krystal Lin
+ */
+
+#ifndef FILEFOLLOWER_HPP
+#define FILEFOLLOWER_HPP
+
+#include <string>
+#include <fstream>
+#include <functional>
+#include <filesystem>
+#include <thread>
+#include <chrono>
+#include <csignal>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/**
+ * Follows a file like tail -f.
+ * Lines are passed on once their newline is written, so a line the upstream process is still
+ * writing is held back until it is complete. A file that shrinks (truncated) or is replaced
+ * (rotated) is read again from the start. Waits between reads are bounded, so the stop
+ * condition is checked at least every _maxWaitMs.
+ */
+class FileFollower
+{
+
+private:
+
+	string filename;
+	ifstream file;
+	long long offset; //bytes read from the current file
+	string pending; //start of a line whose newline has not been written yet
+	int max_wait_ms;
+	long long line_count;
+	bool reopen;
+	bool at_end;
+#ifdef __linux__
+	int inotify_fd;
+	int watch;
+#endif
+
+	// Open the file from the start, watching it for changes; false if it does not exist yet
+	bool Open();
+
+	// Read everything appended since the last read; false if nothing was
+	bool ReadAvailable(const function<void(const string&)>& _onLine);
+
+	// Sleep until the file changes or the maximum wait passes
+	void Wait();
+
+public:
+
+	// Constructor; _maxWaitMs bounds the time between checks for new data and for the stop condition
+	FileFollower(const string& _filename, int _maxWaitMs = 100);
+
+	~FileFollower();
+
+	// Pass every line to _onLine, now and as they are appended, until _stop returns true
+	void Follow(const function<void(const string&)>& _onLine, const function<bool()>& _stop);
+
+	// Number of lines passed on
+	long long GetLineCount() const;
+
+	// Check whether the last read reached the end of what has been written so far
+	bool IsAtEnd() const;
+
+};
+
+FileFollower::FileFollower(const string& _filename, int _maxWaitMs)
+{
+	filename = _filename;
+	offset = 0;
+	max_wait_ms = _maxWaitMs;
+	line_count = 0;
+	reopen = true;
+	at_end = false;
+#ifdef __linux__
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	watch = -1;
+#endif
+}
+
+FileFollower::~FileFollower()
+{
+#ifdef __linux__
+	if (inotify_fd >= 0) close(inotify_fd);
+#endif
+}
+
+bool FileFollower::Open()
+{
+	if (file.is_open()) file.close();
+	file.clear();
+	file.open(filename, ios::binary);
+	offset = 0;
+	pending.clear();
+	if (!file.is_open()) return false;
+
+#ifdef __linux__
+	if (inotify_fd >= 0)
+	{
+		if (watch >= 0) inotify_rm_watch(inotify_fd, watch);
+		watch = inotify_add_watch(inotify_fd, filename.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF | IN_ATTRIB);
+	}
+#endif
+	return true;
+}
+
+bool FileFollower::ReadAvailable(const function<void(const string&)>& _onLine)
+{
+	char chunk[65536];
+	bool read_any = false;
+
+	while (true)
+	{
+		file.read(chunk, sizeof(chunk));
+		streamsize size = file.gcount();
+		if (size <= 0) break;
+		offset += size;
+		read_any = true;
+
+		//complete lines go out, the unterminated tail waits for the rest of its line
+		streamsize start = 0;
+		for (streamsize i = 0; i < size; i++)
+		{
+			if (chunk[i] != '\n') continue;
+
+			pending.append(chunk + start, static_cast<size_t>(i - start));
+			if (!pending.empty() && pending.back() == '\r') pending.pop_back();
+			line_count++;
+			_onLine(pending);
+			pending.clear();
+			start = i + 1;
+		}
+		pending.append(chunk + start, static_cast<size_t>(size - start));
+
+		if (size < static_cast<streamsize>(sizeof(chunk))) break;
+	}
+
+	//clear end of file so the next read picks up appended data
+	file.clear();
+	return read_any;
+}
+
+void FileFollower::Wait()
+{
+#ifdef __linux__
+	if (inotify_fd >= 0 && watch >= 0)
+	{
+		pollfd descriptor = { inotify_fd, POLLIN, 0 };
+		if (poll(&descriptor, 1, max_wait_ms) > 0)
+		{
+			alignas(inotify_event) char events[4096];
+			ssize_t size;
+			while ((size = read(inotify_fd, events, sizeof(events))) > 0)
+			{
+				for (char* p = events; p < events + size; p += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(p)->len)
+				{
+					//events of a watch dropped by Open are stale
+					inotify_event* event = reinterpret_cast<inotify_event*>(p);
+					if (event->wd == watch && (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)))
+					{
+						reopen = true;
+						watch = -1;
+					}
+				}
+			}
+		}
+		return;
+	}
+#endif
+	this_thread::sleep_for(chrono::milliseconds(max_wait_ms));
+}
+
+void FileFollower::Follow(const function<void(const string&)>& _onLine, const function<bool()>& _stop)
+{
+	while (!_stop || !_stop())
+	{
+		if (reopen)
+		{
+			//finish the replaced file before moving to the new one
+			if (file.is_open()) ReadAvailable(_onLine);
+			if (!Open())
+			{
+				Wait();
+				continue;
+			}
+			reopen = false;
+		}
+
+		at_end = !ReadAvailable(_onLine);
+		if (!at_end) continue;
+
+		//a file shorter than what was read has been truncated or replaced
+		error_code error;
+		uintmax_t size = filesystem::file_size(filename, error);
+		if (error || static_cast<long long>(size) < offset)
+		{
+			reopen = true;
+			continue;
+		}
+
+		Wait();
+	}
+}
+
+long long FileFollower::GetLineCount() const
+{
+	return line_count;
+}
+
+bool FileFollower::IsAtEnd() const
+{
+	return at_end;
+}
+
+// Set once SIGINT or SIGTERM is received, so long running services can stop cleanly
+volatile sig_atomic_t STOP_REQUESTED = 0;
+
+// Turn SIGINT and SIGTERM into a stop request instead of ending the process
+void install_stop_handler()
+{
+	std::signal(SIGINT, [](int) { STOP_REQUESTED = 1; });
+	std::signal(SIGTERM, [](int) { STOP_REQUESTED = 1; });
+}
+
+// Check whether a stop was requested
+bool stop_requested()
+{
+	return STOP_REQUESTED != 0;
+}
+
+#endif
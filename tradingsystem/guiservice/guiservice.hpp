@@ -1,6 +1,7 @@
 /**
  * guiservice.hpp
  * Simulates a GUI that only gets update periodically, with 300 millisecond throttle.
+ * The throttle is a repeating timer on the timer wheel of the service clock, which publishes the latest price received.
  *
  * @author Krystal Lin
  */
@@ -23,6 +24,9 @@ class GUIConnector;
 template<typename T>
 class GUIToPricingListener;
 
+template<typename T>
+class GUIThrottleTimerListener;
+
 
 /**
 * Service for outputing GUI with a certain throttle.
@@ -40,15 +44,25 @@ private:
 	GUIConnector<T>* connector;
 	ServiceListener<Price<T>>* listener;
 	int throttle;
-	std::chrono::time_point<std::chrono::system_clock> last_update;
+	Timestamp last_update;
 
 	int max_updates;
 	int count; //number of updates
 
+	Clock* clock;
+	TimerWheel* timer_wheel;
+	GUIThrottleTimerListener<T>* throttle_timer;
+	bool timer_armed;
+	Price<T> pending_update; //latest price not yet shown in GUI
+	bool has_pending_update;
+
+	// Show the pending price in the GUI
+	void PublishPending();
+
 public:
 
 	// Constructor and destructor
-	GUIService(int _throttle, int _max_updates);
+	GUIService(int _throttle, int _max_updates, Clock* _clock = &DefaultClock());
 	~GUIService();
 
 	// Get data on our service given a key
@@ -73,7 +87,7 @@ public:
 	int GetThrottle() const;
 
 	// Get the last update time of GUI service to user
-	std::chrono::time_point<std::chrono::system_clock> GetLastUpdate() const;
+	Timestamp GetLastUpdate() const;
 
 	// Get the max number of updates needed in GUI
 	int GetMaxUpdate() const;
@@ -81,24 +95,29 @@ public:
 	// Get current number of updates in GUI
 	int GetUpdateCount() const;
 
-	//reset the last update time
-	void SetLastUpdate(std::chrono::time_point<std::chrono::system_clock>& new_time);
+	// Throttle timer callback: publish the latest pending price and re-arm the timer
+	void ProcessThrottle(long long _now);
 
-	//update the count number
-	void IncrementCount();
+	// Publish the price still held back by the throttle, e.g. at the end of the input
+	void Flush();
 };
 
 template<typename T>
-GUIService<T>::GUIService(int _throttle, int _max_updates)
+GUIService<T>::GUIService(int _throttle, int _max_updates, Clock* _clock)
 {
 	gui_updates = map<string, Price<T>>();
 	listeners = vector<ServiceListener<Price<T>>*>();
 	connector = new GUIConnector<T>(this);
 	listener = new GUIToPricingListener<T>(this);
 	throttle = _throttle;
-	last_update = std::chrono::system_clock::now();
+	clock = _clock;
+	last_update = clock->Now();
 	max_updates = _max_updates;
 	count = 0;
+	timer_wheel = clock->GetTimerWheel() != nullptr ? clock->GetTimerWheel() : &SharedTimerWheel();
+	throttle_timer = new GUIThrottleTimerListener<T>(this);
+	timer_armed = false;
+	has_pending_update = false;
 }
 
 template<typename T>
@@ -114,7 +133,19 @@ template<typename T>
 void GUIService<T>::OnMessage(Price<T>& _data)
 {
 	gui_updates[_data.GetProduct().GetProductId()] = _data;
-	connector->Publish(_data);
+	pending_update = _data;
+	has_pending_update = true;
+
+	//fire a due throttle first: it shows the price held back before this one, or lets the GUI go idle
+	Timestamp now = clock->Now();
+	timer_wheel->Advance(now);
+
+	if (!timer_armed && count < max_updates)
+	{	//first update since the GUI went idle is shown right away, later ones wait for the throttle
+		PublishPending();
+		timer_armed = true;
+		timer_wheel->Schedule(now + throttle, throttle_timer, 0);
+	}
 }
 
 template<typename T>
@@ -161,26 +192,78 @@ int GUIService<T>::GetUpdateCount() const
 }
 
 template<typename T>
-std::chrono::time_point<std::chrono::system_clock> GUIService<T>::GetLastUpdate() const
+Timestamp GUIService<T>::GetLastUpdate() const
 {
 	return last_update;
 }
 
 template<typename T>
-void GUIService<T>::SetLastUpdate(std::chrono::time_point<std::chrono::system_clock>& new_time)
+void GUIService<T>::ProcessThrottle(long long _now)
 {
-	last_update = new_time;
+	if (!has_pending_update || count >= max_updates)
+	{	//nothing new to show, stay idle until the next price
+		timer_armed = false;
+		return;
+	}
+
+	PublishPending();
+	timer_wheel->Schedule(_now + throttle, throttle_timer, 0);
 }
 
 template<typename T>
-void GUIService<T>::IncrementCount()
+void GUIService<T>::Flush()
+{
+	if (!has_pending_update || count >= max_updates) return;
+	PublishPending();
+}
+
+template<typename T>
+void GUIService<T>::PublishPending()
 {
 	count++;
+	last_update = clock->Now();
+	has_pending_update = false;
+	connector->Publish(pending_update);
+}
+
+/**
+* GUIThrottleTimerListener receives the throttle timer of GUIService.
+* Type T is the product type.
+*/
+template<typename T>
+class GUIThrottleTimerListener : public TimerListener
+{
+
+private:
+
+	GUIService<T>* service;
+
+public:
+
+	// Constructor
+	GUIThrottleTimerListener(GUIService<T>* _service);
+
+	// Timer callback
+	void ProcessTimer(uint64_t _context, long long _now);
+
+};
+
+template<typename T>
+GUIThrottleTimerListener<T>::GUIThrottleTimerListener(GUIService<T>* _service)
+{
+	service = _service;
+}
+
+template<typename T>
+void GUIThrottleTimerListener<T>::ProcessTimer(uint64_t _context, long long _now)
+{
+	service->ProcessThrottle(_now);
 }
 
 
 /**
 * GUI Connector publishes data from GUI Service by saving it in gui.txt.
+* Throttling is done by the service, every price published here is written.
 * Type T is the product type.
 */
 template<typename T>
@@ -217,42 +300,28 @@ GUIConnector<T>::~GUIConnector() {}
 template<typename T>
 void GUIConnector<T>::Publish(Price<T>& _data)
 {
-	auto throttle = service->GetThrottle();
-	auto last_update = service->GetLastUpdate();
-	auto now_t = std::chrono::system_clock::now();
-	auto now = std::chrono::system_clock::to_time_t(now_t);
+	auto now_t = service->GetLastUpdate();
 
-	int max_update = service->GetMaxUpdate();
-	int current_update = service->GetUpdateCount();
+	// Create an ofstream object  - implemented by GPT.
+	ofstream outputFile;
 
-	//time diff in milliseconds
-	auto temp = static_cast<long long>(now - std::chrono::system_clock::to_time_t(last_update)) * 1000;
-	if (temp >= throttle && current_update < max_update)
+	// Open the file in append mode
+	outputFile.open("outputs/gui.txt", ios::app);
+
+	// Check if the file is open
+	if (outputFile.is_open()) 
 	{
-		service->IncrementCount();
-		service->SetLastUpdate(now_t);
-
-		// Create an ofstream object  - implemented by GPT.
-		ofstream outputFile;
-
-		// Open the file in append mode
-		outputFile.open("outputs/gui.txt", ios::app);
-
-		// Check if the file is open
-		if (outputFile.is_open()) 
-		{
-			string product_id = _data.GetProduct().GetProductId();
-			double mid = _data.GetMid();
-			double bid_ask_spread = _data.GetBidOfferSpread();
-			// Write to the file
-			outputFile << timeToString(now_t) << " , " << product_id << " , " << mid << " , " << bid_ask_spread <<  "\n";
-
-			// Close the file
-			outputFile.close();
-		}
-		else {
-			cout << "Unable to open file";
-		}
+		string product_id = _data.GetProduct().GetProductId();
+		double mid = _data.GetMid();
+		double bid_ask_spread = _data.GetBidOfferSpread();
+		// Write to the file
+		outputFile << timeToString(now_t) << " , " << product_id << " , " << mid << " , " << bid_ask_spread <<  "\n";
+
+		// Close the file
+		outputFile.close();
+	}
+	else {
+		cout << "Unable to open file";
 	}
 }
 
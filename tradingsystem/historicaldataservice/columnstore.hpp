@@ -0,0 +1,404 @@
+/**
+ * columnstore.hpp
+ * Columnar copy of the historical data for backtesting. Every journal also gets a directory with
+ * one file per column, each a flat little endian array with one value per record: the event time
+ * (int64), the product index (int32) and the numeric fields of the persisted type (double, enums as
+ * their values). columns.txt lists the columns and their types. Readers map the columns and scan
+ * them as arrays instead of parsing the text journals. A journal split into segments has a column
+ * directory per segment, which ColumnJournal finds through the segment catalog.
+ *
+ * @author Krystal Lin
+ */
+
+#ifndef COLUMNSTORE_HPP
+#define COLUMNSTORE_HPP
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <memory>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+#include "..\clock.hpp"
+#include "..\parallelingest.hpp"
+#include "journalindex.hpp"
+
+using namespace std;
+
+// Columns present in every column directory, ahead of the columns of the persisted type
+const string TIME_COLUMN = "time";
+const string PRODUCT_COLUMN = "product";
+
+// Get the column directory a journal (or journal segment) is exported to, next to it
+string column_directory(const string& _journal)
+{
+	return journal_stem(_journal);
+}
+
+// Get the file of a column, named after the column and its type
+string column_filename(const string& _directory, const string& _column, const string& _type)
+{
+	return _directory + "/" + _column + "." + _type;
+}
+
+// Get the width in bytes of a column type
+size_t column_width(const string& _type)
+{
+	return _type == "i32" ? sizeof(int32_t) : sizeof(int64_t);
+}
+
+/**
+ * Appends records to the columns of a directory. Columns left uneven by an interrupted run are
+ * cut back to their common length when opened, and a directory holding other columns is started
+ * again.
+ */
+class ColumnWriter
+{
+
+private:
+
+	string directory;
+	vector<string> names;
+	vector<string> types;
+	vector<unique_ptr<ofstream>> files;
+	uint64_t row_count;
+
+	// Bring the directory to the schema and to whole rows; returns the number of rows kept
+	uint64_t Recover();
+
+public:
+
+	ColumnWriter();
+
+	// Open a column directory for appending records with the given value columns; false if it cannot be written
+	bool Open(const string& _directory, const vector<string>& _columns);
+
+	// Check whether the columns are open
+	bool IsOpen() const;
+
+	// Append one record; _values holds one value per value column
+	void Append(Timestamp _time, int _productIndex, const double* _values);
+
+	// Get the number of records in the columns
+	uint64_t GetRows() const;
+
+};
+
+ColumnWriter::ColumnWriter()
+{
+	row_count = 0;
+}
+
+uint64_t ColumnWriter::Recover()
+{
+	//the schema must match, otherwise the old columns are dropped
+	string schema;
+	for (size_t i = 0; i < names.size(); i++) schema += names[i] + " " + types[i] + "\n";
+
+	string current;
+	{
+		ifstream input(directory + "/columns.txt", ios::binary);
+		if (input.is_open()) current.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+	}
+
+	error_code error;
+	if (current != schema)
+	{
+		if (!current.empty()) std::cerr << "Replacing columns of " << directory << std::endl;
+		for (size_t i = 0; i < names.size(); i++) filesystem::remove(column_filename(directory, names[i], types[i]), error);
+		ofstream output(directory + "/columns.txt", ios::binary | ios::trunc);
+		output << schema;
+		return 0;
+	}
+
+	uint64_t rows = UINT64_MAX;
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		string filename = column_filename(directory, names[i], types[i]);
+		uint64_t size = filesystem::exists(filename, error) ? filesystem::file_size(filename, error) : 0;
+		if (size / column_width(types[i]) < rows) rows = size / column_width(types[i]);
+	}
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		string filename = column_filename(directory, names[i], types[i]);
+		if (filesystem::exists(filename, error)) filesystem::resize_file(filename, rows * column_width(types[i]), error);
+	}
+	return rows;
+}
+
+bool ColumnWriter::Open(const string& _directory, const vector<string>& _columns)
+{
+	directory = _directory;
+	names = { TIME_COLUMN, PRODUCT_COLUMN };
+	types = { "i64", "i32" };
+	for (const string& column : _columns)
+	{
+		names.push_back(column);
+		types.push_back("f64");
+	}
+
+	error_code error;
+	filesystem::create_directories(directory, error);
+	if (error) return false;
+	row_count = Recover();
+
+	files.clear();
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		files.push_back(make_unique<ofstream>(column_filename(directory, names[i], types[i]), ios::binary | ios::app));
+		if (!files.back()->is_open()) return false;
+	}
+	return true;
+}
+
+bool ColumnWriter::IsOpen() const
+{
+	return !files.empty() && files.back()->is_open();
+}
+
+void ColumnWriter::Append(Timestamp _time, int _productIndex, const double* _values)
+{
+	int64_t time = _time;
+	int32_t product_index = _productIndex;
+	files[0]->write(reinterpret_cast<const char*>(&time), sizeof(time));
+	files[1]->write(reinterpret_cast<const char*>(&product_index), sizeof(product_index));
+	for (size_t i = 2; i < files.size(); i++) files[i]->write(reinterpret_cast<const char*>(&_values[i - 2]), sizeof(double));
+
+	//records are complete on disk after every append, like the journal
+	for (auto& file : files) file->flush();
+	row_count++;
+}
+
+uint64_t ColumnWriter::GetRows() const
+{
+	return row_count;
+}
+
+/**
+ * Read only view of a column directory with every column mapped as an array.
+ */
+class ColumnTable
+{
+
+private:
+
+	vector<string> names;
+	vector<unique_ptr<MappedFile>> files;
+	uint64_t row_count;
+
+	// Get the mapped data of a column, nullptr if there is no such column
+	const char* Find(const string& _column) const;
+
+public:
+
+	ColumnTable();
+
+	// Map the columns of a directory; false if it has no readable columns
+	bool Open(const string& _directory);
+
+	// Get the number of records
+	uint64_t GetRows() const;
+
+	// Get the names of the columns
+	const vector<string>& GetColumns() const;
+
+	// Get the event times
+	const int64_t* GetTimes() const;
+
+	// Get the product indices
+	const int32_t* GetProducts() const;
+
+	// Get a value column, nullptr if there is no such column
+	const double* GetColumn(const string& _column) const;
+
+	// Sum a value column over the records of a product (or ALL_PRODUCTS) with an event time in [_from, _to]
+	double Sum(const string& _column, int _productIndex, Timestamp _from, Timestamp _to) const;
+
+};
+
+ColumnTable::ColumnTable()
+{
+	row_count = 0;
+}
+
+bool ColumnTable::Open(const string& _directory)
+{
+	ifstream schema(_directory + "/columns.txt");
+	if (!schema.is_open()) return false;
+
+	names.clear();
+	files.clear();
+	row_count = UINT64_MAX;
+	string name;
+	string type;
+	while (schema >> name >> type)
+	{
+		files.push_back(make_unique<MappedFile>());
+		if (!files.back()->Open(column_filename(_directory, name, type))) return false;
+		names.push_back(name);
+
+		//a writer may be part way through a record; only whole rows are read
+		uint64_t rows = files.back()->GetSize() / column_width(type);
+		if (rows < row_count) row_count = rows;
+	}
+	if (names.empty()) row_count = 0;
+	return !names.empty();
+}
+
+const char* ColumnTable::Find(const string& _column) const
+{
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		if (names[i] == _column) return files[i]->GetData();
+	}
+	return nullptr;
+}
+
+uint64_t ColumnTable::GetRows() const
+{
+	return row_count;
+}
+
+const vector<string>& ColumnTable::GetColumns() const
+{
+	return names;
+}
+
+const int64_t* ColumnTable::GetTimes() const
+{
+	return reinterpret_cast<const int64_t*>(Find(TIME_COLUMN));
+}
+
+const int32_t* ColumnTable::GetProducts() const
+{
+	return reinterpret_cast<const int32_t*>(Find(PRODUCT_COLUMN));
+}
+
+const double* ColumnTable::GetColumn(const string& _column) const
+{
+	return reinterpret_cast<const double*>(Find(_column));
+}
+
+double ColumnTable::Sum(const string& _column, int _productIndex, Timestamp _from, Timestamp _to) const
+{
+	const double* values = GetColumn(_column);
+	const int64_t* times = GetTimes();
+	const int32_t* products = GetProducts();
+	if (values == nullptr || times == nullptr || products == nullptr) return 0;
+
+	//branch free so the loop vectorizes
+	double total = 0;
+	bool all_products = _productIndex == ALL_PRODUCTS;
+	for (uint64_t i = 0; i < row_count; i++)
+	{
+		bool match = times[i] >= _from && times[i] <= _to && (all_products || products[i] == _productIndex);
+		total += match ? values[i] : 0.0;
+	}
+	return total;
+}
+
+/**
+ * Read only view of the columns of a whole journal: the column directory of every closed segment in
+ * the catalog and of the segment being written, oldest first, or the single directory of a journal
+ * that is not split into segments.
+ */
+class ColumnJournal
+{
+
+private:
+
+	vector<ColumnTable> tables;
+	vector<JournalSegment> segments; //summary of each table's segment; the one being written matches everything
+
+	// Map the column directory of a segment, skipping it if it is missing
+	void Add(const string& _directory, const JournalSegment& _segment);
+
+public:
+
+	// Map the columns of a journal, or of a single column directory; false if there are none
+	bool Open(const string& _journal);
+
+	// Get the number of records across the segments
+	uint64_t GetRows() const;
+
+	// Get the column directory of each segment, oldest first
+	const vector<ColumnTable>& GetTables() const;
+
+	// Check whether any segment has a value column
+	bool HasColumn(const string& _column) const;
+
+	// Sum a value column over the records of a product (or ALL_PRODUCTS) with an event time in [_from, _to],
+	// skipping the segments the catalog rules out
+	double Sum(const string& _column, int _productIndex, Timestamp _from, Timestamp _to) const;
+
+};
+
+void ColumnJournal::Add(const string& _directory, const JournalSegment& _segment)
+{
+	ColumnTable table;
+	if (!table.Open(_directory)) return;
+	tables.push_back(std::move(table));
+	segments.push_back(_segment);
+}
+
+bool ColumnJournal::Open(const string& _journal)
+{
+	tables.clear();
+	segments.clear();
+	const JournalSegment everything = { 0, INT64_MIN, INT64_MAX, ~0ull, 0, 0 };
+
+	//a column directory given directly, or the directory of a journal without a catalog
+	error_code error;
+	if (filesystem::exists(_journal + "/columns.txt", error)) Add(_journal, everything);
+	else if (!filesystem::exists(journal_catalog_filename(_journal), error)) Add(column_directory(_journal), everything);
+	else
+	{
+		//segments deleted by the writer's retention since the catalog was written are skipped
+		vector<JournalSegment> closed = read_journal_segments(_journal);
+		for (const JournalSegment& segment : closed) Add(column_directory(journal_segment_filename(_journal, segment.sequence)), segment);
+
+		JournalSegment current = everything;
+		current.sequence = closed.empty() ? 1 : closed.back().sequence + 1;
+		Add(column_directory(journal_segment_filename(_journal, current.sequence)), current);
+	}
+	return !tables.empty();
+}
+
+uint64_t ColumnJournal::GetRows() const
+{
+	uint64_t rows = 0;
+	for (const ColumnTable& table : tables) rows += table.GetRows();
+	return rows;
+}
+
+const vector<ColumnTable>& ColumnJournal::GetTables() const
+{
+	return tables;
+}
+
+bool ColumnJournal::HasColumn(const string& _column) const
+{
+	for (const ColumnTable& table : tables)
+	{
+		if (table.GetColumn(_column) != nullptr) return true;
+	}
+	return false;
+}
+
+double ColumnJournal::Sum(const string& _column, int _productIndex, Timestamp _from, Timestamp _to) const
+{
+	double total = 0;
+	uint64_t product_bit = _productIndex == ALL_PRODUCTS ? ~0ull : journal_product_bit(_productIndex);
+	for (size_t i = 0; i < tables.size(); i++)
+	{
+		const JournalSegment& segment = segments[i];
+		if (segment.maxTime < _from || segment.minTime > _to || (segment.productMask & product_bit) == 0) continue;
+		total += tables[i].Sum(_column, _productIndex, _from, _to);
+	}
+	return total;
+}
+
+#endif
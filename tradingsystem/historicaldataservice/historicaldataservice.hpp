@@ -10,6 +10,9 @@
  */
 
 #include "..\soa.hpp"
+#include "..\bondstaticdata.hpp"
+#include "journalindex.hpp"
+#include "columnstore.hpp"
 #include <string>
 
 #ifndef HISTORICAL_DATA_SERVICE_HPP
@@ -22,9 +25,31 @@ enum ServiceType
     RiskType,
     ExecutionType,
     StreamingType,
-    InquiryType
+    InquiryType,
+    RejectionType
 };
 
+// Get the journal a service type is persisted to
+string journal_filename(ServiceType _service)
+{
+	switch (_service)
+	{
+	case PositionType:
+		return "outputs/positions.txt";
+	case RiskType:
+		return "outputs/risk.txt";
+	case ExecutionType:
+		return "outputs/executions.txt";
+	case StreamingType:
+		return "outputs/streaming.txt";
+	case InquiryType:
+		return "outputs/allinquiries.txt";
+	case RejectionType:
+		return "outputs/rejections.txt";
+	}
+	return "";
+}
+
 
 //pre declaration
 template<typename T>
@@ -48,11 +73,12 @@ private:
     HistoricalDataConnector<T>* connector;
     ServiceListener<T>* listener;
 	ServiceType service;
+	JournalPolicy journal_policy;
 
 public:
 
 	// Constructor and destructor
-	HistoricalDataService(ServiceType _service);
+	HistoricalDataService(ServiceType _service, const JournalPolicy& _journalPolicy = JournalPolicy());
 	~HistoricalDataService();
 
 	// Get data on our service given a key
@@ -61,6 +87,9 @@ public:
 	// The callback that a Connector should invoke for any new or updated data
 	void OnMessage(T& _data);
 
+	// The callback for data the caller no longer needs; it is moved into the store
+	void OnMessage(T&& _data);
+
 	// Add a listener to the Service for callbacks on add, remove, and update events for data to the Service
 	void AddListener(ServiceListener<T>* _listener);
 
@@ -76,19 +105,26 @@ public:
 	// Get the service type that this service is persisting
 	ServiceType GetServiceType() const;
 
+	// Get how the journal is split into segments
+	const JournalPolicy& GetJournalPolicy() const;
+
 	// Persist data to a store
 	void PersistData(string persistKey, T& data);
+
+	// Pass the persisted records of a product (empty for all products) with an event time in [_from, _to] to _onRecord, oldest first; returns how many matched
+	size_t Query(const string& _productId, Timestamp _from, Timestamp _to, const function<void(const JournalEntry&, string_view)>& _onRecord);
 };
 
 
 template<typename T>
-HistoricalDataService<T>::HistoricalDataService(ServiceType _service)
+HistoricalDataService<T>::HistoricalDataService(ServiceType _service, const JournalPolicy& _journalPolicy)
 {
 	historical_data = map<string, T>();
 	listeners = vector<ServiceListener<T>*>();
 	connector = new HistoricalDataConnector<T>(this);
 	listener = new HistoricalDataListener<T>(this);
 	service = _service;
+	journal_policy = _journalPolicy;
 }
 
 template<typename T>
@@ -103,7 +139,14 @@ T& HistoricalDataService<T>::GetData(string _key)
 template<typename T>
 void HistoricalDataService<T>::OnMessage(T& _data)
 {
-	historical_data[_data.GetPersistKey()] = _data;
+	historical_data.insert_or_assign(_data.GetPersistKey(), _data);
+}
+
+template<typename T>
+void HistoricalDataService<T>::OnMessage(T&& _data)
+{
+	string key = _data.GetPersistKey();
+	historical_data.insert_or_assign(std::move(key), std::move(_data));
 }
 
 template<typename T>
@@ -138,14 +181,36 @@ ServiceType HistoricalDataService<T>::GetServiceType() const
 	return service;
 }
 
+template<typename T>
+const JournalPolicy& HistoricalDataService<T>::GetJournalPolicy() const
+{
+	return journal_policy;
+}
+
 template<typename T>
 void HistoricalDataService<T>::PersistData(string _persistKey, T& _data)
 {
 	connector->Publish(_data);
 }
 
+template<typename T>
+size_t HistoricalDataService<T>::Query(const string& _productId, Timestamp _from, Timestamp _to, const function<void(const JournalEntry&, string_view)>& _onRecord)
+{
+	int product_index = ALL_PRODUCTS;
+	if (!_productId.empty())
+	{
+		product_index = get_product_index(_productId);
+		if (product_index < 0) return 0;
+	}
+
+	JournalQuery query;
+	if (!query.Open(journal_filename(service))) return 0;
+	return query.Query(_from, _to, product_index, _onRecord);
+}
+
 /**
-* Historical Data Connector outputs data from services into txt files.
+* Historical Data Connector outputs data from services into txt files, indexed by event time and product,
+* and into a column directory per service for backtesting.
 * Type T is the data type to persist.
 */
 template<typename T>
@@ -155,6 +220,10 @@ class HistoricalDataConnector : public Connector<T>
 private:
 
 	HistoricalDataService<T>* service;
+	JournalWriter journal; //opened on the first record
+	ColumnWriter columns;
+	string columns_journal; //journal file the columns are exported from; a new segment gets new columns
+	vector<double> values;
 
 public:
 
@@ -182,46 +251,25 @@ HistoricalDataConnector<T>::~HistoricalDataConnector() {}
 template<typename T>
 void HistoricalDataConnector<T>::Publish(T& _data)
 {
-	auto service_type = service->GetServiceType();
-	string filename;
-	
-	switch (service_type)
+	if (!journal.IsOpen() && !journal.Open(journal_filename(service->GetServiceType()), service->GetJournalPolicy()))
 	{
-	case PositionType:
-		filename = "outputs/positions.txt";
-		break;
-	case RiskType:
-		filename = "outputs/risk.txt";
-		break;
-	case ExecutionType:
-		filename = "outputs/executions.txt";
-		break;
-	case StreamingType:
-		filename = "outputs/streaming.txt";
-		break;
-	case InquiryType:
-		filename = "outputs/allinquiries.txt";
-		break;
+		cout << "Unable to open file";
+		return;
 	}
 
-	// Create an ofstream object - implemented by gpt.
-	ofstream outputFile;
+	int product_index = get_product_index(_data.GetProduct().GetProductId());
+	string record = _data.GetPersistData();
+	journal.Append(record, _data.GetTimestamp(), product_index);
 
-	// Open the file in append mode
-	outputFile.open(filename, ios::app);
-
-	// Check if the file is open
-	if (outputFile.is_open())
+	if (!columns.IsOpen() || columns_journal != journal.GetFilename())
 	{
-		string temp = _data.GetPersistData();
-		outputFile << _data.GetPersistData() << "\n";
-
-		// Close the file
-		outputFile.close();
-	}
-	else {
-		cout << "Unable to open file";
+		vector<string> names = T::GetPersistColumns();
+		values.resize(names.size());
+		columns_journal = journal.GetFilename();
+		if (!columns.Open(column_directory(columns_journal), names)) return;
 	}
+	_data.GetPersistValues(values.data());
+	columns.Append(_data.GetTimestamp(), product_index, values.data());
 }
 
 template<typename T>
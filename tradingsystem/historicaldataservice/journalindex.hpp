@@ -0,0 +1,629 @@
+/**
+ * journalindex.hpp
+ * Indexes of the historical data journals, built as records are written, and range queries over
+ * them. Next to each journal an entry file holds the time, product and position of every record,
+ * and a block file summarizes every JOURNAL_BLOCK_ENTRIES entries with their time range and the
+ * products they contain. A query maps the three files and only reads the entries of the blocks
+ * that can match and the records it returns, never the whole journal.
+ *
+ * A journal can also be split into segments by size or age, each a journal with its own index
+ * (executions.000001.txt, ...). The catalog file (executions.txt.segments) summarizes the closed
+ * segments like blocks, so a query only maps the segments that can match, and the oldest
+ * segments are deleted beyond the configured retention.
+ *
+ * @author Krystal Lin
+ */
+
+#ifndef JOURNALINDEX_HPP
+#define JOURNALINDEX_HPP
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include "..\clock.hpp"
+#include "..\parallelingest.hpp"
+
+using namespace std;
+
+// Entries summarized by one block of the block file
+const uint32_t JOURNAL_BLOCK_ENTRIES = 1024;
+
+// Product index matching every record in a query
+const int ALL_PRODUCTS = -2;
+
+/**
+ * Index entry of one journal record: its event time, product index (-1 if unknown), and the
+ * offset and length of its text in the journal, without the newline.
+ */
+struct JournalEntry
+{
+	int64_t time;
+	uint64_t offset;
+	uint32_t length;
+	int32_t productIndex;
+};
+
+/**
+ * Summary of JOURNAL_BLOCK_ENTRIES consecutive entries. Records are not assumed to be in time
+ * order, since journals are appended to by runs on different clocks.
+ */
+struct JournalBlock
+{
+	int64_t minTime;
+	int64_t maxTime;
+	uint64_t productMask; //bit productIndex % 64 of every product in the block
+};
+
+/**
+ * When a journal is split into segments. With no limit set the journal is a single file.
+ */
+struct JournalPolicy
+{
+	uint64_t segmentBytes = 0;   //start a new segment before one grows past this size, 0 for no limit
+	Timestamp segmentMillis = 0; //start a new segment once one has been written to this long, 0 for no limit
+	int retainSegments = 0;      //segments kept, counting the one being written; older ones are deleted. 0 keeps all
+	Clock* clock = nullptr;      //times the age of a segment; the wall clock when not set
+};
+
+/**
+ * Catalog entry of a closed segment: its time range and products, like a block, and its size.
+ */
+struct JournalSegment
+{
+	uint64_t sequence;
+	int64_t minTime;
+	int64_t maxTime;
+	uint64_t productMask;
+	uint64_t records;
+	uint64_t bytes;
+};
+
+// Bit of a product in a block's product mask; unknown products share the last bit
+uint64_t journal_product_bit(int _productIndex)
+{
+	return 1ull << (static_cast<uint32_t>(_productIndex) & 63);
+}
+
+// Add an entry to the summary of its block
+void add_to_block(JournalBlock& _block, const JournalEntry& _entry, bool _first)
+{
+	if (_first)
+	{
+		_block.minTime = _entry.time;
+		_block.maxTime = _entry.time;
+		_block.productMask = 0;
+	}
+	if (_entry.time < _block.minTime) _block.minTime = _entry.time;
+	if (_entry.time > _block.maxTime) _block.maxTime = _entry.time;
+	_block.productMask |= journal_product_bit(_entry.productIndex);
+}
+
+// Get a journal's name without its extension; segments and column directories are named after it
+string journal_stem(const string& _filename)
+{
+	size_t dot = _filename.rfind('.');
+	size_t slash = _filename.find_last_of("/\\");
+	if (dot == string::npos || (slash != string::npos && dot < slash)) return _filename;
+	return _filename.substr(0, dot);
+}
+
+// Get the file of a segment of a journal: the sequence number goes before the extension
+string journal_segment_filename(const string& _filename, uint64_t _sequence)
+{
+	char number[24];
+	snprintf(number, sizeof(number), ".%06llu", static_cast<unsigned long long>(_sequence));
+	string stem = journal_stem(_filename);
+	return stem + number + _filename.substr(stem.size());
+}
+
+// Get the catalog of a segmented journal
+string journal_catalog_filename(const string& _filename)
+{
+	return _filename + ".segments";
+}
+
+// Read the closed segments of a journal from its catalog, oldest first
+vector<JournalSegment> read_journal_segments(const string& _filename)
+{
+	vector<JournalSegment> segments;
+	ifstream input(journal_catalog_filename(_filename), ios::binary);
+	JournalSegment segment;
+	while (input.read(reinterpret_cast<char*>(&segment), sizeof(segment))) segments.push_back(segment);
+	return segments;
+}
+
+// Replace the catalog of a journal; written aside and renamed so readers never see it half written
+bool write_journal_segments(const string& _filename, const vector<JournalSegment>& _segments)
+{
+	string catalog = journal_catalog_filename(_filename);
+	{
+		ofstream output(catalog + ".tmp", ios::binary | ios::trunc);
+		output.write(reinterpret_cast<const char*>(_segments.data()), static_cast<streamsize>(_segments.size() * sizeof(JournalSegment)));
+		if (!output) return false;
+	}
+	error_code error;
+	filesystem::rename(catalog + ".tmp", catalog, error);
+	return !error;
+}
+
+// Summarize a segment from its index: the blocks, then the entries after the last full block
+JournalSegment summarize_journal_segment(const string& _filename, uint64_t _sequence)
+{
+	JournalSegment segment = { _sequence, INT64_MAX, INT64_MIN, 0, 0, 0 };
+	error_code error;
+	segment.bytes = filesystem::file_size(_filename, error);
+	if (error) segment.bytes = 0;
+
+	//a segment without an index has nothing to query
+	MappedFile entries;
+	MappedFile blocks;
+	if (!entries.Open(_filename + ".idx") || !blocks.Open(_filename + ".blk")) return segment;
+
+	const JournalEntry* entry_data = reinterpret_cast<const JournalEntry*>(entries.GetData());
+	const JournalBlock* block_data = reinterpret_cast<const JournalBlock*>(blocks.GetData());
+	segment.records = entries.GetSize() / sizeof(JournalEntry);
+	uint64_t block_count = blocks.GetSize() / sizeof(JournalBlock);
+	if (block_count > segment.records / JOURNAL_BLOCK_ENTRIES) block_count = segment.records / JOURNAL_BLOCK_ENTRIES;
+
+	JournalBlock summary = { INT64_MAX, INT64_MIN, 0 };
+	for (uint64_t b = 0; b < block_count; b++)
+	{
+		if (block_data[b].minTime < summary.minTime) summary.minTime = block_data[b].minTime;
+		if (block_data[b].maxTime > summary.maxTime) summary.maxTime = block_data[b].maxTime;
+		summary.productMask |= block_data[b].productMask;
+	}
+	for (uint64_t i = block_count * JOURNAL_BLOCK_ENTRIES; i < segment.records; i++) add_to_block(summary, entry_data[i], false);
+
+	segment.minTime = summary.minTime;
+	segment.maxTime = summary.maxTime;
+	segment.productMask = summary.productMask;
+	return segment;
+}
+
+// Delete a segment: the journal, its index, and the directory named after it
+void remove_journal_segment(const string& _filename)
+{
+	error_code error;
+	filesystem::remove(_filename, error);
+	filesystem::remove(_filename + ".idx", error);
+	filesystem::remove(_filename + ".blk", error);
+	filesystem::remove_all(journal_stem(_filename), error);
+}
+
+// Reserve the disk space of a segment up front, without changing its size, so appends do not have to grow it
+void preallocate_journal(const string& _filename, uint64_t _bytes)
+{
+#ifdef __linux__
+	int fd = open(_filename.c_str(), O_WRONLY);
+	if (fd < 0) return;
+	fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(_bytes));
+	close(fd);
+#endif
+}
+
+/**
+ * Appends records to a journal and their entries to its index files. The index is checked
+ * against the journal when opened and rebuilt empty if they no longer match; records written
+ * without an index are kept but cannot be queried. With a segment limit in its policy the writer
+ * starts a new segment on every open and whenever the limit is reached.
+ */
+class JournalWriter
+{
+
+private:
+
+	string base_filename;
+	string filename; //the journal, or its segment being written
+	JournalPolicy policy;
+	ofstream journal;
+	ofstream entries;
+	ofstream blocks;
+	uint64_t journal_size;
+	uint64_t entry_count;
+	JournalBlock block; //summary of the entries after the last full block
+	vector<JournalSegment> segments; //closed segments, oldest first
+	uint64_t sequence; //of the segment being written
+	Timestamp segment_started;
+
+	// Open the index files for appending, recovering the partial block; false if they do not match the journal
+	bool OpenIndex();
+
+	// Open one journal file and its index
+	bool OpenFile(const string& _filename);
+
+	// Check whether the policy splits the journal into segments
+	bool IsSegmented() const;
+
+	// Get the time segment ages are measured on
+	Timestamp Now() const;
+
+	// Close the segment being written and start the next one, deleting segments beyond the retention
+	bool Rotate();
+
+	// Start writing a new segment
+	bool StartSegment(uint64_t _sequence);
+
+public:
+
+	JournalWriter();
+
+	// Open a journal for appending, split into segments as the policy sets; false if it cannot be written
+	bool Open(const string& _filename, const JournalPolicy& _policy = JournalPolicy());
+
+	// Check whether the journal and its index are open
+	bool IsOpen() const;
+
+	// Append one record with its event time and product index. Trailing newlines of _record are dropped.
+	void Append(string_view _record, Timestamp _time, int _productIndex);
+
+	// Get the file being written: the journal, or its current segment
+	const string& GetFilename() const;
+
+	// Get the closed segments, oldest first
+	const vector<JournalSegment>& GetSegments() const;
+
+};
+
+JournalWriter::JournalWriter()
+{
+	journal_size = 0;
+	entry_count = 0;
+	block = JournalBlock{ 0, 0, 0 };
+	sequence = 0;
+	segment_started = 0;
+}
+
+bool JournalWriter::OpenIndex()
+{
+	error_code error;
+	uint64_t entries_size = filesystem::exists(filename + ".idx", error) ? filesystem::file_size(filename + ".idx", error) : 0;
+	if (error || entries_size % sizeof(JournalEntry) != 0) return false;
+	entry_count = entries_size / sizeof(JournalEntry);
+
+	uint64_t blocks_size = filesystem::exists(filename + ".blk", error) ? filesystem::file_size(filename + ".blk", error) : 0;
+	if (error || blocks_size != entry_count / JOURNAL_BLOCK_ENTRIES * sizeof(JournalBlock)) return false;
+
+	//the last entry must lie within the journal, and the partial block is summarized again
+	uint64_t partial = entry_count % JOURNAL_BLOCK_ENTRIES;
+	if (entry_count > 0)
+	{
+		vector<JournalEntry> tail(partial > 0 ? partial : 1);
+		ifstream input(filename + ".idx", ios::binary);
+		input.seekg(static_cast<streamoff>((entry_count - tail.size()) * sizeof(JournalEntry)));
+		input.read(reinterpret_cast<char*>(tail.data()), static_cast<streamsize>(tail.size() * sizeof(JournalEntry)));
+		if (!input) return false;
+
+		const JournalEntry& last = tail.back();
+		if (last.offset + last.length > journal_size) return false;
+		for (uint64_t i = 0; i < partial; i++) add_to_block(block, tail[i], i == 0);
+	}
+
+	entries.open(filename + ".idx", ios::binary | ios::app);
+	blocks.open(filename + ".blk", ios::binary | ios::app);
+	return entries.is_open() && blocks.is_open();
+}
+
+bool JournalWriter::OpenFile(const string& _filename)
+{
+	journal.close();
+	entries.close();
+	blocks.close();
+
+	filename = _filename;
+	journal.open(filename, ios::binary | ios::app);
+	if (!journal.is_open()) return false;
+
+	error_code error;
+	journal_size = filesystem::file_size(filename, error);
+	if (error) return false;
+
+	if (!OpenIndex())
+	{
+		//start a new index from the current end of the journal
+		std::cerr << "Rebuilding index of " << filename << std::endl;
+		entries.close();
+		blocks.close();
+		entries.open(filename + ".idx", ios::binary | ios::trunc);
+		blocks.open(filename + ".blk", ios::binary | ios::trunc);
+		entry_count = 0;
+	}
+	return entries.is_open() && blocks.is_open();
+}
+
+bool JournalWriter::IsSegmented() const
+{
+	return policy.segmentBytes > 0 || policy.segmentMillis > 0;
+}
+
+Timestamp JournalWriter::Now() const
+{
+	return policy.clock != nullptr ? policy.clock->Now() : DefaultClock().Now();
+}
+
+bool JournalWriter::Open(const string& _filename, const JournalPolicy& _policy)
+{
+	base_filename = _filename;
+	policy = _policy;
+	if (!IsSegmented())
+	{
+		if (policy.retainSegments > 0) std::cerr << "Retention ignored for " << _filename << ": it is only applied with a segment size or age limit" << std::endl;
+		return OpenFile(_filename);
+	}
+
+	//a segment left open by an earlier run is closed as it is, and this run starts the next one
+	segments = read_journal_segments(_filename);
+	uint64_t next = segments.empty() ? 1 : segments.back().sequence + 1;
+	error_code error;
+	if (filesystem::exists(journal_segment_filename(_filename, next), error))
+	{
+		segments.push_back(summarize_journal_segment(journal_segment_filename(_filename, next), next));
+		next++;
+	}
+	return StartSegment(next);
+}
+
+bool JournalWriter::StartSegment(uint64_t _sequence)
+{
+	//the catalog is written before the segment exists, so a reader never sees a segment twice
+	while (policy.retainSegments > 0 && segments.size() + 1 > static_cast<size_t>(policy.retainSegments))
+	{
+		remove_journal_segment(journal_segment_filename(base_filename, segments.front().sequence));
+		segments.erase(segments.begin());
+	}
+	if (!write_journal_segments(base_filename, segments)) return false;
+
+	sequence = _sequence;
+	segment_started = Now();
+	block = JournalBlock{ 0, 0, 0 };
+	if (!OpenFile(journal_segment_filename(base_filename, sequence))) return false;
+	if (policy.segmentBytes > 0) preallocate_journal(filename, policy.segmentBytes);
+	return true;
+}
+
+bool JournalWriter::Rotate()
+{
+	journal.close();
+	entries.close();
+	blocks.close();
+
+	//give back the preallocated space the segment did not use
+	error_code error;
+	if (policy.segmentBytes > 0) filesystem::resize_file(filename, journal_size, error);
+
+	segments.push_back(summarize_journal_segment(filename, sequence));
+	return StartSegment(sequence + 1);
+}
+
+void JournalWriter::Append(string_view _record, Timestamp _time, int _productIndex)
+{
+	size_t length = _record.size();
+	while (length > 0 && _record[length - 1] == '\n') length--;
+
+	if (IsSegmented() && journal_size > 0)
+	{
+		bool full = policy.segmentBytes > 0 && journal_size + _record.size() + 1 > policy.segmentBytes;
+		bool old = policy.segmentMillis > 0 && Now() - segment_started >= policy.segmentMillis;
+		if ((full || old) && !Rotate()) return;
+	}
+
+	journal.write(_record.data(), static_cast<streamsize>(_record.size()));
+	journal.put('\n');
+	journal.flush();
+
+	JournalEntry entry = { _time, journal_size, static_cast<uint32_t>(length), _productIndex };
+	journal_size += _record.size() + 1;
+	entries.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+
+	add_to_block(block, entry, entry_count % JOURNAL_BLOCK_ENTRIES == 0);
+	entry_count++;
+	if (entry_count % JOURNAL_BLOCK_ENTRIES == 0)
+	{
+		blocks.write(reinterpret_cast<const char*>(&block), sizeof(block));
+		blocks.flush();
+	}
+	entries.flush();
+}
+
+bool JournalWriter::IsOpen() const
+{
+	return journal.is_open() && entries.is_open() && blocks.is_open();
+}
+
+const string& JournalWriter::GetFilename() const
+{
+	return filename;
+}
+
+const vector<JournalSegment>& JournalWriter::GetSegments() const
+{
+	return segments;
+}
+
+/**
+ * Range queries over one indexed journal file. The journal and its index files are mapped when
+ * opened, so a query sees the records written up to then; open it again to see later ones.
+ */
+class MappedJournal
+{
+
+private:
+
+	MappedFile journal;
+	MappedFile entries;
+	MappedFile blocks;
+	const JournalEntry* entry_data;
+	const JournalBlock* block_data;
+	uint64_t entry_count;
+	uint64_t block_count;
+
+	// Pass the matching entries of [_begin, _end) to _onRecord; returns how many matched
+	size_t ScanEntries(uint64_t _begin, uint64_t _end, Timestamp _from, Timestamp _to, int _productIndex, const function<void(const JournalEntry&, string_view)>& _onRecord) const;
+
+public:
+
+	MappedJournal();
+
+	// Map a journal and its index; false if either cannot be read
+	bool Open(const string& _filename);
+
+	// Number of indexed records
+	uint64_t GetCount() const;
+
+	// Pass every record of a product (or ALL_PRODUCTS) with a time in [_from, _to] to _onRecord, in journal order; returns how many matched
+	size_t Query(Timestamp _from, Timestamp _to, int _productIndex, const function<void(const JournalEntry&, string_view)>& _onRecord) const;
+
+};
+
+MappedJournal::MappedJournal()
+{
+	entry_data = nullptr;
+	block_data = nullptr;
+	entry_count = 0;
+	block_count = 0;
+}
+
+bool MappedJournal::Open(const string& _filename)
+{
+	if (!journal.Open(_filename) || !entries.Open(_filename + ".idx") || !blocks.Open(_filename + ".blk")) return false;
+
+	entry_data = reinterpret_cast<const JournalEntry*>(entries.GetData());
+	block_data = reinterpret_cast<const JournalBlock*>(blocks.GetData());
+	entry_count = entries.GetSize() / sizeof(JournalEntry);
+	block_count = blocks.GetSize() / sizeof(JournalBlock);
+	if (block_count > entry_count / JOURNAL_BLOCK_ENTRIES) block_count = entry_count / JOURNAL_BLOCK_ENTRIES;
+	return true;
+}
+
+uint64_t MappedJournal::GetCount() const
+{
+	return entry_count;
+}
+
+size_t MappedJournal::ScanEntries(uint64_t _begin, uint64_t _end, Timestamp _from, Timestamp _to, int _productIndex, const function<void(const JournalEntry&, string_view)>& _onRecord) const
+{
+	size_t matched = 0;
+	for (uint64_t i = _begin; i < _end; i++)
+	{
+		const JournalEntry& entry = entry_data[i];
+		if (entry.time < _from || entry.time > _to) continue;
+		if (_productIndex != ALL_PRODUCTS && entry.productIndex != _productIndex) continue;
+		if (entry.offset + entry.length > journal.GetSize()) continue;
+
+		matched++;
+		if (_onRecord) _onRecord(entry, string_view(journal.GetData() + entry.offset, entry.length));
+	}
+	return matched;
+}
+
+size_t MappedJournal::Query(Timestamp _from, Timestamp _to, int _productIndex, const function<void(const JournalEntry&, string_view)>& _onRecord) const
+{
+	size_t matched = 0;
+	uint64_t product_bit = _productIndex == ALL_PRODUCTS ? ~0ull : journal_product_bit(_productIndex);
+
+	//only the blocks whose time range and products can match are read
+	for (uint64_t b = 0; b < block_count; b++)
+	{
+		const JournalBlock& block = block_data[b];
+		if (block.maxTime < _from || block.minTime > _to || (block.productMask & product_bit) == 0) continue;
+		matched += ScanEntries(b * JOURNAL_BLOCK_ENTRIES, (b + 1) * JOURNAL_BLOCK_ENTRIES, _from, _to, _productIndex, _onRecord);
+	}
+
+	//entries after the last full block have no summary yet
+	matched += ScanEntries(block_count * JOURNAL_BLOCK_ENTRIES, entry_count, _from, _to, _productIndex, _onRecord);
+	return matched;
+}
+
+/**
+ * Range queries over a journal, whole or split into segments. Segments are chosen from the
+ * catalog when opened and only those whose time range and products can match are mapped by a
+ * query; the segment being written is always read.
+ */
+class JournalQuery
+{
+
+private:
+
+	vector<string> filenames;
+	vector<JournalSegment> segments; //summary of each file; the one being written matches everything
+
+public:
+
+	// Find the files of a journal; false if it has none
+	bool Open(const string& _filename);
+
+	// Number of indexed records
+	uint64_t GetCount() const;
+
+	// Number of files the journal is split into
+	size_t GetSegmentCount() const;
+
+	// Pass every record of a product (or ALL_PRODUCTS) with a time in [_from, _to] to _onRecord, oldest segment first; returns how many matched
+	size_t Query(Timestamp _from, Timestamp _to, int _productIndex, const function<void(const JournalEntry&, string_view)>& _onRecord) const;
+
+};
+
+bool JournalQuery::Open(const string& _filename)
+{
+	filenames.clear();
+	segments.clear();
+
+	//a journal without a catalog is a single file
+	error_code error;
+	if (!filesystem::exists(journal_catalog_filename(_filename), error))
+	{
+		if (!filesystem::exists(_filename + ".idx", error)) return false;
+		filenames.push_back(_filename);
+		segments.push_back(JournalSegment{ 0, INT64_MIN, INT64_MAX, ~0ull, filesystem::file_size(_filename + ".idx", error) / sizeof(JournalEntry), 0 });
+		return true;
+	}
+
+	segments = read_journal_segments(_filename);
+	for (const JournalSegment& segment : segments) filenames.push_back(journal_segment_filename(_filename, segment.sequence));
+
+	uint64_t current = segments.empty() ? 1 : segments.back().sequence + 1;
+	string current_filename = journal_segment_filename(_filename, current);
+	if (filesystem::exists(current_filename + ".idx", error))
+	{
+		filenames.push_back(current_filename);
+		segments.push_back(JournalSegment{ current, INT64_MIN, INT64_MAX, ~0ull, filesystem::file_size(current_filename + ".idx", error) / sizeof(JournalEntry), 0 });
+	}
+	return true;
+}
+
+uint64_t JournalQuery::GetCount() const
+{
+	uint64_t count = 0;
+	for (const JournalSegment& segment : segments) count += segment.records;
+	return count;
+}
+
+size_t JournalQuery::GetSegmentCount() const
+{
+	return filenames.size();
+}
+
+size_t JournalQuery::Query(Timestamp _from, Timestamp _to, int _productIndex, const function<void(const JournalEntry&, string_view)>& _onRecord) const
+{
+	size_t matched = 0;
+	uint64_t product_bit = _productIndex == ALL_PRODUCTS ? ~0ull : journal_product_bit(_productIndex);
+	for (size_t i = 0; i < filenames.size(); i++)
+	{
+		const JournalSegment& segment = segments[i];
+		if (segment.maxTime < _from || segment.minTime > _to || (segment.productMask & product_bit) == 0) continue;
+
+		//a segment deleted by the writer's retention since the catalog was read is skipped
+		MappedJournal journal;
+		if (!journal.Open(filenames[i])) continue;
+		matched += journal.Query(_from, _to, _productIndex, _onRecord);
+	}
+	return matched;
+}
+
+#endif
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include "journalindex.hpp"
+#include "columnstore.hpp"
+#include "..\bondstaticdata.hpp"
+
+// Range query over an indexed journal: prints the records of a product with an event time in [from, to] (ms since epoch).
+// With --sum, sums a column over the same selection instead, across the column directories of every
+// segment of the journal (or of one column directory).
+// usage: historicalquery journal [ticker|all] [from] [to] [security master file]
+//        historicalquery --sum journal|directory column [ticker|all] [from] [to] [security master file]
+int main(int argc, char* argv[]) {
+
+    bool sum = argc > 1 && std::string(argv[1]) == "--sum";
+    int first = sum ? 3 : 1;
+    if (argc <= first)
+    {
+        std::cerr << "usage: historicalquery journal [ticker|all] [from] [to] [security master file]" << std::endl;
+        std::cerr << "       historicalquery --sum journal|directory column [ticker|all] [from] [to] [security master file]" << std::endl;
+        return 1;
+    }
+
+    std::string filename = sum ? argv[2] : argv[1];
+    std::string ticker = argc > first + 1 ? argv[first + 1] : "all";
+    Timestamp from = argc > first + 2 ? std::stoll(argv[first + 2]) : 0;
+    Timestamp to = argc > first + 3 ? std::stoll(argv[first + 3]) : INT64_MAX;
+    if (argc > first + 4 && !load_security_master(argv[first + 4])) return 1;
+
+    int product_index = ALL_PRODUCTS;
+    if (ticker != "all")
+    {
+        product_index = get_ticker_index(ticker);
+        if (product_index < 0)
+        {
+            std::cerr << "Unknown ticker " << ticker << std::endl;
+            return 1;
+        }
+    }
+
+    if (sum)
+    {
+        ColumnJournal columns;
+        if (!columns.Open(filename) || !columns.HasColumn(argv[3]))
+        {
+            std::cerr << "Failed to open column " << argv[3] << " of " << filename << std::endl;
+            return 1;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        double total = columns.Sum(argv[3], product_index, from, to);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        std::cout << total << std::endl;
+        std::cerr << "Summed " << columns.GetRows() << " records in " << columns.GetTables().size() << " segments in " << elapsed.count() << " us" << std::endl;
+        return 0;
+    }
+
+    JournalQuery query;
+    if (!query.Open(filename))
+    {
+        std::cerr << "Failed to open " << filename << " and its index" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t matched = query.Query(from, to, product_index, [](const JournalEntry& _entry, string_view _record)
+    {
+        std::cout << _record << "\n";
+    });
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    std::cerr << matched << " of " << query.GetCount() << " records in " << elapsed.count() << " us" << std::endl;
+    return 0;
+}
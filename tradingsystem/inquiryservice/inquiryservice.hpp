@@ -8,8 +8,17 @@
 #ifndef INQUIRY_SERVICE_HPP
 #define INQUIRY_SERVICE_HPP
 
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
 #include "..\soa.hpp"
+#include "..\csvtokenizer.hpp"
+#include "..\slottable.hpp"
+#include "..\uuid.hpp"
 #include "..\tradebookingservice\tradebookingservice.hpp"
+#include "..\tradebookingservice\positionservice.hpp"
+#include "..\pricingservice\pricingservice.hpp"
 #include "..\bondstaticdata.hpp"
 #include "..\util.hpp"
 
@@ -27,13 +36,13 @@ class Inquiry
 public:
 
   // ctor for an inquiry
-  Inquiry(string _inquiryId, const T &_product, Side _side, long _quantity, double _price, InquiryState _state);
+  Inquiry(const Uuid &_inquiryId, const T &_product, Side _side, long _quantity, double _price, InquiryState _state);
 
   //default ctor
   Inquiry() = default;
 
   // Get the inquiry ID
-  const string& GetInquiryId() const;
+  const Uuid& GetInquiryId() const;
 
   // Get the product
   const T& GetProduct() const;
@@ -56,24 +65,37 @@ public:
   //set the state of inquiry
   void SetState(InquiryState _state);
 
+  // Get the event time of the inquiry
+  Timestamp GetTimestamp() const;
+
+  // Set the event time of the inquiry
+  void SetTimestamp(Timestamp _timestamp);
+
   //key used to persist data in historical data service
   string GetPersistKey() const;
 
   //data persisted in historical data service
   string GetPersistData() const;
 
+  //numeric columns persisted in historical data service
+  static vector<string> GetPersistColumns();
+
+  //values of the persisted columns, in the order of GetPersistColumns
+  void GetPersistValues(double* _values) const;
+
 private:
-  string inquiryId;
-  T product;
+  Uuid inquiryId;
+  ProductRef<T> product;
   Side side;
   long quantity;
   double price;
   InquiryState state;
+  Timestamp timestamp = NO_TIMESTAMP;
 
 };
 
 template<typename T>
-Inquiry<T>::Inquiry(string _inquiryId, const T& _product, Side _side, long _quantity, double _price, InquiryState _state) :
+Inquiry<T>::Inquiry(const Uuid& _inquiryId, const T& _product, Side _side, long _quantity, double _price, InquiryState _state) :
 	product(_product)
 {
 	inquiryId = _inquiryId;
@@ -84,7 +106,7 @@ Inquiry<T>::Inquiry(string _inquiryId, const T& _product, Side _side, long _quan
 }
 
 template<typename T>
-const string& Inquiry<T>::GetInquiryId() const
+const Uuid& Inquiry<T>::GetInquiryId() const
 {
 	return inquiryId;
 }
@@ -92,7 +114,7 @@ const string& Inquiry<T>::GetInquiryId() const
 template<typename T>
 const T& Inquiry<T>::GetProduct() const
 {
-	return product;
+	return product.Get();
 }
 
 template<typename T>
@@ -133,23 +155,33 @@ void Inquiry<T>::SetState(InquiryState _state)
 	state = _state;
 }
 
+template<typename T>
+Timestamp Inquiry<T>::GetTimestamp() const
+{
+	return timestamp;
+}
+
+template<typename T>
+void Inquiry<T>::SetTimestamp(Timestamp _timestamp)
+{
+	timestamp = _timestamp;
+}
 
 //key used to persist data in historical data service
 template<typename T>
 string Inquiry<T>::GetPersistKey() const
 {
-	return inquiryId;
+	return uuid_to_string(inquiryId);
 }
 
 //data persisted in historical data service
 template<typename T>
 string Inquiry<T>::GetPersistData() const
 {
-	auto now = std::chrono::system_clock::now();
-	string s = timeToString(now) + " , " + this->GetPersistKey() + " , ";
+	string s = timeToString(timestamp) + " , " + this->GetPersistKey() + " , ";
 	
 	s += (side == BUY ? "BUY" : "SELL");
-	s += (", Qty :" + std::to_string(side));
+	s += (", Qty :" + std::to_string(quantity));
 	s += " , Price : " + decimal_to_fractional(price);
 	s += ", State : ";
 	if (state == RECEIVED) s += "RECEIVED";
@@ -161,12 +193,88 @@ string Inquiry<T>::GetPersistData() const
 	return s;
 }
 
+template<typename T>
+vector<string> Inquiry<T>::GetPersistColumns()
+{
+	return { "side", "quantity", "price", "state" };
+}
+
+template<typename T>
+void Inquiry<T>::GetPersistValues(double* _values) const
+{
+	_values[0] = side;
+	_values[1] = quantity;
+	_values[2] = price;
+	_values[3] = state;
+}
+
+// Number of inquiry size tiers; the last tier has no upper bound
+const int INQUIRY_SIZE_TIERS = 4;
+
+/**
+ * Parameters of inquiry pricing.
+ * The quote is the streamed mid, skewed by inventory, plus or minus half the streamed spread
+ * widened by the size tier of the inquiry.
+ */
+struct InquiryPricingParameters
+{
+	long tierSizes[INQUIRY_SIZE_TIERS - 1]; //upper bound of each tier but the last
+	double tierSpreads[INQUIRY_SIZE_TIERS]; //multiple of the streamed spread for each tier
+	long maxPosition; //aggregate position at which the skew is full
+	double maxSkew; //mid shift at full skew, in half spreads
+};
+
+const InquiryPricingParameters DEFAULT_INQUIRY_PRICING = { { 1000000, 5000000, 25000000 }, { 1.0, 1.25, 1.5, 2.0 }, 100000000, 1.0 };
+
+// Events driving the inquiry state machine
+enum InquiryEventType { INQUIRY_RECEIVED, INQUIRY_QUOTE, INQUIRY_REJECT, INQUIRY_CLIENT_ACCEPT, INQUIRY_CLIENT_REJECT, INQUIRY_TIMEOUT };
+
+// An event queued for a live inquiry; price is only used by INQUIRY_QUOTE
+struct InquiryEvent
+{
+	SlotHandle handle;
+	InquiryEventType type;
+	double price;
+};
+
+/**
+ * A live inquiry with its pending timeout.
+ * Type T is the product type.
+ */
+template<typename T>
+struct InquiryRecord
+{
+	Inquiry<T> inquiry;
+	TimerHandle timer;
+};
+
 //pre-declarations
 template<typename T>
 class InquiryDataConnector;
 
+template<typename T>
+class InquiryTimerListener;
+
+template<typename T>
+class InquiryToPricingListener;
+
+template<typename T>
+class InquiryToPositionListener;
+
 /**
  * Service for customer inquirry objects.
+ * Each inquiry goes through an explicit state machine, RECEIVED -> QUOTED -> DONE or
+ * CUSTOMER_REJECTED, with REJECTED when we decline to quote. Everything that moves an inquiry
+ * (new inquiries, quotes, client responses, timeouts) is an event on a queue that the service
+ * drains in order, so a transition never re-enters the service and listeners see every state
+ * exactly once. An inquiry left waiting, for a quote or for the client, longer than the timeout is
+ * rejected or customer rejected by a timer.
+ * Live inquiries are kept in a slot table, found through an open addressing index on the 128 bit
+ * inquiry id, and released once they reach a final state, so memory follows the number of open
+ * inquiries, not the number ever received. Ids are only rendered back to text when persisted.
+ * Inquiries are quoted from the latest mid/spread of the PricingService and the inventory of the
+ * PositionService, both kept per product in a flat array indexed by get_product_index so a quote
+ * is computed in constant time. Inquiries on products without a price yet are rejected.
  * Keyed on inquiry identifier (NOTE: this is NOT a product identifier since each inquiry must be unique).
  * Type T is the product type.
  */
@@ -174,22 +282,68 @@ template<typename T>
 class InquiryService : public Service<string,Inquiry <T> >
 {
 private:
-	map<string, Inquiry<T>> inquiries;
+	SlotTable<InquiryRecord<T>> inquiry_table;
+	UuidIndex inquiry_index; //inquiry id to live inquiry
+	vector<InquiryEvent> events; //queue read from next_event, cleared once drained so its storage is reused
+	size_t next_event;
+	bool processing_events;
+	Inquiry<T> no_inquiry; //returned by GetData for ids that are not live
 	vector<ServiceListener<Inquiry<T>>*> listeners;
 	InquiryDataConnector<T>* connector;
+	InquiryToPricingListener<T>* pricing_listener;
+	InquiryToPositionListener<T>* position_listener;
+	InquiryTimerListener<T>* timer_listener;
+	Clock* clock;
+	TimerWheel* timer_wheel;
+	Timestamp timeout;
+
+	// Queue an event for a live inquiry and process the queue unless it is already being processed
+	void PostEvent(SlotHandle _handle, InquiryEventType _type, double _price = 0);
+
+	// Apply one event to its inquiry
+	void ProcessEvent(const InquiryEvent& _event);
+
+	// Notify listeners of the state of an inquiry
+	void Notify(Inquiry<T>& _inquiry);
+
+	// Restart the timeout of an inquiry
+	void ArmTimeout(InquiryRecord<T>& _record, SlotHandle _handle);
+
+	// Release an inquiry that reached a final state
+	void RetireInquiry(SlotHandle _handle);
+
+	struct InquiryPricingState
+	{
+		double mid;
+		double spread;
+		bool hasPrice;
+		long position;
+	};
+
+	InquiryPricingParameters pricing_parameters;
+	vector<InquiryPricingState> pricing_states;
 
 public:
 
-	// Constructor and destructor
-	InquiryService();
+	// Constructor and destructor; _timeout is how long, in milliseconds, an inquiry waits for a quote or a client response
+	InquiryService(Timestamp _timeout = 30000, Clock* _clock = &DefaultClock(), size_t _expectedInquiries = 1024);
 	~InquiryService();
 
-	// Get data on our service given a key
+	// Get a live inquiry given its id
 	Inquiry<T>& GetData(string _key);
 
-	// The callback that a Connector should invoke for any new or updated data
+	// The callback that a Connector should invoke for new inquiries (RECEIVED) and client responses (DONE, CUSTOMER_REJECTED)
 	void OnMessage(Inquiry<T>& _data);
 
+	// Client response to a quote, DONE to accept or CUSTOMER_REJECTED
+	void OnClientResponse(const Uuid &inquiryId, InquiryState _state);
+
+	// Timeout of a live inquiry
+	void OnTimeout(SlotHandle _handle);
+
+	// Number of live inquiries
+	size_t GetLiveInquiryCount() const;
+
 	// Add a listener to the Service for callbacks on add, remove, and update events for data to the Service
 	void AddListener(ServiceListener<Inquiry<T>>* _listener);
 
@@ -200,21 +354,60 @@ public:
 	// Get all listeners on the Service
 	const vector<ServiceListener<Inquiry<T>>*>& GetListeners() const;
 
+	// Get the clock used to timestamp inquiries
+	Clock* GetClock() const;
+
+	// Get the listener to prices from the pricing service
+	InquiryToPricingListener<T>* GetPricingListener();
+
+	// Get the listener to position changes from the position service
+	InquiryToPositionListener<T>* GetPositionListener();
+
+	// Set the parameters of inquiry pricing
+	void SetPricingParameters(const InquiryPricingParameters& _parameters);
+
+	// Price an inquiry; false if there is no price for its product yet
+	bool PriceInquiry(const Inquiry<T>& _inquiry, double& _price) const;
+
+	// Keep the latest mid/spread of a product
+	void UpdatePrice(Price<T>& _price);
+
+	// Apply a position change booked on a product
+	void AddPosition(Position<T>& _position);
+
 	// Send a quote back to the client
-	void SendQuote(const string &inquiryId, double price);
+	void SendQuote(const Uuid &inquiryId, double price);
 
 	// Reject an inquiry from the client
-	void RejectInquiry(const string &inquiryId);
+	void RejectInquiry(const Uuid &inquiryId);
 
 };
 
 template<typename T>
-InquiryService<T>::InquiryService()
+InquiryService<T>::InquiryService(Timestamp _timeout, Clock* _clock, size_t _expectedInquiries) :
+	inquiry_table(_expectedInquiries), inquiry_index(_expectedInquiries)
 {
-	inquiries = map<string, Inquiry<T>>();
+	clock = _clock;
+	timer_wheel = clock->GetTimerWheel() != nullptr ? clock->GetTimerWheel() : &SharedTimerWheel();
+	timeout = _timeout;
+	events = vector<InquiryEvent>();
+	next_event = 0;
+	processing_events = false;
 	listeners = vector<ServiceListener<Inquiry<T>>*>();
 	connector = new InquiryDataConnector<T>(this);
+	pricing_listener = new InquiryToPricingListener<T>(this);
+	position_listener = new InquiryToPositionListener<T>(this);
+	timer_listener = new InquiryTimerListener<T>(this);
 
+	pricing_parameters = DEFAULT_INQUIRY_PRICING;
+	pricing_states = vector<InquiryPricingState>(get_product_count());
+	for (auto& state : pricing_states)
+	{
+		state.mid = 0;
+		state.spread = 0;
+		state.hasPrice = false;
+		state.position = 0;
+	}
 }
 
 template<typename T>
@@ -223,27 +416,159 @@ InquiryService<T>::~InquiryService() {}
 template<typename T>
 Inquiry<T>& InquiryService<T>::GetData(string _key)
 {
-	return inquiries[_key];
+	Uuid inquiry_id;
+	if (!parse_uuid(_key, inquiry_id)) return no_inquiry;
+
+	InquiryRecord<T>* record = inquiry_table.Get(inquiry_index.Find(inquiry_id));
+	return record != nullptr ? record->inquiry : no_inquiry;
 }
 
 template<typename T>
 void InquiryService<T>::OnMessage(Inquiry<T>& _data)
 {
-	string inquiry_id = _data.GetInquiryId();
-	inquiries[inquiry_id] = _data;
+	if (_data.GetState() != RECEIVED)
+	{
+		OnClientResponse(_data.GetInquiryId(), _data.GetState());
+		return;
+	}
+
+	//a new inquiry; an id that is already live is a duplicate and ignored
+	if (inquiry_index.Find(_data.GetInquiryId()) != INVALID_SLOT_HANDLE) return;
+
+	SlotHandle handle = inquiry_table.Allocate(InquiryRecord<T>{ _data, INVALID_TIMER_HANDLE });
+	inquiry_index.Insert(_data.GetInquiryId(), handle);
+	PostEvent(handle, INQUIRY_RECEIVED);
+}
+
+template<typename T>
+void InquiryService<T>::OnClientResponse(const Uuid& inquiryId, InquiryState _state)
+{
+	SlotHandle handle = inquiry_index.Find(inquiryId);
+	if (handle == INVALID_SLOT_HANDLE) return;
+
+	if (_state == DONE) PostEvent(handle, INQUIRY_CLIENT_ACCEPT);
+	else if (_state == CUSTOMER_REJECTED) PostEvent(handle, INQUIRY_CLIENT_REJECT);
+}
+
+template<typename T>
+void InquiryService<T>::OnTimeout(SlotHandle _handle)
+{
+	InquiryRecord<T>* record = inquiry_table.Get(_handle);
+	if (record == nullptr) return;
+
+	record->timer = INVALID_TIMER_HANDLE;
+	PostEvent(_handle, INQUIRY_TIMEOUT);
+}
+
+template<typename T>
+size_t InquiryService<T>::GetLiveInquiryCount() const
+{
+	return inquiry_table.Size();
+}
+
+template<typename T>
+void InquiryService<T>::PostEvent(SlotHandle _handle, InquiryEventType _type, double _price)
+{
+	events.push_back(InquiryEvent{ _handle, _type, _price });
+	if (processing_events) return;
+
+	//events posted while processing, e.g. by listeners or the connector, join the queue
+	processing_events = true;
+	while (next_event < events.size())
+	{
+		//copied out, as processing may post more events and grow the queue
+		InquiryEvent event = events[next_event++];
+		ProcessEvent(event);
+	}
+	events.clear();
+	next_event = 0;
+	processing_events = false;
+}
+
+template<typename T>
+void InquiryService<T>::ProcessEvent(const InquiryEvent& _event)
+{
+	InquiryRecord<T>* record = inquiry_table.Get(_event.handle);
+	if (record == nullptr) return; //the inquiry already reached a final state
+
+	Inquiry<T>& inquiry = record->inquiry;
+	InquiryState state = inquiry.GetState();
 
-	//only send quote when the inquiry is in RECEIVED state
-	if (_data.GetState() == RECEIVED)
+	switch (_event.type)
 	{
-		SendQuote(inquiry_id, 100);
+	case INQUIRY_RECEIVED:
+	{
+		Notify(inquiry);
+		ArmTimeout(*record, _event.handle);
+
+		double price;
+		if (PriceInquiry(inquiry, price)) PostEvent(_event.handle, INQUIRY_QUOTE, price);
+		else PostEvent(_event.handle, INQUIRY_REJECT);
+		break;
 	}
+	case INQUIRY_QUOTE:
+		if (state != RECEIVED) break;
+		inquiry.SetPrice(_event.price);
+		inquiry.SetState(QUOTED);
+		ArmTimeout(*record, _event.handle);
+		Notify(inquiry);
+
+		//send the quote to the client
+		connector->Publish(inquiry);
+		break;
+	case INQUIRY_REJECT:
+		if (state != RECEIVED && state != QUOTED) break;
+		inquiry.SetState(REJECTED);
+		Notify(inquiry);
+		RetireInquiry(_event.handle);
+		break;
+	case INQUIRY_CLIENT_ACCEPT:
+		if (state != QUOTED) break;
+		inquiry.SetState(DONE);
+		Notify(inquiry);
+		RetireInquiry(_event.handle);
+		break;
+	case INQUIRY_CLIENT_REJECT:
+		if (state != QUOTED) break;
+		inquiry.SetState(CUSTOMER_REJECTED);
+		Notify(inquiry);
+		RetireInquiry(_event.handle);
+		break;
+	case INQUIRY_TIMEOUT:
+		//no quote in time: we reject; no answer to the quote in time: the quote lapses
+		inquiry.SetState(state == QUOTED ? CUSTOMER_REJECTED : REJECTED);
+		Notify(inquiry);
+		RetireInquiry(_event.handle);
+		break;
+	}
+}
 
+template<typename T>
+void InquiryService<T>::Notify(Inquiry<T>& _inquiry)
+{
 	for (auto& l : listeners)
 	{
-		l->ProcessAdd(_data);
+		l->ProcessAdd(_inquiry);
 	}
 }
 
+template<typename T>
+void InquiryService<T>::ArmTimeout(InquiryRecord<T>& _record, SlotHandle _handle)
+{
+	if (_record.timer != INVALID_TIMER_HANDLE) timer_wheel->Cancel(_record.timer);
+	_record.timer = timeout > 0 ? timer_wheel->Schedule(clock->Now() + timeout, timer_listener, _handle) : INVALID_TIMER_HANDLE;
+}
+
+template<typename T>
+void InquiryService<T>::RetireInquiry(SlotHandle _handle)
+{
+	InquiryRecord<T>* record = inquiry_table.Get(_handle);
+	if (record->timer != INVALID_TIMER_HANDLE) timer_wheel->Cancel(record->timer);
+
+	inquiry_index.Erase(record->inquiry.GetInquiryId());
+	inquiry_table.Release(_handle);
+}
+
 template<typename T>
 void InquiryService<T>::AddListener(ServiceListener<Inquiry<T>>* _listener)
 {
@@ -262,37 +587,242 @@ InquiryDataConnector<T>* InquiryService<T>::GetConnector() const
 	return connector;
 }
 
-// Send a quote back to the client
 template<typename T>
-void InquiryService<T>::SendQuote(const string& inquiryId, double price)
+Clock* InquiryService<T>::GetClock() const
 {
-	Inquiry<T> inquiry = inquiries[inquiryId];
-	inquiry.SetPrice(price);
+	return clock;
+}
+
+template<typename T>
+InquiryToPricingListener<T>* InquiryService<T>::GetPricingListener()
+{
+	return pricing_listener;
+}
+
+template<typename T>
+InquiryToPositionListener<T>* InquiryService<T>::GetPositionListener()
+{
+	return position_listener;
+}
 
-	//publish the quote to connector
-	connector->Publish(inquiry);
+template<typename T>
+void InquiryService<T>::SetPricingParameters(const InquiryPricingParameters& _parameters)
+{
+	pricing_parameters = _parameters;
+}
+
+template<typename T>
+bool InquiryService<T>::PriceInquiry(const Inquiry<T>& _inquiry, double& _price) const
+{
+	int index = get_product_index(_inquiry.GetProduct().GetProductId());
+	if (index < 0 || !pricing_states[index].hasPrice) return false;
+
+	const InquiryPricingState& state = pricing_states[index];
+	const InquiryPricingParameters& parameters = pricing_parameters;
+	double half_spread = state.spread / 2.0;
+
+	//skew the mid against the inventory: when long, quote lower to sell and not to buy more
+	double skew = parameters.maxPosition > 0 ? (double)state.position / parameters.maxPosition : 0;
+	skew = std::clamp(skew, -1.0, 1.0);
+	double mid = state.mid - skew * parameters.maxSkew * half_spread;
+
+	int tier = 0;
+	while (tier < INQUIRY_SIZE_TIERS - 1 && _inquiry.GetQuantity() > parameters.tierSizes[tier]) tier++;
+	double half_width = half_spread * parameters.tierSpreads[tier];
+
+	//the client buys at our offer and sells at our bid
+	_price = _inquiry.GetSide() == BUY ? mid + half_width : mid - half_width;
+	return true;
+}
+
+template<typename T>
+void InquiryService<T>::UpdatePrice(Price<T>& _price)
+{
+	int index = get_product_index(_price.GetProduct().GetProductId());
+	if (index < 0) return;
+
+	pricing_states[index].mid = _price.GetMid();
+	pricing_states[index].spread = _price.GetBidOfferSpread();
+	pricing_states[index].hasPrice = true;
+}
+
+template<typename T>
+void InquiryService<T>::AddPosition(Position<T>& _position)
+{
+	//position service listeners get the change from a trade, not the total
+	int index = get_product_index(_position.GetProduct().GetProductId());
+	if (index >= 0) pricing_states[index].position += _position.GetAggregatePosition();
+}
+
+// Send a quote back to the client
+template<typename T>
+void InquiryService<T>::SendQuote(const Uuid& inquiryId, double price)
+{
+	SlotHandle handle = inquiry_index.Find(inquiryId);
+	if (handle != INVALID_SLOT_HANDLE) PostEvent(handle, INQUIRY_QUOTE, price);
 }
 
 // Reject an inquiry from the client
 template<typename T>
-void InquiryService<T>::RejectInquiry(const string& inquiryId)
+void InquiryService<T>::RejectInquiry(const Uuid& inquiryId)
+{
+	SlotHandle handle = inquiry_index.Find(inquiryId);
+	if (handle != INVALID_SLOT_HANDLE) PostEvent(handle, INQUIRY_REJECT);
+}
+
+/**
+* InquiryTimerListener receives the inquiry timeouts of InquiryService.
+* The timer context is the slot handle of the inquiry.
+* Type T is the product type.
+*/
+template<typename T>
+class InquiryTimerListener : public TimerListener
+{
+
+private:
+
+	InquiryService<T>* service;
+
+public:
+
+	// Constructor
+	InquiryTimerListener(InquiryService<T>* _service);
+
+	// Timer callback
+	void ProcessTimer(uint64_t _context, long long _now);
+
+};
+
+template<typename T>
+InquiryTimerListener<T>::InquiryTimerListener(InquiryService<T>* _service)
+{
+	service = _service;
+}
+
+template<typename T>
+void InquiryTimerListener<T>::ProcessTimer(uint64_t _context, long long _now)
+{
+	service->OnTimeout(_context);
+}
+
+/**
+* InquiryToPricingListener keeps the latest prices from PricingService.
+* Type T is the product type.
+*/
+template<typename T>
+class InquiryToPricingListener : public ServiceListener<Price<T>>
+{
+
+private:
+
+	InquiryService<T>* service;
+
+public:
+
+	// Connector and Destructor
+	InquiryToPricingListener(InquiryService<T>* _service);
+	~InquiryToPricingListener();
+
+	// Listener callback to process an add event to the Service
+	void ProcessAdd(Price<T>& _data);
+
+	// Listener callback to process a remove event to the Service
+	void ProcessRemove(Price<T>& _data);
+
+	// Listener callback to process an update event to the Service
+	void ProcessUpdate(Price<T>& _data);
+
+};
+
+template<typename T>
+InquiryToPricingListener<T>::InquiryToPricingListener(InquiryService<T>* _service)
+{
+	service = _service;
+}
+
+template<typename T>
+InquiryToPricingListener<T>::~InquiryToPricingListener() {}
+
+template<typename T>
+void InquiryToPricingListener<T>::ProcessAdd(Price<T>& _data)
+{
+	service->UpdatePrice(_data);
+}
+
+template<typename T>
+void InquiryToPricingListener<T>::ProcessRemove(Price<T>& _data) {}
+
+template<typename T>
+void InquiryToPricingListener<T>::ProcessUpdate(Price<T>& _data) {}
+
+/**
+* InquiryToPositionListener listens to position changes from PositionService.
+* Type T is the product type.
+*/
+template<typename T>
+class InquiryToPositionListener : public ServiceListener<Position<T>>
+{
+
+private:
+
+	InquiryService<T>* service;
+
+public:
+
+	// Connector and Destructor
+	InquiryToPositionListener(InquiryService<T>* _service);
+	~InquiryToPositionListener();
+
+	// Listener callback to process an add event to the Service
+	void ProcessAdd(Position<T>& _data);
+
+	// Listener callback to process a remove event to the Service
+	void ProcessRemove(Position<T>& _data);
+
+	// Listener callback to process an update event to the Service
+	void ProcessUpdate(Position<T>& _data);
+
+};
+
+template<typename T>
+InquiryToPositionListener<T>::InquiryToPositionListener(InquiryService<T>* _service)
+{
+	service = _service;
+}
+
+template<typename T>
+InquiryToPositionListener<T>::~InquiryToPositionListener() {}
+
+template<typename T>
+void InquiryToPositionListener<T>::ProcessAdd(Position<T>& _data)
 {
-	inquiries[inquiryId].SetState(REJECTED);
+	service->AddPosition(_data);
 }
 
+template<typename T>
+void InquiryToPositionListener<T>::ProcessRemove(Position<T>& _data) {}
+
+template<typename T>
+void InquiryToPositionListener<T>::ProcessUpdate(Position<T>& _data) {}
+
 
+/**
+* Inquiry Data Connector subscribing inquiries to Inquiry Service and sending quotes to the client.
+* Type T is the product type.
+*/
 template<typename T>
 class InquiryDataConnector :public Connector<Inquiry<T>>
 {
 private:
 
 	InquiryService<T>* service;
+	long long skipped_count;
 
 
 public:
 
-	InquiryDataConnector<T>(InquiryService<T>* _service);
-	~InquiryDataConnector<T>();
+	InquiryDataConnector(InquiryService<T>* _service);
+	~InquiryDataConnector();
 
 	// Publish data to the Connector
 	void Publish(Inquiry<T>& _data);
@@ -300,6 +830,16 @@ public:
 	// Subscribe data from the Connector
 	void Subscribe(ifstream& _data);
 
+	// Parse one line of inquiry data and pass the inquiry to the service
+	void OnLine(const string& _line);
+
+	// Handle the fields of one line of inquiry data; lines with too few fields, a malformed id, an
+	// unknown product or a bad price are skipped
+	void OnFields(const CsvLine& _line);
+
+	// Number of malformed lines skipped
+	long long GetSkippedCount() const;
+
 };
 
 
@@ -307,6 +847,7 @@ template<typename T>
 InquiryDataConnector<T>::InquiryDataConnector(InquiryService<T>* _service)
 {
 	service = _service;
+	skipped_count = 0;
 }
 
 template<typename T>
@@ -315,17 +856,8 @@ InquiryDataConnector<T>::~InquiryDataConnector() {}
 template<typename T>
 void InquiryDataConnector<T>::Publish(Inquiry<T>& _data) 
 {
-
-	//transition the inquiry to Quoted State
-	_data.SetState(QUOTED);
-
-	//send the inquiry back to service
-	service->OnMessage(_data);
-
-	//immediately set the state to done and send back
-	_data.SetState(DONE);
-
-	service->OnMessage(_data);
+	//the simulated client accepts every quote straight away
+	service->OnClientResponse(_data.GetInquiryId(), DONE);
 }
 
 template<typename T>
@@ -336,26 +868,52 @@ void InquiryDataConnector<T>::Subscribe(ifstream& _data)
 		return;
 	}
 
-	std::string line;
-	while (getline(_data, line)) {
-		std::stringstream ss(line);
-		std::string item;
-		std::vector<std::string> splittedItems;
-
+	long long skipped_before = skipped_count;
+	CsvReader reader;
+	reader.Read(_data, [this](const CsvLine& _line) { OnFields(_line); });
+	if (skipped_count > skipped_before)
+	{
+		std::cerr << "Skipped " << skipped_count - skipped_before << " malformed inquiry lines" << std::endl;
+	}
 
-		while (getline(ss, item, ','))
-		{
-			splittedItems.push_back(item);
-		}
+	_data.close();
+}
 
-		T b = get_product<T>(splittedItems[1]);
-		Side _side = splittedItems[2] == "BUY" ? BUY : SELL;
-		Inquiry<T> inquiry(splittedItems[0], b,  _side, std::stod(splittedItems[3]), fractional_to_decimal(splittedItems[4]), RECEIVED);
-		service->OnMessage(inquiry);
+template<typename T>
+void InquiryDataConnector<T>::OnLine(const string& _line)
+{
+	CsvLine fields;
+	tokenize_line(_line.data(), _line.data() + _line.size(), fields);
+	OnFields(fields);
+}
 
+template<typename T>
+void InquiryDataConnector<T>::OnFields(const CsvLine& _line)
+{
+	Uuid inquiry_id;
+	int index = -1;
+	int ticks = 0;
+	if (_line.count >= 5 && parse_uuid(_line.View(0), inquiry_id)) index = get_ticker_index(_line.View(1));
+	string_view price = _line.View(4);
+	if (index < 0 || !fractional_to_ticks(price.data(), price.size(), ticks))
+	{
+		skipped_count++;
+		return;
 	}
 
-	_data.close();
+	Timestamp event_time = _line.count > 5 ? _line.Integer(5) : NO_TIMESTAMP;
+
+	const T& b = get_product_at<T>(index);
+	Side _side = _line.View(2) == "BUY" ? BUY : SELL;
+	Inquiry<T> inquiry(inquiry_id, b,  _side, _line.Number(3), static_cast<double>(ticks) / TICKS_PER_POINT, RECEIVED);
+	inquiry.SetTimestamp(service->GetClock()->Stamp(event_time));
+	service->OnMessage(inquiry);
+}
+
+template<typename T>
+long long InquiryDataConnector<T>::GetSkippedCount() const
+{
+	return skipped_count;
 }
 
 #endif
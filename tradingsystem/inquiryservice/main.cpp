@@ -4,9 +4,23 @@
 #include <string>
 #include <vector>
 #include "inquiryservice.hpp"
+#include "..\pricingservice\pricingservice.hpp"
 #include "..\historicaldataservice\historicaldataservice.hpp"
+#include "..\filefollower.hpp"
 
-int main() {
+int main(int argc, char* argv[]) {
+
+    //with --follow inquiries appended to the file keep being read until the process is interrupted
+    //with --securities file products come from a security master file instead of the built in treasuries
+    bool follow = false;
+    std::string securities;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--follow") follow = true;
+        else if (std::string(argv[i]) == "--securities" && i + 1 < argc) securities = argv[++i];
+    }
+
+    if (!securities.empty() && !load_security_master(securities)) return 1;
 
     //create a trade booking service and subscribe to the booking connector to get trade data
     InquiryService<Bond>* inquiry_service = new InquiryService<Bond>();
@@ -18,10 +32,28 @@ int main() {
     HistoricalDataService< Inquiry<Bond>>  historical_inquiry_service(InquiryType);
     inquiry_service->AddListener(historical_inquiry_service.GetListener());
 
+    //quote inquiries from the latest prices
+    PricingService<Bond>* bond_pricing_service = new PricingService<Bond>();
+    bond_pricing_service->AddListener(inquiry_service->GetPricingListener());
+
+    std::string prices_filename = "prices.txt";
+    std::ifstream prices_file(prices_filename);
+    bond_pricing_service->GetConnector()->Subscribe(prices_file);
+
     //start reading inquries data
     std::string filename = "inquiries.txt";
-    std::ifstream file(filename);
-    inquiry_data_connector->Subscribe(file);
+    if (follow)
+    {
+        install_stop_handler();
+        FileFollower follower(filename);
+        follower.Follow([&](const string& _line) { inquiry_data_connector->OnLine(_line); },
+            [&] { DefaultClock().AdvanceTimers(); return stop_requested(); });
+    }
+    else
+    {
+        std::ifstream file(filename);
+        inquiry_data_connector->Subscribe(file);
+    }
 
     return 0;
 }
\ No newline at end of file
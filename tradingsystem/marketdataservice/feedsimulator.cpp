@@ -0,0 +1,162 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include "marketdatafeed.hpp"
+
+// Local market data feed: replays marketdata.txt as binary feed packets over UDP or TCP.
+// usage: feedsimulator udp://host:port|tcp://host:port [books per second, 0 for no pacing] [file] [depth] [security master file]
+int main(int argc, char* argv[]) {
+
+    if (argc < 2)
+    {
+        std::cerr << "usage: feedsimulator udp://host:port|tcp://host:port [books per second] [file] [depth] [security master file]" << std::endl;
+        return 1;
+    }
+
+    FeedTransport transport;
+    std::string host;
+    int port;
+    if (!parse_feed_address(argv[1], transport, host, port))
+    {
+        std::cerr << "Bad feed address " << argv[1] << std::endl;
+        return 1;
+    }
+    double rate = argc > 2 ? std::stod(argv[2]) : 100000;
+    std::string filename = argc > 3 ? argv[3] : "marketdata.txt";
+    int depth = argc > 4 ? std::stoi(argv[4]) : 5;
+    if (depth < 1 || depth > FEED_MAX_DEPTH)
+    {
+        std::cerr << "Depth must be between 1 and " << FEED_MAX_DEPTH << std::endl;
+        return 1;
+    }
+    if (argc > 5 && !load_security_master(argv[5])) return 1;
+
+    //build every book first, same layout as MarketDataConnector reads the file
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open file" << std::endl;
+        return 1;
+    }
+
+    std::vector<FeedBookMessage> books;
+    FeedBookMessage book;
+    memset(&book, 0, sizeof(book));
+    int level = 0;
+    std::string line;
+    while (getline(file, line))
+    {
+        std::stringstream ss(line);
+        std::string item;
+        std::vector<std::string> splittedItems;
+        while (getline(ss, item, ','))
+        {
+            splittedItems.push_back(item);
+        }
+        if (splittedItems.size() < 4) continue;
+
+        double mid = fractional_to_decimal(splittedItems[1]);
+        double spread = std::stod(splittedItems[2]);
+        book.bidPrice[level] = mid - spread / 2.0;
+        book.offerPrice[level] = mid + spread / 2.0;
+        book.bidQuantity[level] = std::stoll(splittedItems[3]);
+        book.offerQuantity[level] = std::stoll(splittedItems[3]);
+        level++;
+
+        if (level == depth)
+        {
+            book.productIndex = static_cast<uint16_t>(get_ticker_index(splittedItems[0]));
+            book.depth = static_cast<uint8_t>(depth);
+            book.eventTime = splittedItems.size() > 5 ? std::stoll(splittedItems[5]) : NO_TIMESTAMP;
+            books.push_back(book);
+            memset(&book, 0, sizeof(book));
+            level = 0;
+        }
+    }
+
+    //open the transport: UDP sends to the receiver, TCP waits for it to connect
+    sockaddr_in address;
+    if (!make_feed_address(host, port, address))
+    {
+        std::cerr << "Bad host " << host << std::endl;
+        return 1;
+    }
+
+    int socket_fd;
+    if (transport == FEED_UDP)
+    {
+        socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+        int send_buffer = 4 << 20;
+        setsockopt(socket_fd, SOL_SOCKET, SO_SNDBUF, &send_buffer, sizeof(send_buffer));
+        if (connect(socket_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            std::cerr << "Failed to address " << argv[1] << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd, 1) != 0)
+        {
+            std::cerr << "Failed to listen on " << argv[1] << std::endl;
+            return 1;
+        }
+        socket_fd = accept(listen_fd, nullptr, nullptr);
+        close(listen_fd);
+        if (socket_fd < 0)
+        {
+            std::cerr << "Failed to accept a receiver" << std::endl;
+            return 1;
+        }
+        setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+
+    //send books when they are due, packing the ones due together into one packet
+    std::vector<char> packet(FEED_MAX_PACKET_SIZE);
+    int64_t start = feed_clock_ns();
+    size_t next = 0;
+    long long packets = 0;
+    while (next < books.size())
+    {
+        if (rate > 0)
+        {
+            int64_t due = start + static_cast<int64_t>(next * 1e9 / rate);
+            while (feed_clock_ns() < due) std::this_thread::yield();
+        }
+
+        int64_t now = feed_clock_ns();
+        FeedPacketHeader header = { FEED_MAGIC, 0, 0, next };
+        while (next < books.size() && header.count < FEED_MAX_BOOKS_PER_PACKET && (rate <= 0 || start + static_cast<int64_t>(next * 1e9 / rate) <= now))
+        {
+            books[next].sendTime = now;
+            memcpy(&packet[sizeof(header) + header.count * sizeof(FeedBookMessage)], &books[next], sizeof(FeedBookMessage));
+            header.count++;
+            next++;
+        }
+        memcpy(&packet[0], &header, sizeof(header));
+
+        size_t size = sizeof(header) + header.count * sizeof(FeedBookMessage);
+        if (send(socket_fd, &packet[0], size, 0) != static_cast<ssize_t>(size))
+        {
+            std::cerr << "Failed to send packet " << packets << std::endl;
+        }
+        packets++;
+    }
+
+    //end of stream; repeated over UDP in case one is dropped
+    FeedPacketHeader end = { FEED_MAGIC, 0, FEED_END_OF_STREAM, next };
+    for (int i = 0; i < (transport == FEED_UDP ? 3 : 1); i++)
+    {
+        send(socket_fd, &end, sizeof(end), 0);
+    }
+    close(socket_fd);
+
+    std::cout << "Sent " << books.size() << " books in " << packets << " packets" << std::endl;
+    return 0;
+}
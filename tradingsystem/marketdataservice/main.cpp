@@ -8,31 +8,81 @@
 #include "..\tradebookingservice\tradebookingservice.hpp"
 #include "..\tradebookingservice\positionservice.hpp"
 #include "..\tradebookingservice\riskservice.hpp"
+#include "..\pretraderiskservice\pretraderiskservice.hpp"
 #include "..\historicaldataservice\historicaldataservice.hpp"
+#include "..\filefollower.hpp"
+#ifndef _WIN32
+#include "marketdatafeed.hpp"
+#endif
 
 
-int main() {
+int main(int argc, char* argv[]) {
+
+    //services run on the wall clock, or with --replay on a clock driven by the replayed data
+    //with --shm fills are also published to shared memory for the trade booking process
+    //with --feed udp://host:port or tcp://host:port books come from a binary feed instead of the file,
+    //until it ends, the process is interrupted or no packet arrives for --feed-timeout ms (0 waits forever)
+    //with --follow market data appended to the file keeps being read until the process is interrupted
+    //with --securities file products come from a security master file instead of the built in treasuries
+    //with --parents file the algo also works the TWAP, VWAP and POV parent orders of the file
+    Clock* clock = &DefaultClock();
+    bool publish_fills = false;
+    bool follow = false;
+    std::string feed_address;
+    bool busy_poll = false;
+    long feed_timeout = -1; //FEED_IDLE_TIMEOUT_MS unless given
+    std::string securities;
+    std::string parents;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--replay") clock = new ReplayClock(0, 1, &SharedTimerWheel());
+        else if (std::string(argv[i]) == "--shm") publish_fills = true;
+        else if (std::string(argv[i]) == "--feed" && i + 1 < argc) feed_address = argv[++i];
+        else if (std::string(argv[i]) == "--busy-poll") busy_poll = true;
+        else if (std::string(argv[i]) == "--feed-timeout" && i + 1 < argc) feed_timeout = std::stol(argv[++i]);
+        else if (std::string(argv[i]) == "--follow") follow = true;
+        else if (std::string(argv[i]) == "--securities" && i + 1 < argc) securities = argv[++i];
+        else if (std::string(argv[i]) == "--parents" && i + 1 < argc) parents = argv[++i];
+    }
+
+    if (!securities.empty() && !load_security_master(securities)) return 1;
 
     //create a trade booking service and subscribe to the booking connector to get trade data
-    MarketDataService<Bond>* market_data_service = new MarketDataService<Bond>(5);
+    MarketDataService<Bond>* market_data_service = new MarketDataService<Bond>(5, clock);
     MarketDataConnector<Bond>* market_data_connector = market_data_service->GetConnector();
     
+    //create a pre-trade risk service; it takes the best bid/offer before the algo reacts to the book
+    PreTradeRiskService<Bond>* pre_trade_risk_service = new PreTradeRiskService<Bond>(clock);
+    market_data_service->AddListener(pre_trade_risk_service->GetMarketDataListener());
+
     //create an algo execution service and subscribe to the market_data_service
     AlgoExecutionService<Bond>* algo_execution_service = new AlgoExecutionService<Bond>();
     market_data_service->AddListener(algo_execution_service->GetListener());
+    if (!parents.empty())
+    {
+        std::ifstream parents_file(parents);
+        ParentOrderConnector<Bond>(algo_execution_service, clock).Subscribe(parents_file);
+    }
 
-    //create an execution service and subscribe to the algo_execution_service
+    //check algo orders before they reach the execution service
+    algo_execution_service->AddListener(pre_trade_risk_service->GetAlgoExecutionListener());
+
+    //create an execution service and subscribe to the orders passing the pre-trade checks
     ExecutionService<Bond>* execution_service = new ExecutionService<Bond>();
-    algo_execution_service->AddListener(execution_service->GetListener());
+    pre_trade_risk_service->AddListener(execution_service->GetListener());
+
+    //create historical data service for orders rejected by the pre-trade checks
+    HistoricalDataService< RejectedOrder<Bond>>  historical_rejection_service(RejectionType);
+    pre_trade_risk_service->AddRejectListener(historical_rejection_service.GetListener());
 
 
     //create historical data service for execution_service
     HistoricalDataService< ExecutionOrder<Bond>>  historical_execution_service(ExecutionType);
     execution_service->AddListener(historical_execution_service.GetListener());
 
-    //create a trading service and subscribe to execution_service
-    TradeBookingService<Bond>* trading_book_service = new TradeBookingService<Bond>();
-    execution_service->AddListener(trading_book_service->GetListener());
+    //create a trading service and book trades from the fills of execution_service
+    TradeBookingService<Bond>* trading_book_service = new TradeBookingService<Bond>(clock);
+    execution_service->AddFillListener(trading_book_service->GetListener());
 
     //create position service and add it to booking service's listeners
     PositionService<Bond>* bond_position_service = new PositionService<Bond>();
@@ -45,11 +95,68 @@ int main() {
     RiskToPositionListener<Bond>* risk_to_pos_listener = bond_risk_service->GetListener();
     bond_position_service->AddListener(risk_to_pos_listener);
 
+    //feed positions and risk back to the pre-trade checks
+    bond_position_service->AddListener(pre_trade_risk_service->GetPositionListener());
+    bond_risk_service->AddListener(pre_trade_risk_service->GetRiskListener());
+
+
+    //publish fills to the trade booking process
+    ShmPublishConnector<ExecutionFill<Bond>>* fill_publisher = nullptr;
+    if (publish_fills)
+    {
+        fill_publisher = new ShmPublishConnector<ExecutionFill<Bond>>(FILLS_SHM_NAME);
+        if (!fill_publisher->IsReady()) std::cerr << "Failed to create shared memory " << FILLS_SHM_NAME << std::endl;
+        execution_service->AddFillListener(new ShmPublishListener<ExecutionFill<Bond>>(fill_publisher));
+    }
+
 
     //start reading market data
-    std::string filename = "marketdata.txt";
-    std::ifstream file(filename);
-    market_data_connector->Subscribe(file);
+    if (feed_address.empty() && follow)
+    {
+        install_stop_handler();
+        FileFollower follower("marketdata.txt");
+        follower.Follow([&](const string& _line) { market_data_connector->OnLine(_line); },
+            [&] { clock->AdvanceTimers(); return stop_requested(); });
+    }
+    else if (feed_address.empty())
+    {
+        std::string filename = "marketdata.txt";
+        std::ifstream file(filename);
+        market_data_connector->Subscribe(file);
+    }
+    else
+    {
+#ifndef _WIN32
+        FeedTransport transport;
+        std::string host;
+        int port;
+        if (!parse_feed_address(feed_address, transport, host, port))
+        {
+            std::cerr << "Bad feed address " << feed_address << std::endl;
+            return 1;
+        }
+
+        MarketDataFeedConnector<Bond> feed_connector(market_data_service, transport, host, port);
+        feed_connector.SetBusyPoll(busy_poll);
+        if (!feed_connector.Open())
+        {
+            std::cerr << "Failed to open feed " << feed_address << std::endl;
+            return 1;
+        }
+        install_stop_handler();
+        feed_connector.Run([] { return stop_requested(); }, feed_timeout >= 0 ? feed_timeout : FEED_IDLE_TIMEOUT_MS);
+        if (!feed_connector.IsEnded()) std::cerr << "Feed " << feed_address << " stopped before its end of stream" << std::endl;
+
+        const FeedLatencyStats& latency = feed_connector.GetLatency();
+        std::cout << "Books " << feed_connector.GetBookCount() << ", gaps " << feed_connector.GetGapCount() << " (" << feed_connector.GetLostCount() << " books lost), duplicates " << feed_connector.GetDuplicateCount() << ", malformed " << feed_connector.GetMalformedCount() << std::endl;
+        std::cout << "Wire to book latency ns: mean " << latency.GetMean() << ", p50 " << latency.GetPercentile(0.5) << ", p99 " << latency.GetPercentile(0.99) << ", max " << latency.GetMax() << std::endl;
+#else
+        std::cerr << "The binary feed needs POSIX sockets" << std::endl;
+        return 1;
+#endif
+    }
+
+    if (fill_publisher != nullptr) fill_publisher->Close();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,645 @@
+/**
+ * marketdatafeed.hpp
+ * Binary market data feed over UDP (unicast or multicast) or TCP: the wire format shared with the
+ * feed simulator, and a connector decoding packets straight into the order books of the
+ * MarketDataService. Uses POSIX sockets; UDP receives are batched with recvmmsg on Linux.
+ *
+ * @author Krystal Lin
+ */
+#ifndef MARKET_DATA_FEED_HPP
+#define MARKET_DATA_FEED_HPP
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include "marketdataservice.hpp"
+
+using namespace std;
+
+// Deepest book a feed message carries
+const int FEED_MAX_DEPTH = 5;
+
+// Most books packed in one packet, keeping UDP packets under a 1500 byte MTU
+const int FEED_MAX_BOOKS_PER_PACKET = 7;
+
+// Most UDP packets taken from the socket by one receive call
+const int FEED_RECEIVE_BATCH = 32;
+
+const uint32_t FEED_MAGIC = 0x4D444654;
+
+// Packet flag: the sender has nothing more to send
+const uint16_t FEED_END_OF_STREAM = 1;
+
+// How long a receiver waits without any packet before giving up, as the end of stream packet can be lost over UDP
+const long FEED_IDLE_TIMEOUT_MS = 10000;
+
+enum FeedTransport { FEED_UDP, FEED_TCP };
+
+/**
+ * Header of a feed packet, followed by count book messages.
+ * Numbers are in host byte order: the feed is meant for a host or a homogeneous network.
+ */
+struct FeedPacketHeader
+{
+	uint32_t magic;
+	uint16_t count;
+	uint16_t flags;
+	uint64_t sequence; //sequence number of the first book in the packet, books are numbered from 0
+};
+
+/**
+ * Snapshot of one order book, depth levels on each side.
+ */
+struct FeedBookMessage
+{
+	uint16_t productIndex;
+	uint8_t depth;
+	uint8_t reserved[5];
+	int64_t eventTime; //NO_TIMESTAMP if the source data has none
+	int64_t sendTime; //steady clock nanoseconds when the packet was sent
+	double bidPrice[FEED_MAX_DEPTH];
+	int64_t bidQuantity[FEED_MAX_DEPTH];
+	double offerPrice[FEED_MAX_DEPTH];
+	int64_t offerQuantity[FEED_MAX_DEPTH];
+};
+
+const size_t FEED_MAX_PACKET_SIZE = sizeof(FeedPacketHeader) + FEED_MAX_BOOKS_PER_PACKET * sizeof(FeedBookMessage);
+
+// Steady clock in nanoseconds; comparable between processes of the same host
+int64_t feed_clock_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Parse a feed address of the form udp://host:port or tcp://host:port; false if malformed
+bool parse_feed_address(const string& _address, FeedTransport& _transport, string& _host, int& _port)
+{
+	size_t scheme = _address.find("://");
+	size_t colon = _address.rfind(':');
+	if (scheme == string::npos || colon == string::npos || colon <= scheme + 3) return false;
+
+	string name = _address.substr(0, scheme);
+	if (name == "udp") _transport = FEED_UDP;
+	else if (name == "tcp") _transport = FEED_TCP;
+	else return false;
+
+	_host = _address.substr(scheme + 3, colon - scheme - 3);
+	try
+	{
+		_port = std::stoi(_address.substr(colon + 1));
+	}
+	catch (...)
+	{
+		return false;
+	}
+	return _port > 0 && _port < 65536;
+}
+
+// Fill a socket address from a dotted IPv4 host (or localhost) and port; false if the host is not an address
+bool make_feed_address(const string& _host, int _port, sockaddr_in& _address)
+{
+	memset(&_address, 0, sizeof(_address));
+	_address.sin_family = AF_INET;
+	_address.sin_port = htons(static_cast<uint16_t>(_port));
+	string host = _host == "localhost" ? "127.0.0.1" : _host;
+	return inet_pton(AF_INET, host.c_str(), &_address.sin_addr) == 1;
+}
+
+/**
+ * Histogram of wire to book latencies: 100ns buckets up to 1ms, anything slower in the last
+ * bucket. Recording is a counter increment, so it can stay on in the hot path.
+ */
+class FeedLatencyStats
+{
+
+private:
+
+	static const int BUCKET_COUNT = 10001;
+	static const int64_t BUCKET_NS = 100;
+
+	vector<uint32_t> buckets;
+	long long count;
+	int64_t total;
+	int64_t max;
+
+public:
+
+	FeedLatencyStats();
+
+	// Record one latency in nanoseconds
+	void Record(int64_t _latency);
+
+	// Number of latencies recorded
+	long long GetCount() const;
+
+	// Mean latency in nanoseconds
+	double GetMean() const;
+
+	// Largest latency in nanoseconds
+	int64_t GetMax() const;
+
+	// Latency under which _fraction of the recorded ones fall, to the bucket width
+	int64_t GetPercentile(double _fraction) const;
+
+};
+
+FeedLatencyStats::FeedLatencyStats()
+{
+	buckets = vector<uint32_t>(BUCKET_COUNT, 0);
+	count = 0;
+	total = 0;
+	max = 0;
+}
+
+void FeedLatencyStats::Record(int64_t _latency)
+{
+	if (_latency < 0) _latency = 0;
+	int64_t bucket = _latency / BUCKET_NS;
+	buckets[bucket < BUCKET_COUNT ? bucket : BUCKET_COUNT - 1]++;
+	count++;
+	total += _latency;
+	if (_latency > max) max = _latency;
+}
+
+long long FeedLatencyStats::GetCount() const
+{
+	return count;
+}
+
+double FeedLatencyStats::GetMean() const
+{
+	return count > 0 ? static_cast<double>(total) / count : 0.0;
+}
+
+int64_t FeedLatencyStats::GetMax() const
+{
+	return max;
+}
+
+int64_t FeedLatencyStats::GetPercentile(double _fraction) const
+{
+	long long target = static_cast<long long>(_fraction * count);
+	long long seen = 0;
+	for (int i = 0; i < BUCKET_COUNT; i++)
+	{
+		seen += buckets[i];
+		if (seen > target) return i < BUCKET_COUNT - 1 ? (i + 1) * BUCKET_NS : max;
+	}
+	return max;
+}
+
+/**
+ * Market Data Feed Connector receives order book snapshots from a binary feed.
+ * Each book is decoded into a book kept per product, whose stacks keep their storage, so
+ * steady state decoding does not allocate. Books carry sequence numbers: duplicates (replays,
+ * or a packet seen twice) are dropped, and gaps are counted with the number of books lost. As
+ * every message is a full snapshot, the next book of a product makes it current again after a
+ * gap, so no retransmission is needed.
+ * Type T is the product type.
+ */
+template<typename T>
+class MarketDataFeedConnector : public Connector<OrderBook<T>>
+{
+
+private:
+
+	MarketDataService<T>* service;
+	FeedTransport transport;
+	string host;
+	int port;
+	int socket_fd;
+	bool busy_poll;
+	bool ended;
+
+	uint64_t expected_sequence;
+	long long book_count;
+	long long gap_count;
+	long long lost_count;
+	long long duplicate_count;
+	long long malformed_count;
+	FeedLatencyStats latency;
+
+	vector<OrderBook<T>> books;
+	Order bids[FEED_MAX_DEPTH];
+	Order offers[FEED_MAX_DEPTH];
+
+	vector<char> buffer; //FEED_RECEIVE_BATCH packets for UDP, the unparsed stream for TCP
+	size_t stream_bytes;
+#ifdef __linux__
+	mmsghdr messages[FEED_RECEIVE_BATCH];
+	iovec vectors[FEED_RECEIVE_BATCH];
+#endif
+
+	bool OpenUdp();
+	bool OpenTcp(long _timeoutMs);
+	int ReceiveUdp();
+	int ReceiveTcp();
+	void HandlePacket(const char* _data, size_t _size);
+	void HandleBook(const FeedBookMessage& _message);
+
+public:
+
+	// Connector and Destructor; _host is the group to join for multicast UDP, the sender for TCP
+	MarketDataFeedConnector(MarketDataService<T>* _service, FeedTransport _transport, const string& _host, int _port);
+	~MarketDataFeedConnector();
+
+	// Spin on a non blocking socket instead of sleeping in the kernel between packets
+	void SetBusyPoll(bool _busyPoll);
+
+	// Bind (UDP) or connect (TCP, retrying up to _timeoutMs while the sender starts); false on failure
+	bool Open(long _timeoutMs = 10000);
+
+	// Publish data to the Connector
+	void Publish(OrderBook<T>& _data);
+
+	// Receive the feed until it ends; the file is not used
+	void Subscribe(ifstream& _data);
+
+	// Receive what the socket has, waiting up to 100ms unless busy polling; packets handled, -1 once the feed is closed
+	int Poll();
+
+	// Receive until the feed ends, _stop returns true or nothing arrives for _idleTimeoutMs (0 waits forever)
+	void Run(function<bool()> _stop = nullptr, long _idleTimeoutMs = 0);
+
+	// Check whether the sender ended the feed
+	bool IsEnded() const;
+
+	// Number of books passed to the service
+	long long GetBookCount() const;
+
+	// Number of sequence gaps, and books lost in them
+	long long GetGapCount() const;
+	long long GetLostCount() const;
+
+	// Number of books dropped as already seen
+	long long GetDuplicateCount() const;
+
+	// Number of packets or books that could not be decoded
+	long long GetMalformedCount() const;
+
+	// Latency from the sender writing a packet to its book being ready for the service
+	const FeedLatencyStats& GetLatency() const;
+
+};
+
+template<typename T>
+MarketDataFeedConnector<T>::MarketDataFeedConnector(MarketDataService<T>* _service, FeedTransport _transport, const string& _host, int _port)
+{
+	service = _service;
+	transport = _transport;
+	host = _host;
+	port = _port;
+	socket_fd = -1;
+	busy_poll = false;
+	ended = false;
+
+	expected_sequence = 0;
+	book_count = 0;
+	gap_count = 0;
+	lost_count = 0;
+	duplicate_count = 0;
+	malformed_count = 0;
+
+	//books are built once, with stacks sized for the deepest message
+	for (int i = 0; i < get_product_count(); i++)
+	{
+		vector<Order> stack;
+		stack.reserve(FEED_MAX_DEPTH);
+		books.push_back(OrderBook<T>(get_product_at<T>(i), stack, stack));
+	}
+
+	buffer = vector<char>(FEED_RECEIVE_BATCH * FEED_MAX_PACKET_SIZE);
+	stream_bytes = 0;
+#ifdef __linux__
+	memset(messages, 0, sizeof(messages));
+	for (int i = 0; i < FEED_RECEIVE_BATCH; i++)
+	{
+		vectors[i].iov_base = &buffer[i * FEED_MAX_PACKET_SIZE];
+		vectors[i].iov_len = FEED_MAX_PACKET_SIZE;
+		messages[i].msg_hdr.msg_iov = &vectors[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+	}
+#endif
+}
+
+template<typename T>
+MarketDataFeedConnector<T>::~MarketDataFeedConnector()
+{
+	if (socket_fd >= 0) close(socket_fd);
+}
+
+template<typename T>
+void MarketDataFeedConnector<T>::SetBusyPoll(bool _busyPoll)
+{
+	busy_poll = _busyPoll;
+}
+
+template<typename T>
+bool MarketDataFeedConnector<T>::Open(long _timeoutMs)
+{
+	return transport == FEED_UDP ? OpenUdp() : OpenTcp(_timeoutMs);
+}
+
+template<typename T>
+bool MarketDataFeedConnector<T>::OpenUdp()
+{
+	sockaddr_in address;
+	if (!make_feed_address(host, port, address)) return false;
+
+	socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (socket_fd < 0) return false;
+
+	int on = 1;
+	setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+	//room for bursts while the service is busy with a book
+	int receive_buffer = 4 << 20;
+	setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+
+	bool multicast = IN_MULTICAST(ntohl(address.sin_addr.s_addr));
+	sockaddr_in local = address;
+	if (!multicast) local.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(socket_fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) return false;
+
+	if (multicast)
+	{
+		ip_mreq group;
+		group.imr_multiaddr = address.sin_addr;
+		group.imr_interface.s_addr = htonl(INADDR_ANY);
+		if (setsockopt(socket_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group, sizeof(group)) != 0) return false;
+	}
+
+	timeval timeout = { 0, 100000 };
+	setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#if defined(__linux__) && defined(SO_BUSY_POLL)
+	//let the kernel poll the device too; needs privileges, so a failure is ignored
+	if (busy_poll)
+	{
+		int busy_poll_us = 50;
+		setsockopt(socket_fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us, sizeof(busy_poll_us));
+	}
+#endif
+	return true;
+}
+
+template<typename T>
+bool MarketDataFeedConnector<T>::OpenTcp(long _timeoutMs)
+{
+	sockaddr_in address;
+	if (!make_feed_address(host, port, address)) return false;
+
+	//the sender listens; it may not be up yet
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_timeoutMs);
+	while (true)
+	{
+		socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (socket_fd < 0) return false;
+		if (connect(socket_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) break;
+
+		close(socket_fd);
+		socket_fd = -1;
+		if (std::chrono::steady_clock::now() >= deadline) return false;
+		usleep(10000);
+	}
+
+	int on = 1;
+	setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	timeval timeout = { 0, 100000 };
+	setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	return true;
+}
+
+template<typename T>
+void MarketDataFeedConnector<T>::Publish(OrderBook<T>& _data) {}
+
+template<typename T>
+void MarketDataFeedConnector<T>::Subscribe(ifstream& _data)
+{
+	Run();
+}
+
+template<typename T>
+int MarketDataFeedConnector<T>::Poll()
+{
+	if (socket_fd < 0 || ended) return -1;
+	return transport == FEED_UDP ? ReceiveUdp() : ReceiveTcp();
+}
+
+template<typename T>
+int MarketDataFeedConnector<T>::ReceiveUdp()
+{
+#ifdef __linux__
+	//one system call for up to a batch of packets: blocks for the first, takes whatever else is queued
+	int received = recvmmsg(socket_fd, messages, FEED_RECEIVE_BATCH, busy_poll ? MSG_DONTWAIT : MSG_WAITFORONE, nullptr);
+	if (received < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+
+	for (int i = 0; i < received; i++)
+	{
+		HandlePacket(&buffer[i * FEED_MAX_PACKET_SIZE], messages[i].msg_len);
+	}
+	return received;
+#else
+	int received = 0;
+	while (received < FEED_RECEIVE_BATCH)
+	{
+		int flags = busy_poll || received > 0 ? MSG_DONTWAIT : 0;
+		ssize_t size = recv(socket_fd, &buffer[0], FEED_MAX_PACKET_SIZE, flags);
+		if (size < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+			return received > 0 ? received : -1;
+		}
+		HandlePacket(&buffer[0], static_cast<size_t>(size));
+		received++;
+	}
+	return received;
+#endif
+}
+
+template<typename T>
+int MarketDataFeedConnector<T>::ReceiveTcp()
+{
+	ssize_t size = recv(socket_fd, &buffer[stream_bytes], buffer.size() - stream_bytes, busy_poll ? MSG_DONTWAIT : 0);
+	if (size == 0)
+	{
+		//sender closed the connection
+		ended = true;
+		return -1;
+	}
+	if (size < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+	stream_bytes += static_cast<size_t>(size);
+
+	//handle every complete packet, keep the partial one at the front of the buffer
+	int handled = 0;
+	size_t offset = 0;
+	while (stream_bytes - offset >= sizeof(FeedPacketHeader))
+	{
+		FeedPacketHeader header;
+		memcpy(&header, &buffer[offset], sizeof(header));
+		if (header.magic != FEED_MAGIC || header.count > FEED_MAX_BOOKS_PER_PACKET)
+		{
+			//no way to find the next packet boundary in a corrupt stream
+			malformed_count++;
+			ended = true;
+			return -1;
+		}
+
+		size_t packet_size = sizeof(FeedPacketHeader) + header.count * sizeof(FeedBookMessage);
+		if (stream_bytes - offset < packet_size) break;
+
+		HandlePacket(&buffer[offset], packet_size);
+		offset += packet_size;
+		handled++;
+	}
+
+	if (offset > 0)
+	{
+		memmove(&buffer[0], &buffer[offset], stream_bytes - offset);
+		stream_bytes -= offset;
+	}
+	return handled;
+}
+
+template<typename T>
+void MarketDataFeedConnector<T>::HandlePacket(const char* _data, size_t _size)
+{
+	FeedPacketHeader header;
+	if (_size < sizeof(header))
+	{
+		malformed_count++;
+		return;
+	}
+	memcpy(&header, _data, sizeof(header));
+	if (header.magic != FEED_MAGIC || header.count > FEED_MAX_BOOKS_PER_PACKET || _size < sizeof(header) + header.count * sizeof(FeedBookMessage))
+	{
+		malformed_count++;
+		return;
+	}
+
+	uint64_t first = header.sequence;
+	uint64_t last = first + header.count;
+	if (first > expected_sequence)
+	{
+		gap_count++;
+		lost_count += static_cast<long long>(first - expected_sequence);
+	}
+
+	if (header.flags & FEED_END_OF_STREAM) ended = true;
+
+	if (last <= expected_sequence)
+	{
+		duplicate_count += header.count;
+		return;
+	}
+
+	//skip the books of the packet already seen
+	uint64_t skip = first < expected_sequence ? expected_sequence - first : 0;
+	duplicate_count += static_cast<long long>(skip);
+	expected_sequence = last;
+
+	const char* message = _data + sizeof(header) + skip * sizeof(FeedBookMessage);
+	for (uint64_t i = skip; i < header.count; i++)
+	{
+		FeedBookMessage book;
+		memcpy(&book, message, sizeof(book));
+		HandleBook(book);
+		message += sizeof(FeedBookMessage);
+	}
+}
+
+template<typename T>
+void MarketDataFeedConnector<T>::HandleBook(const FeedBookMessage& _message)
+{
+	if (_message.productIndex >= books.size() || _message.depth == 0 || _message.depth > FEED_MAX_DEPTH)
+	{
+		malformed_count++;
+		return;
+	}
+
+	int depth = _message.depth;
+	for (int i = 0; i < depth; i++)
+	{
+		bids[i] = Order(_message.bidPrice[i], static_cast<long>(_message.bidQuantity[i]), BID);
+		offers[i] = Order(_message.offerPrice[i], static_cast<long>(_message.offerQuantity[i]), OFFER);
+	}
+
+	OrderBook<T>& book = books[_message.productIndex];
+	book.SetStacks(bids, offers, depth);
+	book.SetTimestamp(service->GetClock()->Stamp(_message.eventTime));
+	latency.Record(feed_clock_ns() - _message.sendTime);
+
+	book_count++;
+	service->OnMessage(book);
+}
+
+template<typename T>
+void MarketDataFeedConnector<T>::Run(function<bool()> _stop, long _idleTimeoutMs)
+{
+	auto last_packet = std::chrono::steady_clock::now();
+	while (!ended)
+	{
+		int received = Poll();
+		if (received < 0) return;
+		if (_stop && _stop()) return;
+		if (received > 0) last_packet = std::chrono::steady_clock::now();
+		else if (_idleTimeoutMs > 0 && std::chrono::steady_clock::now() - last_packet >= std::chrono::milliseconds(_idleTimeoutMs)) return;
+	}
+}
+
+template<typename T>
+bool MarketDataFeedConnector<T>::IsEnded() const
+{
+	return ended;
+}
+
+template<typename T>
+long long MarketDataFeedConnector<T>::GetBookCount() const
+{
+	return book_count;
+}
+
+template<typename T>
+long long MarketDataFeedConnector<T>::GetGapCount() const
+{
+	return gap_count;
+}
+
+template<typename T>
+long long MarketDataFeedConnector<T>::GetLostCount() const
+{
+	return lost_count;
+}
+
+template<typename T>
+long long MarketDataFeedConnector<T>::GetDuplicateCount() const
+{
+	return duplicate_count;
+}
+
+template<typename T>
+long long MarketDataFeedConnector<T>::GetMalformedCount() const
+{
+	return malformed_count;
+}
+
+template<typename T>
+const FeedLatencyStats& MarketDataFeedConnector<T>::GetLatency() const
+{
+	return latency;
+}
+
+#endif
@@ -11,6 +11,7 @@
 #include <string>
 #include <vector>
 #include "..\soa.hpp"
+#include "..\csvtokenizer.hpp"
 #include "..\util.hpp"
 #include "..\bondstaticdata.hpp"
 
@@ -125,8 +126,8 @@ class OrderBook
 
 public:
 
-  // ctor for the order book
-  OrderBook(const T &_product, const vector<Order> &_bidStack, const vector<Order> &_offerStack);
+  // ctor for the order book; pass the stacks as rvalues to move them in
+  OrderBook(const T &_product, vector<Order> _bidStack, vector<Order> _offerStack);
 
   //default ctor
   OrderBook() = default;
@@ -140,23 +141,33 @@ public:
   // Get the offer stack
   const vector<Order>& GetOfferStack() const;
 
+  // Get the event time of the order book
+  Timestamp GetTimestamp() const;
+
+  // Set the event time of the order book
+  void SetTimestamp(Timestamp _timestamp);
+
+  // Replace both stacks with _depth levels, reusing the storage of the current stacks
+  void SetStacks(const Order* _bids, const Order* _offers, int _depth);
+
 private:
-  T product;
+  ProductRef<T> product;
   vector<Order> bidStack;
   vector<Order> offerStack;
+  Timestamp timestamp = NO_TIMESTAMP;
 
 };
 
 template<typename T>
-OrderBook<T>::OrderBook(const T& _product, const vector<Order>& _bidStack, const vector<Order>& _offerStack) :
-	product(_product), bidStack(_bidStack), offerStack(_offerStack)
+OrderBook<T>::OrderBook(const T& _product, vector<Order> _bidStack, vector<Order> _offerStack) :
+	product(_product), bidStack(std::move(_bidStack)), offerStack(std::move(_offerStack))
 {
 }
 
 template<typename T>
 const T& OrderBook<T>::GetProduct() const
 {
-	return product;
+	return product.Get();
 }
 
 template<typename T>
@@ -171,6 +182,25 @@ const vector<Order>& OrderBook<T>::GetOfferStack() const
 	return offerStack;
 }
 
+template<typename T>
+Timestamp OrderBook<T>::GetTimestamp() const
+{
+	return timestamp;
+}
+
+template<typename T>
+void OrderBook<T>::SetTimestamp(Timestamp _timestamp)
+{
+	timestamp = _timestamp;
+}
+
+template<typename T>
+void OrderBook<T>::SetStacks(const Order* _bids, const Order* _offers, int _depth)
+{
+	bidStack.assign(_bids, _bids + _depth);
+	offerStack.assign(_offers, _offers + _depth);
+}
+
 
 
 
@@ -193,6 +223,7 @@ private:
 
 	vector<ServiceListener<OrderBook<T>>*> listeners;
 	MarketDataConnector<T>* connector;
+	Clock* clock;
 	int depth;
 	//latest orderbook per instrument
 	map<string, OrderBook<T>> order_books;
@@ -200,7 +231,7 @@ private:
 public:
 
 	// Constructor and destructor
-	MarketDataService(int _depth);
+	MarketDataService(int _depth, Clock* _clock = &DefaultClock());
 	~MarketDataService();
 
 
@@ -210,6 +241,9 @@ public:
 	// The callback that a Connector should invoke for any new or updated data
 	void OnMessage(OrderBook<T>& _data);
 
+	// The callback for an order book the caller no longer needs; its stacks are moved into the service
+	void OnMessage(OrderBook<T>&& _data);
+
 	// Add a listener to the Service for callbacks on add, remove, and update events for data to the Service
 	void AddListener(ServiceListener<OrderBook<T>>* _listener);
 
@@ -227,11 +261,15 @@ public:
 
 	int GetDepth();
 
+	// Get the clock used to timestamp order books
+	Clock* GetClock() const;
+
 };
 
 template<typename T>
-MarketDataService<T>::MarketDataService(int _depth)
+MarketDataService<T>::MarketDataService(int _depth, Clock* _clock)
 {
+	clock = _clock;
 	order_books = map<string, OrderBook<T>>();
 	listeners = vector<ServiceListener<OrderBook<T>>*>();
 	connector = new MarketDataConnector<T>(this);
@@ -251,6 +289,7 @@ OrderBook<T>& MarketDataService<T>::GetData(string _key)
 template<typename T>
 void MarketDataService<T>::OnMessage(OrderBook<T>& _data)
 {
+	//copy assignment reuses the storage of the stored book's stacks
 	string product_id = _data.GetProduct().GetProductId();
 	order_books[product_id] = _data;
 
@@ -260,6 +299,18 @@ void MarketDataService<T>::OnMessage(OrderBook<T>& _data)
 	}
 }
 
+template<typename T>
+void MarketDataService<T>::OnMessage(OrderBook<T>&& _data)
+{
+	const string& product_id = _data.GetProduct().GetProductId();
+	OrderBook<T>& order_book = order_books.insert_or_assign(product_id, std::move(_data)).first->second;
+
+	for (auto& l : listeners)
+	{
+		l->ProcessAdd(order_book);
+	}
+}
+
 template<typename T>
 void MarketDataService<T>::AddListener(ServiceListener<OrderBook<T>>* _listener)
 {
@@ -330,8 +381,16 @@ int MarketDataService<T>::GetDepth()
 	return depth;
 }
 
+template<typename T>
+Clock* MarketDataService<T>::GetClock() const
+{
+	return clock;
+}
+
 /**
 * Market Data Connector reads data from marketdata.txt
+* Lines are product,mid,spread,bid size,offer size with an optional trailing event time in
+* milliseconds since epoch; each order book is stamped by the service clock on its last level.
 * Type T is the product type.
 */
 
@@ -342,6 +401,13 @@ class MarketDataConnector : public Connector<OrderBook<T>>
 private:
 
 	MarketDataService<T>* service;
+	//levels of the book being read, until depth lines have arrived
+	int count;
+	vector<Order> bids;
+	vector<Order> asks;
+	//books handed to the service per product index, refilled in place so a read allocates nothing
+	vector<OrderBook<T>> books;
+	OrderBook<T> unknown_book;
 
 public:
 
@@ -355,12 +421,23 @@ public:
 	// Subscribe data from the Connector
 	void Subscribe(ifstream& _data);
 
+	// Parse one line of market data; every depth lines make an order book passed to the service
+	void OnLine(const string& _line);
+
+	// Handle the fields of one line of market data
+	void OnFields(const CsvLine& _line);
+
 };
 
 template<typename T>
 MarketDataConnector<T>::MarketDataConnector(MarketDataService<T>* _service)
 {
 	service = _service;
+	count = 0;
+	for (int i = 0; i < get_product_count(); i++)
+	{
+		books.push_back(OrderBook<T>(get_product_at<T>(i), vector<Order>(), vector<Order>()));
+	}
 }
 
 template<typename T>
@@ -377,53 +454,49 @@ void MarketDataConnector<T>::Subscribe(ifstream& _data)
 		std::cerr << "Failed to open file" << std::endl;
 		return;
 	}
-	int depth = service->GetDepth();
-	int count = 0;
-	std::string line;
-	vector<Order> bids; vector<Order> asks;
-	Order bid; Order ask;
-	double mid;
-	double spread;
-	long quantity;
 
+	CsvReader reader;
+	reader.Read(_data, [this](const CsvLine& _line) { OnFields(_line); });
+
+	_data.close();
+}
+
+template<typename T>
+void MarketDataConnector<T>::OnLine(const string& _line)
+{
+	CsvLine fields;
+	tokenize_line(_line.data(), _line.data() + _line.size(), fields);
+	OnFields(fields);
+}
+
+template<typename T>
+void MarketDataConnector<T>::OnFields(const CsvLine& _line)
+{
 	//parsing function implemente by GPT.
-	while (getline(_data, line)) {
-		count++;
-		std::stringstream ss(line);
-		std::string item;
-		std::vector<std::string> splittedItems;
-
-		while (getline(ss, item, ','))
-		{
-			splittedItems.push_back(item);
-		}
-
-		//convert price from fractional representation to decimals
-		mid = fractional_to_decimal(splittedItems[1]);
-		spread = std::stod(splittedItems[2]);
-		quantity = std::stod(splittedItems[3]);
-
-		bid = Order(mid - spread / 2.0, quantity, BID);
-		ask = Order(mid + spread / 2.0, quantity, OFFER);
-
-		bids.push_back(bid);
-		asks.push_back(ask);
-
-		if (count % depth == 0)
-		{
-			vector<Order> bids_order(bids);
-			vector<Order> asks_order(asks);
-			bids.clear();
-			asks.clear();
-
-			OrderBook<T> order_book(get_product<T>(splittedItems[0]), bids_order, asks_order);
-			service->OnMessage(order_book);
-			count = 0;
-		}
+	count++;
 
-	}
+	//convert price from fractional representation to decimals
+	double mid = fractional_to_decimal(_line.View(1));
+	double spread = _line.Number(2);
+	long quantity = static_cast<long>(_line.Number(3));
 
-	_data.close();
+	bids.push_back(Order(mid - spread / 2.0, quantity, BID));
+	asks.push_back(Order(mid + spread / 2.0, quantity, OFFER));
+
+	if (count % service->GetDepth() == 0)
+	{
+		Timestamp event_time = _line.count > 5 ? _line.Integer(5) : NO_TIMESTAMP;
+
+		//the levels are copied into the product's book and from there into the service's, both reusing their storage
+		int index = get_ticker_index(_line.View(0));
+		OrderBook<T>& order_book = index >= 0 ? books[index] : unknown_book;
+		order_book.SetStacks(bids.data(), asks.data(), static_cast<int>(bids.size()));
+		order_book.SetTimestamp(service->GetClock()->Stamp(event_time));
+		bids.clear();
+		asks.clear();
+		service->OnMessage(order_book);
+		count = 0;
+	}
 }
 
 #endif
@@ -0,0 +1,305 @@
+/**
+ * parallelingest.hpp
+ * Parallel ingest of large input files: the file is memory mapped, split into chunks on line
+ * boundaries, and the chunks are parsed on a pool of threads while the calling thread dispatches
+ * the parsed records chunk by chunk in file order.
+ *
+ * @author Krystal Lin
+ */
+
+#ifndef PARALLELINGEST_HPP
+#define PARALLELINGEST_HPP
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstring>
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/**
+ * Read only memory mapping of a whole file.
+ */
+class MappedFile
+{
+
+private:
+
+	const char* data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+
+public:
+
+	MappedFile();
+
+	~MappedFile();
+
+	// Map a file; false if it cannot be opened. An empty file maps to no data.
+	bool Open(const string& _filename);
+
+	// Get the mapped bytes
+	const char* GetData() const;
+
+	// Get the number of mapped bytes
+	size_t GetSize() const;
+
+};
+
+MappedFile::MappedFile()
+{
+	data = nullptr;
+	size = 0;
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (data != nullptr) UnmapViewOfFile(data);
+	if (mapping != NULL) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+	if (data != nullptr) munmap(const_cast<char*>(data), size);
+#endif
+}
+
+bool MappedFile::Open(const string& _filename)
+{
+#ifdef _WIN32
+	file = CreateFileA(_filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) return false;
+	size = static_cast<size_t>(file_size.QuadPart);
+	if (size == 0) return true;
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) return false;
+	data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	return data != nullptr;
+#else
+	int fd = open(_filename.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	size = static_cast<size_t>(st.st_size);
+	if (size == 0)
+	{
+		close(fd);
+		return true;
+	}
+	void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+	{
+		size = 0;
+		return false;
+	}
+	//read front to back once
+	madvise(mapped, size, MADV_SEQUENTIAL);
+	data = static_cast<const char*>(mapped);
+	return true;
+#endif
+}
+
+const char* MappedFile::GetData() const
+{
+	return data;
+}
+
+size_t MappedFile::GetSize() const
+{
+	return size;
+}
+
+// Split _size bytes into chunks of about _chunkSize bytes, each ending just after a newline (or at the end)
+vector<pair<size_t, size_t>> split_lines(const char* _data, size_t _size, size_t _chunkSize)
+{
+	vector<pair<size_t, size_t>> chunks;
+	size_t begin = 0;
+	while (begin < _size)
+	{
+		size_t end = begin + _chunkSize;
+		if (end >= _size) end = _size;
+		else
+		{
+			const char* newline = static_cast<const char*>(memchr(_data + end, '\n', _size - end));
+			end = newline != nullptr ? static_cast<size_t>(newline - _data) + 1 : _size;
+		}
+		chunks.push_back({ begin, end });
+		begin = end;
+	}
+	return chunks;
+}
+
+/**
+ * Parses the lines of a file on a pool of threads and dispatches the records in file order.
+ * Workers take chunks in order and parse each line with _parse into a record; the calling thread
+ * dispatches the records of each chunk with _dispatch as soon as the chunk, and every chunk
+ * before it, is parsed. Only a window of chunks ahead of the dispatcher is parsed at a time, so
+ * memory stays bounded for files of any size. As records are dispatched in file order, every
+ * product sees its updates in the same order as a serial read.
+ * Type R is the parsed record type.
+ */
+template<typename R>
+class ParallelIngest
+{
+
+private:
+
+	int thread_count;
+	size_t chunk_size;
+	long long line_count;
+	long long skipped_count;
+
+public:
+
+	// Constructor; _threadCount parsing threads, chunks of about _chunkSize bytes
+	ParallelIngest(int _threadCount, size_t _chunkSize = 1 << 20);
+
+	// Parse every line of the file and dispatch the records; false if the file cannot be mapped.
+	// _parse gets a line without its newline and returns false to skip it.
+	bool Run(const string& _filename, const function<bool(const char*, const char*, R&)>& _parse, const function<void(R&)>& _dispatch);
+
+	// Number of lines dispatched by the last run
+	long long GetLineCount() const;
+
+	// Number of lines the parser skipped in the last run
+	long long GetSkippedCount() const;
+
+};
+
+template<typename R>
+ParallelIngest<R>::ParallelIngest(int _threadCount, size_t _chunkSize)
+{
+	thread_count = _threadCount > 0 ? _threadCount : 1;
+	chunk_size = _chunkSize > 0 ? _chunkSize : 1;
+	line_count = 0;
+	skipped_count = 0;
+}
+
+template<typename R>
+bool ParallelIngest<R>::Run(const string& _filename, const function<bool(const char*, const char*, R&)>& _parse, const function<void(R&)>& _dispatch)
+{
+	line_count = 0;
+	skipped_count = 0;
+
+	MappedFile file;
+	if (!file.Open(_filename)) return false;
+	const char* data = file.GetData();
+	vector<pair<size_t, size_t>> chunks = split_lines(data, file.GetSize(), chunk_size);
+
+	vector<vector<R>> records(chunks.size());
+	vector<long long> skipped(chunks.size(), 0);
+	vector<char> parsed(chunks.size(), 0);
+	size_t next_chunk = 0;
+	size_t dispatched = 0;
+	size_t window = static_cast<size_t>(thread_count) * 2;
+	mutex lock;
+	condition_variable chunk_parsed;
+	condition_variable chunk_dispatched;
+
+	auto worker = [&]()
+	{
+		while (true)
+		{
+			size_t chunk;
+			{
+				unique_lock<mutex> guard(lock);
+				chunk_dispatched.wait(guard, [&] { return next_chunk >= chunks.size() || next_chunk < dispatched + window; });
+				if (next_chunk >= chunks.size()) return;
+				chunk = next_chunk++;
+			}
+
+			const char* line = data + chunks[chunk].first;
+			const char* end = data + chunks[chunk].second;
+			vector<R>& out = records[chunk];
+			while (line < end)
+			{
+				const char* newline = static_cast<const char*>(memchr(line, '\n', end - line));
+				const char* line_end = newline != nullptr ? newline : end;
+				const char* text_end = line_end > line && line_end[-1] == '\r' ? line_end - 1 : line_end;
+
+				if (text_end > line)
+				{
+					R record;
+					if (_parse(line, text_end, record)) out.push_back(record);
+					else skipped[chunk]++;
+				}
+				line = line_end + 1;
+			}
+
+			{
+				lock_guard<mutex> guard(lock);
+				parsed[chunk] = 1;
+			}
+			chunk_parsed.notify_one();
+		}
+	};
+
+	vector<thread> workers;
+	for (int i = 0; i < thread_count; i++) workers.emplace_back(worker);
+
+	//dispatch on the calling thread, in chunk order
+	for (size_t chunk = 0; chunk < chunks.size(); chunk++)
+	{
+		{
+			unique_lock<mutex> guard(lock);
+			chunk_parsed.wait(guard, [&] { return parsed[chunk] != 0; });
+		}
+
+		for (R& record : records[chunk]) _dispatch(record);
+		line_count += static_cast<long long>(records[chunk].size());
+		skipped_count += skipped[chunk];
+		vector<R>().swap(records[chunk]);
+
+		{
+			lock_guard<mutex> guard(lock);
+			dispatched = chunk + 1;
+		}
+		chunk_dispatched.notify_all();
+	}
+
+	for (auto& t : workers) t.join();
+	return true;
+}
+
+template<typename R>
+long long ParallelIngest<R>::GetLineCount() const
+{
+	return line_count;
+}
+
+template<typename R>
+long long ParallelIngest<R>::GetSkippedCount() const
+{
+	return skipped_count;
+}
+
+#endif
@@ -0,0 +1,726 @@
+/**
+ * pretraderiskservice.hpp
+ * Defines the data types and Service for pre-trade risk checks on algo orders.
+ *
+ * @author Krystal Lin
+ */
+#ifndef PRE_TRADE_RISK_SERVICE_HPP
+#define PRE_TRADE_RISK_SERVICE_HPP
+
+#include <string>
+#include <cmath>
+
+#include "..\soa.hpp"
+#include "..\bondstaticdata.hpp"
+#include "..\executionservice\executionservice.hpp"
+#include "..\tradebookingservice\positionservice.hpp"
+#include "..\tradebookingservice\riskservice.hpp"
+#include "..\util.hpp"
+
+// Outcome of the pre-trade checks on an order, in the order the checks run
+enum RiskCheckResult
+{
+	RISK_ACCEPTED,
+	RISK_UNKNOWN_PRODUCT,
+	RISK_ORDER_SIZE,
+	RISK_POSITION_LIMIT,
+	RISK_PV01_LIMIT,
+	RISK_PORTFOLIO_PV01_LIMIT,
+	RISK_NO_MARKET,
+	RISK_PRICE_BAND,
+	RISK_ORDER_RATE
+};
+
+static const string RISK_CHECK_NAMES[] = { "ACCEPTED", "UNKNOWN_PRODUCT", "ORDER_SIZE", "POSITION_LIMIT", "PV01_LIMIT",
+										   "PORTFOLIO_PV01_LIMIT", "NO_MARKET", "PRICE_BAND", "ORDER_RATE" };
+
+/**
+ * Pre-trade limits of a product.
+ * PV01 limits are in the units of RiskService, PV01 times quantity.
+ */
+struct ProductRiskLimits
+{
+	long maxOrderSize; //visible plus hidden quantity
+	long maxBookPosition; //absolute position in any single book
+	double maxPV01; //absolute PV01 of the product
+	double priceBand; //how far outside the best bid/offer an order may be priced
+	double ordersPerSecond; //order rate throttle, 0 disables it
+	double orderBurst; //orders that can be sent back to back before the throttle applies
+};
+
+/**
+ * Default limits, loose enough for the simulated flow: they only catch orders that are clearly wrong.
+ */
+const ProductRiskLimits DEFAULT_RISK_LIMITS = { 100000000, 1000000000, 100000000.0, 1.0, 0.0, 0.0 };
+
+/**
+ * An order rejected by the pre-trade checks, with the check that failed.
+ * Type T is the product type.
+ */
+template<typename T>
+class RejectedOrder
+{
+
+public:
+
+	// ctor for a rejected order
+	RejectedOrder(const ExecutionOrder<T>& _order, RiskCheckResult _reason);
+
+	//default ctor
+	RejectedOrder() = default;
+
+	// Get the rejected order
+	const ExecutionOrder<T>& GetOrder() const;
+
+	// Get the check that failed
+	RiskCheckResult GetReason() const;
+
+	// Get the product of the rejected order
+	const T& GetProduct() const;
+
+	// Get the event time of the rejected order
+	Timestamp GetTimestamp() const;
+
+	//key used to persist data in historical data service
+	string GetPersistKey() const;
+
+	//data persisted in historical data service
+	string GetPersistData() const;
+
+	//numeric columns persisted in historical data service
+	static vector<string> GetPersistColumns();
+
+	//values of the persisted columns, in the order of GetPersistColumns
+	void GetPersistValues(double* _values) const;
+
+private:
+	ExecutionOrder<T> order;
+	RiskCheckResult reason;
+
+};
+
+template<typename T>
+RejectedOrder<T>::RejectedOrder(const ExecutionOrder<T>& _order, RiskCheckResult _reason) :
+	order(_order)
+{
+	reason = _reason;
+}
+
+template<typename T>
+const ExecutionOrder<T>& RejectedOrder<T>::GetOrder() const
+{
+	return order;
+}
+
+template<typename T>
+RiskCheckResult RejectedOrder<T>::GetReason() const
+{
+	return reason;
+}
+
+template<typename T>
+const T& RejectedOrder<T>::GetProduct() const
+{
+	return order.GetProduct();
+}
+
+template<typename T>
+Timestamp RejectedOrder<T>::GetTimestamp() const
+{
+	return order.GetTimestamp();
+}
+
+template<typename T>
+string RejectedOrder<T>::GetPersistKey() const
+{
+	return order.GetOrderId();
+}
+
+template<typename T>
+string RejectedOrder<T>::GetPersistData() const
+{
+	string side = order.GetPricingSide() == BID ? "BID" : "OFFER";
+	long quantity = order.GetVisibleQuantity() + order.GetHiddenQuantity();
+	return timeToString(order.GetTimestamp()) + " , " + order.GetOrderId() + " , " + order.GetProduct().GetProductId() + " , Side:" + side
+		+ " , Price:" + decimal_to_fractional(order.GetPrice()) + " , Qty:" + std::to_string(quantity) + " , Reason:" + RISK_CHECK_NAMES[reason] + "\n";
+}
+
+template<typename T>
+vector<string> RejectedOrder<T>::GetPersistColumns()
+{
+	return { "side", "price", "quantity", "reason" };
+}
+
+template<typename T>
+void RejectedOrder<T>::GetPersistValues(double* _values) const
+{
+	_values[0] = order.GetPricingSide();
+	_values[1] = order.GetPrice();
+	_values[2] = order.GetVisibleQuantity() + order.GetHiddenQuantity();
+	_values[3] = reason;
+}
+
+/**
+* Pre-declearations to avoid errors.
+*/
+template<typename T>
+class PreTradeRiskToAlgoExecutionListener;
+
+template<typename T>
+class PreTradeRiskToMarketDataListener;
+
+template<typename T>
+class PreTradeRiskToPositionListener;
+
+template<typename T>
+class PreTradeRiskToRiskListener;
+
+/**
+ * Pre-trade risk gate between AlgoExecutionService and ExecutionService.
+ * Algo orders that pass every check are forwarded to the listeners of this service, orders that
+ * fail are published to the reject listeners with the failed check.
+ * Limits and the state the checks need (book positions, PV01, best bid/offer, throttle tokens) are
+ * kept per product in flat arrays indexed by get_product_index, one cache line of state per
+ * product, so a check is a handful of compares with no lookups or allocation. Positions and PV01
+ * come from the PositionService and RiskService listeners and move as fills are booked; the best
+ * bid/offer comes from the market data listener, which should be registered before the algo
+ * execution listener so orders are checked against the book that triggered them.
+ * Type T is the product type.
+ */
+template<typename T>
+class PreTradeRiskService : public Service<string, AlgoExecution<T>>
+{
+
+private:
+
+	struct alignas(64) ProductRiskState
+	{
+		long bookPositions[BOOK_COUNT];
+		double unitPV01;
+		double pv01;
+		Timestamp lastRefill;
+		//bond prices are multiples of 1/256, which a float holds exactly
+		float bestBid;
+		float bestOffer;
+		float tokens;
+		bool hasMarket;
+	};
+	static_assert(sizeof(ProductRiskState) == 64, "the risk state of a product should fill one cache line");
+
+	map<string, AlgoExecution<T>> algo_executions;
+	vector<ServiceListener<AlgoExecution<T>>*> listeners;
+	vector<ServiceListener<RejectedOrder<T>>*> reject_listeners;
+	PreTradeRiskToAlgoExecutionListener<T>* algo_execution_listener;
+	PreTradeRiskToMarketDataListener<T>* market_data_listener;
+	PreTradeRiskToPositionListener<T>* position_listener;
+	PreTradeRiskToRiskListener<T>* risk_listener;
+	Clock* clock;
+
+	vector<ProductRiskLimits> limits;
+	vector<ProductRiskState> states;
+	double portfolio_pv01;
+	double max_portfolio_pv01;
+	long accepted_count;
+	long rejected_count;
+
+public:
+
+	// Constructor and destructor
+	PreTradeRiskService(Clock* _clock = &DefaultClock());
+	~PreTradeRiskService();
+
+	// Get data on our service given a key
+	AlgoExecution<T>& GetData(string _key);
+
+	// The callback that a Connector should invoke for any new or updated data
+	void OnMessage(AlgoExecution<T>& _data);
+
+	// Add a listener to the Service for callbacks on add, remove, and update events for data to the Service
+	void AddListener(ServiceListener<AlgoExecution<T>>* _listener);
+
+	// Get all listeners on the Service
+	const vector<ServiceListener<AlgoExecution<T>>*>& GetListeners() const;
+
+	// Add a listener for rejected orders
+	void AddRejectListener(ServiceListener<RejectedOrder<T>>* _listener);
+
+	// Get all listeners for rejected orders
+	const vector<ServiceListener<RejectedOrder<T>>*>& GetRejectListeners() const;
+
+	// Get the listeners of the service
+	PreTradeRiskToAlgoExecutionListener<T>* GetAlgoExecutionListener();
+	PreTradeRiskToMarketDataListener<T>* GetMarketDataListener();
+	PreTradeRiskToPositionListener<T>* GetPositionListener();
+	PreTradeRiskToRiskListener<T>* GetRiskListener();
+
+	// Set the limits of a product
+	void SetLimits(const T& _product, const ProductRiskLimits& _limits);
+
+	// Get the limits of a product
+	const ProductRiskLimits& GetLimits(const T& _product) const;
+
+	// Set the limit on the absolute PV01 across all products
+	void SetPortfolioPV01Limit(double _limit);
+
+	// Run the checks on an order; a passing order takes a throttle token
+	RiskCheckResult CheckOrder(const ExecutionOrder<T>& _order);
+
+	// Check an algo order and forward it, or publish it as rejected
+	void ProcessOrder(AlgoExecution<T>& _data);
+
+	// Keep the best bid/offer of a product
+	void UpdateMarket(OrderBook<T>& _orderBook);
+
+	// Apply a position change booked on a product
+	void AddPosition(Position<T>& _position);
+
+	// Take the PV01 of a product from the risk service
+	void UpdateRisk(PV01<T>& _risk);
+
+	// Number of orders accepted and rejected so far
+	long GetAcceptedCount() const;
+	long GetRejectedCount() const;
+
+};
+
+template<typename T>
+PreTradeRiskService<T>::PreTradeRiskService(Clock* _clock)
+{
+	algo_executions = map<string, AlgoExecution<T>>();
+	listeners = vector<ServiceListener<AlgoExecution<T>>*>();
+	reject_listeners = vector<ServiceListener<RejectedOrder<T>>*>();
+	algo_execution_listener = new PreTradeRiskToAlgoExecutionListener<T>(this);
+	market_data_listener = new PreTradeRiskToMarketDataListener<T>(this);
+	position_listener = new PreTradeRiskToPositionListener<T>(this);
+	risk_listener = new PreTradeRiskToRiskListener<T>(this);
+	clock = _clock;
+
+	limits = vector<ProductRiskLimits>(get_product_count());
+	states = vector<ProductRiskState>(get_product_count());
+	for (int i = 0; i < get_product_count(); i++)
+	{
+		ProductRiskState& state = states[i];
+		for (int b = 0; b < BOOK_COUNT; b++) state.bookPositions[b] = 0;
+		state.unitPV01 = get_pv01(get_product_at<T>(i).GetProductId());
+		state.pv01 = 0;
+		state.bestBid = 0;
+		state.bestOffer = 0;
+		state.hasMarket = false;
+		state.lastRefill = NO_TIMESTAMP;
+
+		limits[i] = DEFAULT_RISK_LIMITS;
+		state.tokens = static_cast<float>(limits[i].orderBurst);
+	}
+
+	portfolio_pv01 = 0;
+	max_portfolio_pv01 = 200000000.0;
+	accepted_count = 0;
+	rejected_count = 0;
+}
+
+template<typename T>
+PreTradeRiskService<T>::~PreTradeRiskService() {}
+
+template<typename T>
+AlgoExecution<T>& PreTradeRiskService<T>::GetData(string _key)
+{
+	return algo_executions[_key];
+}
+
+template<typename T>
+void PreTradeRiskService<T>::OnMessage(AlgoExecution<T>& _data)
+{
+	ProcessOrder(_data);
+}
+
+template<typename T>
+void PreTradeRiskService<T>::AddListener(ServiceListener<AlgoExecution<T>>* _listener)
+{
+	listeners.push_back(_listener);
+}
+
+template<typename T>
+const vector<ServiceListener<AlgoExecution<T>>*>& PreTradeRiskService<T>::GetListeners() const
+{
+	return listeners;
+}
+
+template<typename T>
+void PreTradeRiskService<T>::AddRejectListener(ServiceListener<RejectedOrder<T>>* _listener)
+{
+	reject_listeners.push_back(_listener);
+}
+
+template<typename T>
+const vector<ServiceListener<RejectedOrder<T>>*>& PreTradeRiskService<T>::GetRejectListeners() const
+{
+	return reject_listeners;
+}
+
+template<typename T>
+PreTradeRiskToAlgoExecutionListener<T>* PreTradeRiskService<T>::GetAlgoExecutionListener()
+{
+	return algo_execution_listener;
+}
+
+template<typename T>
+PreTradeRiskToMarketDataListener<T>* PreTradeRiskService<T>::GetMarketDataListener()
+{
+	return market_data_listener;
+}
+
+template<typename T>
+PreTradeRiskToPositionListener<T>* PreTradeRiskService<T>::GetPositionListener()
+{
+	return position_listener;
+}
+
+template<typename T>
+PreTradeRiskToRiskListener<T>* PreTradeRiskService<T>::GetRiskListener()
+{
+	return risk_listener;
+}
+
+template<typename T>
+void PreTradeRiskService<T>::SetLimits(const T& _product, const ProductRiskLimits& _limits)
+{
+	int index = get_product_index(_product.GetProductId());
+	if (index < 0) return;
+
+	limits[index] = _limits;
+	states[index].tokens = static_cast<float>(_limits.orderBurst);
+	states[index].lastRefill = NO_TIMESTAMP;
+}
+
+template<typename T>
+const ProductRiskLimits& PreTradeRiskService<T>::GetLimits(const T& _product) const
+{
+	int index = get_product_index(_product.GetProductId());
+	return index < 0 ? DEFAULT_RISK_LIMITS : limits[index];
+}
+
+template<typename T>
+void PreTradeRiskService<T>::SetPortfolioPV01Limit(double _limit)
+{
+	max_portfolio_pv01 = _limit;
+}
+
+template<typename T>
+RiskCheckResult PreTradeRiskService<T>::CheckOrder(const ExecutionOrder<T>& _order)
+{
+	int index = get_product_index(_order.GetProduct().GetProductId());
+	if (index < 0) return RISK_UNKNOWN_PRODUCT;
+
+	const ProductRiskLimits& limit = limits[index];
+	ProductRiskState& state = states[index];
+
+	long quantity = _order.GetVisibleQuantity() + _order.GetHiddenQuantity();
+	if (quantity > limit.maxOrderSize) return RISK_ORDER_SIZE;
+
+	//fills are spread across the books, so the whole order has to fit in every book
+	long signed_quantity = _order.GetPricingSide() == BID ? quantity : -quantity;
+	for (int b = 0; b < BOOK_COUNT; b++)
+	{
+		if (std::abs(state.bookPositions[b] + signed_quantity) > limit.maxBookPosition) return RISK_POSITION_LIMIT;
+	}
+
+	double pv01_change = state.unitPV01 * signed_quantity;
+	if (std::fabs(state.pv01 + pv01_change) > limit.maxPV01) return RISK_PV01_LIMIT;
+	if (std::fabs(portfolio_pv01 + pv01_change) > max_portfolio_pv01) return RISK_PORTFOLIO_PV01_LIMIT;
+
+	if (!state.hasMarket) return RISK_NO_MARKET;
+	double price = _order.GetPrice();
+	if (price < state.bestBid - limit.priceBand || price > state.bestOffer + limit.priceBand) return RISK_PRICE_BAND;
+
+	if (limit.ordersPerSecond > 0)
+	{	//token bucket: refill for the time since the last order, capped at the burst
+		Timestamp now = _order.GetTimestamp() != NO_TIMESTAMP ? _order.GetTimestamp() : clock->Now();
+		if (state.lastRefill != NO_TIMESTAMP && now > state.lastRefill)
+		{
+			state.tokens = static_cast<float>(std::min(limit.orderBurst, state.tokens + (now - state.lastRefill) * limit.ordersPerSecond / 1000.0));
+		}
+		state.lastRefill = std::max(now, state.lastRefill);
+
+		if (state.tokens < 1.0) return RISK_ORDER_RATE;
+		state.tokens -= 1.0;
+	}
+
+	return RISK_ACCEPTED;
+}
+
+template<typename T>
+void PreTradeRiskService<T>::ProcessOrder(AlgoExecution<T>& _data)
+{
+	ExecutionOrder<T>* order = _data.GetExecutionOrder();
+	RiskCheckResult result = CheckOrder(*order);
+
+	if (result == RISK_ACCEPTED)
+	{
+		accepted_count++;
+		algo_executions[order->GetProduct().GetProductId()] = _data;
+		for (auto& l : listeners)
+		{
+			l->ProcessAdd(_data);
+		}
+	}
+	else
+	{
+		rejected_count++;
+		RejectedOrder<T> rejected(*order, result);
+		for (auto& l : reject_listeners)
+		{
+			l->ProcessAdd(rejected);
+		}
+	}
+}
+
+template<typename T>
+void PreTradeRiskService<T>::UpdateMarket(OrderBook<T>& _orderBook)
+{
+	int index = get_product_index(_orderBook.GetProduct().GetProductId());
+	if (index < 0) return;
+
+	ProductRiskState& state = states[index];
+	state.bestBid = static_cast<float>(_orderBook.GetBidStack()[0].GetPrice());
+	state.bestOffer = static_cast<float>(_orderBook.GetOfferStack()[0].GetPrice());
+	state.hasMarket = true;
+}
+
+template<typename T>
+void PreTradeRiskService<T>::AddPosition(Position<T>& _position)
+{
+	int index = get_product_index(_position.GetProduct().GetProductId());
+	if (index < 0) return;
+
+	//position service listeners get the change from a trade, not the total
+	for (int b = 0; b < BOOK_COUNT; b++)
+	{
+		states[index].bookPositions[b] += _position.GetPosition(TRADING_BOOKS[b]);
+	}
+}
+
+template<typename T>
+void PreTradeRiskService<T>::UpdateRisk(PV01<T>& _risk)
+{
+	int index = get_product_index(_risk.GetProduct().GetProductId());
+	if (index < 0) return;
+
+	double pv01 = _risk.GetPV01() * _risk.GetQuantity();
+	portfolio_pv01 += pv01 - states[index].pv01;
+	states[index].pv01 = pv01;
+	states[index].unitPV01 = _risk.GetPV01();
+}
+
+template<typename T>
+long PreTradeRiskService<T>::GetAcceptedCount() const
+{
+	return accepted_count;
+}
+
+template<typename T>
+long PreTradeRiskService<T>::GetRejectedCount() const
+{
+	return rejected_count;
+}
+
+/**
+* PreTradeRiskToAlgoExecutionListener listens to orders from AlgoExecutionService.
+* Type T is the product type.
+*/
+template<typename T>
+class PreTradeRiskToAlgoExecutionListener : public ServiceListener<AlgoExecution<T>>
+{
+
+private:
+
+	PreTradeRiskService<T>* service;
+
+public:
+
+	// Connector and Destructor
+	PreTradeRiskToAlgoExecutionListener(PreTradeRiskService<T>* _service);
+	~PreTradeRiskToAlgoExecutionListener();
+
+	// Listener callback to process an add event to the Service
+	void ProcessAdd(AlgoExecution<T>& _data);
+
+	// Listener callback to process a remove event to the Service
+	void ProcessRemove(AlgoExecution<T>& _data);
+
+	// Listener callback to process an update event to the Service
+	void ProcessUpdate(AlgoExecution<T>& _data);
+
+};
+
+template<typename T>
+PreTradeRiskToAlgoExecutionListener<T>::PreTradeRiskToAlgoExecutionListener(PreTradeRiskService<T>* _service)
+{
+	service = _service;
+}
+
+template<typename T>
+PreTradeRiskToAlgoExecutionListener<T>::~PreTradeRiskToAlgoExecutionListener() {}
+
+template<typename T>
+void PreTradeRiskToAlgoExecutionListener<T>::ProcessAdd(AlgoExecution<T>& _data)
+{
+	service->ProcessOrder(_data);
+}
+
+template<typename T>
+void PreTradeRiskToAlgoExecutionListener<T>::ProcessRemove(AlgoExecution<T>& _data) {}
+
+template<typename T>
+void PreTradeRiskToAlgoExecutionListener<T>::ProcessUpdate(AlgoExecution<T>& _data) {}
+
+/**
+* PreTradeRiskToMarketDataListener keeps the best bid/offer from MarketDataService.
+* Type T is the product type.
+*/
+template<typename T>
+class PreTradeRiskToMarketDataListener : public ServiceListener<OrderBook<T>>
+{
+
+private:
+
+	PreTradeRiskService<T>* service;
+
+public:
+
+	// Connector and Destructor
+	PreTradeRiskToMarketDataListener(PreTradeRiskService<T>* _service);
+	~PreTradeRiskToMarketDataListener();
+
+	// Listener callback to process an add event to the Service
+	void ProcessAdd(OrderBook<T>& _data);
+
+	// Listener callback to process a remove event to the Service
+	void ProcessRemove(OrderBook<T>& _data);
+
+	// Listener callback to process an update event to the Service
+	void ProcessUpdate(OrderBook<T>& _data);
+
+};
+
+template<typename T>
+PreTradeRiskToMarketDataListener<T>::PreTradeRiskToMarketDataListener(PreTradeRiskService<T>* _service)
+{
+	service = _service;
+}
+
+template<typename T>
+PreTradeRiskToMarketDataListener<T>::~PreTradeRiskToMarketDataListener() {}
+
+template<typename T>
+void PreTradeRiskToMarketDataListener<T>::ProcessAdd(OrderBook<T>& _data)
+{
+	service->UpdateMarket(_data);
+}
+
+template<typename T>
+void PreTradeRiskToMarketDataListener<T>::ProcessRemove(OrderBook<T>& _data) {}
+
+template<typename T>
+void PreTradeRiskToMarketDataListener<T>::ProcessUpdate(OrderBook<T>& _data) {}
+
+/**
+* PreTradeRiskToPositionListener listens to position changes from PositionService.
+* Type T is the product type.
+*/
+template<typename T>
+class PreTradeRiskToPositionListener : public ServiceListener<Position<T>>
+{
+
+private:
+
+	PreTradeRiskService<T>* service;
+
+public:
+
+	// Connector and Destructor
+	PreTradeRiskToPositionListener(PreTradeRiskService<T>* _service);
+	~PreTradeRiskToPositionListener();
+
+	// Listener callback to process an add event to the Service
+	void ProcessAdd(Position<T>& _data);
+
+	// Listener callback to process a remove event to the Service
+	void ProcessRemove(Position<T>& _data);
+
+	// Listener callback to process an update event to the Service
+	void ProcessUpdate(Position<T>& _data);
+
+};
+
+template<typename T>
+PreTradeRiskToPositionListener<T>::PreTradeRiskToPositionListener(PreTradeRiskService<T>* _service)
+{
+	service = _service;
+}
+
+template<typename T>
+PreTradeRiskToPositionListener<T>::~PreTradeRiskToPositionListener() {}
+
+template<typename T>
+void PreTradeRiskToPositionListener<T>::ProcessAdd(Position<T>& _data)
+{
+	service->AddPosition(_data);
+}
+
+template<typename T>
+void PreTradeRiskToPositionListener<T>::ProcessRemove(Position<T>& _data) {}
+
+template<typename T>
+void PreTradeRiskToPositionListener<T>::ProcessUpdate(Position<T>& _data) {}
+
+/**
+* PreTradeRiskToRiskListener listens to PV01 updates from RiskService.
+* Type T is the product type.
+*/
+template<typename T>
+class PreTradeRiskToRiskListener : public ServiceListener<PV01<T>>
+{
+
+private:
+
+	PreTradeRiskService<T>* service;
+
+public:
+
+	// Connector and Destructor
+	PreTradeRiskToRiskListener(PreTradeRiskService<T>* _service);
+	~PreTradeRiskToRiskListener();
+
+	// Listener callback to process an add event to the Service
+	void ProcessAdd(PV01<T>& _data);
+
+	// Listener callback to process a remove event to the Service
+	void ProcessRemove(PV01<T>& _data);
+
+	// Listener callback to process an update event to the Service
+	void ProcessUpdate(PV01<T>& _data);
+
+};
+
+template<typename T>
+PreTradeRiskToRiskListener<T>::PreTradeRiskToRiskListener(PreTradeRiskService<T>* _service)
+{
+	service = _service;
+}
+
+template<typename T>
+PreTradeRiskToRiskListener<T>::~PreTradeRiskToRiskListener() {}
+
+template<typename T>
+void PreTradeRiskToRiskListener<T>::ProcessAdd(PV01<T>& _data)
+{
+	service->UpdateRisk(_data);
+}
+
+template<typename T>
+void PreTradeRiskToRiskListener<T>::ProcessRemove(PV01<T>& _data) {}
+
+template<typename T>
+void PreTradeRiskToRiskListener<T>::ProcessUpdate(PV01<T>& _data) {}
+
+#endif
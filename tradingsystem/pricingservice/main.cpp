@@ -9,20 +9,39 @@
 #include "..\streamingservice\streamingservice.hpp"
 #include "..\guiservice\guiservice.hpp"
 #include "..\historicaldataservice\historicaldataservice.hpp"
+#include "..\filefollower.hpp"
 
-int main() 
+int main(int argc, char* argv[]) 
 {
 
+    //services run on the wall clock, or with --replay on a clock driven by the replayed data
+    //with --follow prices appended to the file keep being read until the process is interrupted
+    //with --threads n the file is parsed on n threads
+    //with --securities file products come from a security master file instead of the built in treasuries
+    Clock* clock = &DefaultClock();
+    bool follow = false;
+    int threads = 0;
+    std::string securities;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--replay") clock = new ReplayClock(0, 1, &SharedTimerWheel());
+        else if (std::string(argv[i]) == "--follow") follow = true;
+        else if (std::string(argv[i]) == "--threads" && i + 1 < argc) threads = std::stoi(argv[++i]);
+        else if (std::string(argv[i]) == "--securities" && i + 1 < argc) securities = argv[++i];
+    }
+
+    if (!securities.empty() && !load_security_master(securities)) return 1;
+
     //create bond pricing service and connect to bond pricing connector
-    PricingService<Bond>* bond_pricing_service = new PricingService<Bond>();
+    PricingService<Bond>* bond_pricing_service = new PricingService<Bond>(clock);
     PricingConnector<Bond>* bond_pricing_connector = bond_pricing_service->GetConnector();
 
     //connect algo streaming service with pricing services
     AlgoStreamingService<Bond>* algo_streaming_service = new AlgoStreamingService<Bond>();
     bond_pricing_service->AddListener(algo_streaming_service->GetListener());
 
-    //connect streaming service with algo streaming service
-    StreamingService<Bond>* streaming_serive = new StreamingService<Bond>();
+    //connect streaming service with algo streaming service; quotes live at least 100ms
+    StreamingService<Bond>* streaming_serive = new StreamingService<Bond>(100, clock);
     algo_streaming_service->AddListener(streaming_serive->GetListener());
 
 
@@ -32,14 +51,32 @@ int main()
 
 
     //create a guiservice and connect it to pricing service
-    GUIService<Bond>* gui_service = new GUIService<Bond>(300, 1000);
+    GUIService<Bond>* gui_service = new GUIService<Bond>(300, 1000, clock);
     bond_pricing_service->AddListener(gui_service->GetListener());
 
 
     //subscribe connector
     std::string filename = "prices.txt";
-    std::ifstream file(filename);
-    bond_pricing_connector->Subscribe(file);
+    if (follow)
+    {
+        install_stop_handler();
+        FileFollower follower(filename);
+        follower.Follow([&](const string& _line) { bond_pricing_connector->OnLine(_line); },
+            [&] { clock->AdvanceTimers(); return stop_requested(); });
+    }
+    else if (threads > 0)
+    {
+        bond_pricing_connector->SubscribeParallel(filename, threads);
+    }
+    else
+    {
+        std::ifstream file(filename);
+        bond_pricing_connector->Subscribe(file);
+    }
+
+    //publish the quotes still held back by the streaming policy and the GUI throttle
+    streaming_serive->Flush();
+    gui_service->Flush();
 
 
     return 0;
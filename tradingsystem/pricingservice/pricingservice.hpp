@@ -10,7 +10,9 @@
 
 #include <string>
 #include "..\soa.hpp"
+#include "..\csvtokenizer.hpp"
 #include "..\bondstaticdata.hpp"
+#include "..\parallelingest.hpp"
 /**
  * A price object consisting of mid and bid/offer spread.
  * Type T is the product type.
@@ -36,10 +38,17 @@ public:
   // Get the bid/offer spread around the mid
   double GetBidOfferSpread() const;
 
+  // Get the event time of the price
+  Timestamp GetTimestamp() const;
+
+  // Set the event time of the price
+  void SetTimestamp(Timestamp _timestamp);
+
 private:
-  T product;
+  ProductRef<T> product;
   double mid;
   double bidOfferSpread;
+  Timestamp timestamp = NO_TIMESTAMP;
 
 };
 
@@ -56,7 +65,7 @@ Price<T>::Price(const T& _product, double _mid, double _bidOfferSpread) :
 template<typename T>
 const T& Price<T>::GetProduct() const
 {
-    return product;
+    return product.Get();
 }
 
 template<typename T>
@@ -71,6 +80,18 @@ double Price<T>::GetBidOfferSpread() const
     return bidOfferSpread;
 }
 
+template<typename T>
+Timestamp Price<T>::GetTimestamp() const
+{
+    return timestamp;
+}
+
+template<typename T>
+void Price<T>::SetTimestamp(Timestamp _timestamp)
+{
+    timestamp = _timestamp;
+}
+
 
 
 //Pre-declearations
@@ -91,11 +112,12 @@ private:
     map<string, Price<T>> prices;
     vector<ServiceListener<Price<T>>*> listeners;
     PricingConnector<T>* connector;
+    Clock* clock;
 
 public:
 
     // Constructor and destructor
-    PricingService();
+    PricingService(Clock* _clock = &DefaultClock());
     ~PricingService();
 
     // Get data on our service given a key
@@ -104,6 +126,9 @@ public:
     // The callback that a Connector should invoke for any new or updated data
     void OnMessage(Price<T>& _data);
 
+    // The callback for a price the caller no longer needs; it is moved into the service
+    void OnMessage(Price<T>&& _data);
+
     // Add a listener to the Service for callbacks on add, remove, and update events for data to the Service
     void AddListener(ServiceListener<Price<T>>* _listener);
 
@@ -112,12 +137,16 @@ public:
 
     PricingConnector<T>* GetConnector() const;
 
+    // Get the clock used to timestamp prices
+    Clock* GetClock() const;
+
 };
 
 
 template<typename T>
-PricingService<T>::PricingService()
+PricingService<T>::PricingService(Clock* _clock)
 {
+    clock = _clock;
     prices = map<string, Price<T>>();
     listeners = vector<ServiceListener<Price<T>>*>();
     connector = new PricingConnector<T>(this);
@@ -143,6 +172,18 @@ void PricingService<T>::OnMessage(Price<T>& _data)
     }
 }
 
+template<typename T>
+void PricingService<T>::OnMessage(Price<T>&& _data)
+{
+    //the key is the registry product's id, which outlives the moved price
+    Price<T>& price = prices.insert_or_assign(_data.GetProduct().GetProductId(), std::move(_data)).first->second;
+
+    for (auto& l : listeners)
+    {
+        l->ProcessAdd(price);
+    }
+}
+
 template<typename T>
 void PricingService<T>::AddListener(ServiceListener<Price<T>>* _listener)
 {
@@ -161,9 +202,28 @@ PricingConnector<T>* PricingService<T>::GetConnector() const
     return connector;
 }
 
+template<typename T>
+Clock* PricingService<T>::GetClock() const
+{
+    return clock;
+}
+
+
+/**
+* A line of price data parsed off the dispatching thread, before it is stamped and becomes a Price.
+*/
+struct PriceRecord
+{
+    int productIndex;
+    double mid;
+    double spread;
+    Timestamp eventTime;
+};
 
 /**
 *Pricing Connector subscribing data to Pricing Service.
+*Lines are product,mid,spread with an optional trailing event time in milliseconds since epoch;
+*prices are stamped by the service clock.
 */
 template<typename T>
 class PricingConnector : public Connector<Price<T>>
@@ -172,6 +232,7 @@ class PricingConnector : public Connector<Price<T>>
 private:
 
     PricingService<T>* service;
+    long long skipped_count;
 
 public:
 
@@ -183,6 +244,20 @@ public:
     void Publish(Price<T>& _data);
     void Subscribe(ifstream& _data);
 
+    // Parse one line of price data and pass the price to the service
+    void OnLine(const string& _line);
+
+    // Handle the fields of one line of price data; lines with too few fields, an unknown product or
+    // a bad price are skipped, as SubscribeParallel does
+    void OnFields(const CsvLine& _line);
+
+    // Read a price file by parsing it on _threadCount threads; prices reach the service in file order.
+    // Returns the number of prices passed on, -1 if the file cannot be read.
+    long long SubscribeParallel(const string& _filename, int _threadCount);
+
+    // Number of malformed lines skipped
+    long long GetSkippedCount() const;
+
 };
 
 
@@ -191,6 +266,7 @@ template<typename T>
 PricingConnector<T>::PricingConnector(PricingService<T>* _service)
 {
     service = _service;
+    skipped_count = 0;
 }
 
 template<typename T>
@@ -207,25 +283,90 @@ void PricingConnector<T>::Subscribe(ifstream& _data)
         return;
     }
 
-    std::string line;
-    while (getline(_data, line)) {
-        std::stringstream ss(line);
-        std::string item;
-        std::vector<std::string> splittedItems;
+    long long skipped_before = skipped_count;
+    CsvReader reader;
+    reader.Read(_data, [this](const CsvLine& _line) { OnFields(_line); });
+    if (skipped_count > skipped_before)
+    {
+        std::cerr << "Skipped " << skipped_count - skipped_before << " malformed price lines" << std::endl;
+    }
+
+    _data.close();
+}
 
+template<typename T>
+void PricingConnector<T>::OnLine(const string& _line)
+{
+    CsvLine fields;
+    tokenize_line(_line.data(), _line.data() + _line.size(), fields);
+    OnFields(fields);
+}
+
+template<typename T>
+void PricingConnector<T>::OnFields(const CsvLine& _line)
+{
+    int index = _line.count < 3 ? -1 : get_ticker_index(_line.View(0));
+    double mid = index < 0 ? -1 : fractional_to_decimal(_line.View(1));
+    if (mid < 0)
+    {
+        skipped_count++;
+        return;
+    }
+    Timestamp event_time = _line.count > 3 ? _line.Integer(3) : NO_TIMESTAMP;
 
-        while (getline(ss, item, ','))
-        {
-            splittedItems.push_back(item);
-        }
+    Price<T> price(get_product_at<T>(index), mid, _line.Number(2));
+    price.SetTimestamp(service->GetClock()->Stamp(event_time));
+    service->OnMessage(std::move(price));
+}
 
-        T b = get_product<T>(splittedItems[0]);
-        Price<T> price(b, fractional_to_decimal(splittedItems[1]), std::stod(splittedItems[2]));
-        service->OnMessage(price);
+template<typename T>
+long long PricingConnector<T>::SubscribeParallel(const string& _filename, int _threadCount)
+{
+    auto parse = [](const char* _begin, const char* _end, PriceRecord& _record)
+    {
+        CsvLine line;
+        tokenize_line(_begin, _end, line);
+        if (line.count < 3) return false;
+
+        _record.productIndex = get_ticker_index(line.View(0));
+        if (_record.productIndex < 0) return false;
+
+        //rejected lines are only counted by the ingest: nothing is written to cerr from the workers
+        string_view mid = line.View(1);
+        int ticks;
+        if (!fractional_to_ticks(mid.data(), mid.size(), ticks)) return false;
+        _record.mid = static_cast<double>(ticks) / TICKS_PER_POINT;
+        _record.spread = line.Number(2);
+        _record.eventTime = line.count > 3 ? line.Integer(3) : NO_TIMESTAMP;
+        return true;
+    };
+
+    //stamping and the service run on this thread only
+    auto dispatch = [this](PriceRecord& _record)
+    {
+        Price<T> price(get_product_at<T>(_record.productIndex), _record.mid, _record.spread);
+        price.SetTimestamp(service->GetClock()->Stamp(_record.eventTime));
+        service->OnMessage(std::move(price));
+    };
 
+    ParallelIngest<PriceRecord> ingest(_threadCount);
+    if (!ingest.Run(_filename, parse, dispatch))
+    {
+        std::cerr << "Failed to open file" << std::endl;
+        return -1;
+    }
+    skipped_count += ingest.GetSkippedCount();
+    if (ingest.GetSkippedCount() > 0)
+    {
+        std::cerr << "Skipped " << ingest.GetSkippedCount() << " malformed price lines" << std::endl;
     }
+    return ingest.GetLineCount();
+}
 
-    _data.close();
+template<typename T>
+long long PricingConnector<T>::GetSkippedCount() const
+{
+    return skipped_count;
 }
 
 #endif
@@ -0,0 +1,369 @@
+/**
+ * securitymaster.hpp
+ * Security master loaded from a reference file at startup, for universes larger than the built in
+ * on-the-run treasuries. Securities are kept in a compact columnar table with hashed lookup by
+ * CUSIP and by ticker. The table is a single flat image, which is written next to the reference
+ * file as a binary cache and memory mapped on later starts instead of parsing the file again.
+ *
+ * @author Krystal Lin
+ */
+
+#ifndef SECURITYMASTER_HPP
+#define SECURITYMASTER_HPP
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_set>
+#include <filesystem>
+#include <cstring>
+#include <cstdint>
+#include "products.hpp"
+#include "csvtokenizer.hpp"
+#include "parallelingest.hpp"
+
+using namespace std;
+
+// Widest CUSIP and ticker kept, including the terminating zero
+const int SECURITY_CUSIP_LENGTH = 12;
+const int SECURITY_TICKER_LENGTH = 16;
+
+const uint32_t SECURITY_CACHE_MAGIC = 0x4D434553; //"SECM"
+const uint32_t SECURITY_CACHE_VERSION = 1;
+
+/**
+ * Start of a security master image. The columns follow in this order: PV01 (double), coupon
+ * (float), maturity as yyyymmdd (int32), CUSIP and ticker hash slots (int32, -1 when empty),
+ * then CUSIPs and tickers as fixed width zero padded text.
+ */
+struct SecurityImageHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t count;
+	uint32_t slotCount;
+	uint64_t sourceSize; //size and modification time of the reference file the image was built from
+	int64_t sourceTime;
+};
+
+// Seeded FNV-1a hash of a key
+constexpr uint32_t security_hash(string_view _key, uint32_t _seed)
+{
+	uint32_t hash = 2166136261u ^ _seed;
+	for (char c : _key)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 16777619u;
+	}
+	return hash ^ (hash >> 16);
+}
+
+/**
+ * Columnar table of securities read from a comma separated reference file with lines
+ * ticker,cusip,coupon,maturity,pv01 where the maturity is yyyy/mm/dd or yyyy-mm-dd. A first line
+ * starting with "ticker" is a header. Lookups use open addressing over slots twice the number of
+ * securities, so they are O(1).
+ */
+class SecurityMaster
+{
+
+private:
+
+	vector<char> image; //the table when built from the reference file
+	MappedFile cache; //the table when read from the binary cache
+	const SecurityImageHeader* header;
+	const double* pv01s;
+	const float* coupons;
+	const int32_t* maturities;
+	const int32_t* cusip_slots;
+	const int32_t* ticker_slots;
+	const char* cusips;
+	const char* tickers;
+	vector<Bond> bonds;
+
+	// Size of an image of _count securities and _slotCount slots
+	static size_t ImageSize(uint32_t _count, uint32_t _slotCount);
+
+	// Point the columns into an image
+	void Attach(const char* _image);
+
+	// Find a key in a slot table given the column it indexes
+	int Find(const int32_t* _slots, const char* _column, int _width, string_view _key) const;
+
+	// Build the image from the reference file; false if it cannot be read
+	bool Parse(const string& _filename, uint64_t _sourceSize, int64_t _sourceTime);
+
+	// Map the binary cache; false if it is missing or was built from another version of the reference file
+	bool ReadCache(const string& _cacheFilename, uint64_t _sourceSize, int64_t _sourceTime);
+
+	// Write the image to the binary cache, replacing it atomically
+	void WriteCache(const string& _cacheFilename) const;
+
+public:
+
+	SecurityMaster();
+
+	// Load a reference file, through its binary cache _filename.cache when it is up to date; false if it cannot be read
+	bool Load(const string& _filename);
+
+	// Number of securities; their indices run from 0 to GetCount() - 1
+	int GetCount() const;
+
+	// Get the index of a security by CUSIP, -1 if unknown
+	int FindCusip(string_view _cusip) const;
+
+	// Get the index of a security by ticker, -1 if unknown
+	int FindTicker(string_view _ticker) const;
+
+	// Get the PV01 of a security
+	double GetPV01(int _index) const;
+
+	// Get the bond of a security, built when the table was loaded
+	const Bond& GetBond(int _index) const;
+
+};
+
+SecurityMaster::SecurityMaster()
+{
+	header = nullptr;
+	pv01s = nullptr;
+	coupons = nullptr;
+	maturities = nullptr;
+	cusip_slots = nullptr;
+	ticker_slots = nullptr;
+	cusips = nullptr;
+	tickers = nullptr;
+}
+
+size_t SecurityMaster::ImageSize(uint32_t _count, uint32_t _slotCount)
+{
+	return sizeof(SecurityImageHeader) + _count * (sizeof(double) + sizeof(float) + sizeof(int32_t)) + 2 * _slotCount * sizeof(int32_t) + _count * (SECURITY_CUSIP_LENGTH + SECURITY_TICKER_LENGTH);
+}
+
+void SecurityMaster::Attach(const char* _image)
+{
+	header = reinterpret_cast<const SecurityImageHeader*>(_image);
+	const char* column = _image + sizeof(SecurityImageHeader);
+	pv01s = reinterpret_cast<const double*>(column);
+	column += header->count * sizeof(double);
+	coupons = reinterpret_cast<const float*>(column);
+	column += header->count * sizeof(float);
+	maturities = reinterpret_cast<const int32_t*>(column);
+	column += header->count * sizeof(int32_t);
+	cusip_slots = reinterpret_cast<const int32_t*>(column);
+	column += header->slotCount * sizeof(int32_t);
+	ticker_slots = reinterpret_cast<const int32_t*>(column);
+	column += header->slotCount * sizeof(int32_t);
+	cusips = column;
+	column += header->count * SECURITY_CUSIP_LENGTH;
+	tickers = column;
+}
+
+int SecurityMaster::Find(const int32_t* _slots, const char* _column, int _width, string_view _key) const
+{
+	if (header == nullptr) return -1;
+	uint32_t mask = header->slotCount - 1;
+	for (uint32_t slot = security_hash(_key, 0) & mask; ; slot = (slot + 1) & mask)
+	{
+		int32_t index = _slots[slot];
+		if (index < 0) return -1;
+		const char* text = _column + static_cast<size_t>(index) * _width;
+		if (_key.size() < static_cast<size_t>(_width) && memcmp(text, _key.data(), _key.size()) == 0 && text[_key.size()] == 0) return index;
+	}
+}
+
+bool SecurityMaster::Parse(const string& _filename, uint64_t _sourceSize, int64_t _sourceTime)
+{
+	ifstream file(_filename, ios::binary);
+	if (!file.is_open()) return false;
+
+	struct Row
+	{
+		string ticker;
+		string cusip;
+		float coupon;
+		int32_t maturity;
+		double pv01;
+	};
+	vector<Row> rows;
+	long long line_number = 0;
+	CsvReader reader;
+	reader.Read(file, [&](const CsvLine& _line)
+	{
+		line_number++;
+		if (line_number == 1 && _line.View(0) == "ticker") return;
+
+		//maturity as three numbers split by '/' or '-'
+		string_view maturity = _line.View(3);
+		int parts[3] = { 0, 0, 0 };
+		int part = 0;
+		bool valid = _line.count >= 4 && !_line.View(0).empty() && _line.lengths[0] < SECURITY_TICKER_LENGTH && !_line.View(1).empty() && _line.lengths[1] < SECURITY_CUSIP_LENGTH;
+		for (size_t i = 0; i < maturity.size() && valid; i++)
+		{
+			if (maturity[i] >= '0' && maturity[i] <= '9') parts[part] = parts[part] * 10 + (maturity[i] - '0');
+			else if ((maturity[i] == '/' || maturity[i] == '-') && part < 2) part++;
+			else valid = false;
+		}
+		valid = valid && part == 2;
+
+		Row row;
+		if (valid)
+		{
+			try
+			{
+				row.coupon = std::stof(_line.Field(2));
+				row.pv01 = _line.count > 4 ? std::stod(_line.Field(4)) : 0;
+				date checked(parts[0], parts[1], parts[2]);
+			}
+			catch (const exception&)
+			{
+				valid = false;
+			}
+		}
+		if (!valid)
+		{
+			std::cerr << "Skipping malformed security row " << line_number << " of " << _filename << std::endl;
+			return;
+		}
+		row.ticker = _line.Field(0);
+		row.cusip = _line.Field(1);
+		row.maturity = parts[0] * 10000 + parts[1] * 100 + parts[2];
+		rows.push_back(row);
+	});
+
+	//a CUSIP or ticker seen before is dropped
+	unordered_set<string> seen_cusips;
+	unordered_set<string> seen_tickers;
+	vector<Row> kept;
+	for (Row& row : rows)
+	{
+		if (!seen_cusips.insert(row.cusip).second || !seen_tickers.insert(row.ticker).second)
+		{
+			std::cerr << "Skipping duplicate security " << row.ticker << " " << row.cusip << std::endl;
+			continue;
+		}
+		kept.push_back(row);
+	}
+
+	uint32_t count = static_cast<uint32_t>(kept.size());
+	uint32_t slot_count = 1;
+	while (slot_count < 2 * count) slot_count <<= 1;
+
+	image = vector<char>(ImageSize(count, slot_count), 0);
+	SecurityImageHeader* image_header = reinterpret_cast<SecurityImageHeader*>(&image[0]);
+	*image_header = { SECURITY_CACHE_MAGIC, SECURITY_CACHE_VERSION, count, slot_count, _sourceSize, _sourceTime };
+	Attach(&image[0]);
+
+	//fill the columns through writable views of the image
+	double* pv01_column = const_cast<double*>(pv01s);
+	float* coupon_column = const_cast<float*>(coupons);
+	int32_t* maturity_column = const_cast<int32_t*>(maturities);
+	int32_t* cusip_column_slots = const_cast<int32_t*>(cusip_slots);
+	int32_t* ticker_column_slots = const_cast<int32_t*>(ticker_slots);
+	char* cusip_column = const_cast<char*>(cusips);
+	char* ticker_column = const_cast<char*>(tickers);
+	for (uint32_t slot = 0; slot < slot_count; slot++)
+	{
+		cusip_column_slots[slot] = -1;
+		ticker_column_slots[slot] = -1;
+	}
+
+	uint32_t mask = slot_count - 1;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const Row& row = kept[i];
+		pv01_column[i] = row.pv01;
+		coupon_column[i] = row.coupon;
+		maturity_column[i] = row.maturity;
+		memcpy(cusip_column + i * SECURITY_CUSIP_LENGTH, row.cusip.data(), row.cusip.size());
+		memcpy(ticker_column + i * SECURITY_TICKER_LENGTH, row.ticker.data(), row.ticker.size());
+
+		uint32_t slot = security_hash(row.cusip, 0) & mask;
+		while (cusip_column_slots[slot] >= 0) slot = (slot + 1) & mask;
+		cusip_column_slots[slot] = static_cast<int32_t>(i);
+		slot = security_hash(row.ticker, 0) & mask;
+		while (ticker_column_slots[slot] >= 0) slot = (slot + 1) & mask;
+		ticker_column_slots[slot] = static_cast<int32_t>(i);
+	}
+	return true;
+}
+
+bool SecurityMaster::ReadCache(const string& _cacheFilename, uint64_t _sourceSize, int64_t _sourceTime)
+{
+	if (!cache.Open(_cacheFilename) || cache.GetSize() < sizeof(SecurityImageHeader)) return false;
+	const SecurityImageHeader* cached = reinterpret_cast<const SecurityImageHeader*>(cache.GetData());
+	if (cached->magic != SECURITY_CACHE_MAGIC || cached->version != SECURITY_CACHE_VERSION) return false;
+	if (cached->sourceSize != _sourceSize || cached->sourceTime != _sourceTime) return false;
+	if (cached->slotCount == 0 || (cached->slotCount & (cached->slotCount - 1)) != 0) return false;
+	if (cache.GetSize() != ImageSize(cached->count, cached->slotCount)) return false;
+	Attach(cache.GetData());
+	return true;
+}
+
+void SecurityMaster::WriteCache(const string& _cacheFilename) const
+{
+	string temporary = _cacheFilename + ".tmp";
+	{
+		ofstream file(temporary, ios::binary | ios::trunc);
+		if (!file.is_open()) return;
+		file.write(image.data(), static_cast<streamsize>(image.size()));
+		if (!file) return;
+	}
+	error_code error;
+	filesystem::rename(temporary, _cacheFilename, error);
+	if (error) std::cerr << "Failed to write security cache " << _cacheFilename << std::endl;
+}
+
+bool SecurityMaster::Load(const string& _filename)
+{
+	error_code error;
+	uint64_t source_size = filesystem::file_size(_filename, error);
+	if (error) return false;
+	int64_t source_time = static_cast<int64_t>(filesystem::last_write_time(_filename, error).time_since_epoch().count());
+	if (error) return false;
+
+	string cache_filename = _filename + ".cache";
+	if (!ReadCache(cache_filename, source_size, source_time))
+	{
+		if (!Parse(_filename, source_size, source_time)) return false;
+		WriteCache(cache_filename);
+	}
+
+	bonds.clear();
+	bonds.reserve(header->count);
+	for (uint32_t i = 0; i < header->count; i++)
+	{
+		int32_t maturity = maturities[i];
+		bonds.push_back(Bond(string(cusips + i * SECURITY_CUSIP_LENGTH), CUSIP, string(tickers + i * SECURITY_TICKER_LENGTH), coupons[i], date(maturity / 10000, maturity / 100 % 100, maturity % 100)));
+	}
+	return true;
+}
+
+int SecurityMaster::GetCount() const
+{
+	return header != nullptr ? static_cast<int>(header->count) : 0;
+}
+
+int SecurityMaster::FindCusip(string_view _cusip) const
+{
+	return Find(cusip_slots, cusips, SECURITY_CUSIP_LENGTH, _cusip);
+}
+
+int SecurityMaster::FindTicker(string_view _ticker) const
+{
+	return Find(ticker_slots, tickers, SECURITY_TICKER_LENGTH, _ticker);
+}
+
+double SecurityMaster::GetPV01(int _index) const
+{
+	return pv01s[_index];
+}
+
+const Bond& SecurityMaster::GetBond(int _index) const
+{
+	return bonds[_index];
+}
+
+#endif
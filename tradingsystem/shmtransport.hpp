@@ -0,0 +1,576 @@
+/**
+ * shmtransport.hpp
+ * Shared memory transport between service processes: a broadcast ring of fixed size messages in
+ * a named shared memory segment, and connectors publishing to and subscribing from it.
+ * One process publishes on a ring; any number of processes subscribe, each reading every message
+ * at its own pace without locks or system calls on the data path.
+ *
+ * @author Krystal Lin
+ */
+
+#ifndef SHMTRANSPORT_HPP
+#define SHMTRANSPORT_HPP
+
+#include <string>
+#include <fstream>
+#include <new>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "soa.hpp"
+
+using namespace std;
+
+/**
+ * Fixed size wire encoding of a value type sent over a shared memory ring.
+ * Specializations define SIZE, the encoded size in bytes, and
+ *   static void Encode(const V& _data, char* _buffer);
+ *   static V Decode(const char* _buffer);
+ * Type V is the data type of the messages.
+ */
+template<typename V>
+struct ShmCodec;
+
+// Segment header, followed by the slots
+struct ShmRingHeader
+{
+	atomic<uint32_t> magic; //set last by the creator once the rest is initialized
+	uint32_t slot_size;
+	uint64_t capacity;
+	alignas(64) atomic<uint64_t> head; //number of messages published
+	alignas(64) atomic<uint32_t> closed; //set by the publisher after its last message
+};
+
+// Slot of the ring: the sequence is odd while the publisher writes, 2 * (n + 1) once it holds message n
+struct ShmRingSlot
+{
+	atomic<uint64_t> sequence;
+	char payload[1];
+};
+
+const uint32_t SHM_RING_MAGIC = 0x52494E47;
+
+/**
+ * Single publisher, multi subscriber broadcast ring in a named shared memory segment.
+ * Slots are published with a per slot sequence (a seqlock), so subscribers never block the
+ * publisher: a subscriber that falls more than the capacity behind detects it and skips ahead,
+ * counting the messages it lost.
+ */
+class ShmRing
+{
+
+private:
+
+	string name;
+	void* memory;
+	size_t mapped_size;
+	ShmRingHeader* header;
+	char* slots;
+	size_t slot_stride;
+	uint64_t mask;
+#ifdef _WIN32
+	HANDLE mapping;
+#endif
+
+	ShmRingSlot* Slot(uint64_t _sequence) const;
+
+public:
+
+	// Constructor; nothing is mapped until Create or Open succeeds
+	ShmRing(const string& _name);
+
+	~ShmRing();
+
+	// Create the segment as publisher, replacing any segment left under the name; _capacity is rounded up to a power of two
+	bool Create(size_t _slotSize, size_t _capacity);
+
+	// Map a segment created by a publisher; waits up to _timeoutMs for it to appear
+	bool Open(long _timeoutMs);
+
+	// Publish one message; only the creating process may call this
+	void Write(const char* _message);
+
+	// Read message _sequence into _message. Returns 1 if read, 0 if not published yet, -1 if it was overwritten.
+	int Read(uint64_t _sequence, char* _message) const;
+
+	// Number of messages published so far
+	uint64_t GetHead() const;
+
+	// Number of slots
+	uint64_t GetCapacity() const;
+
+	// Mark the stream as ended; subscribers stop once they have read everything before it
+	void Close();
+
+	// Check whether the publisher has closed the stream
+	bool IsClosed() const;
+
+	// Remove a segment name; processes that mapped it keep their mapping
+	static void Unlink(const string& _name);
+
+};
+
+ShmRing::ShmRing(const string& _name)
+{
+	name = _name;
+	memory = nullptr;
+	mapped_size = 0;
+	header = nullptr;
+	slots = nullptr;
+	slot_stride = 0;
+	mask = 0;
+#ifdef _WIN32
+	mapping = NULL;
+#endif
+}
+
+ShmRing::~ShmRing()
+{
+	if (memory == nullptr) return;
+#ifdef _WIN32
+	UnmapViewOfFile(memory);
+	CloseHandle(mapping);
+#else
+	munmap(memory, mapped_size);
+#endif
+}
+
+ShmRingSlot* ShmRing::Slot(uint64_t _sequence) const
+{
+	return reinterpret_cast<ShmRingSlot*>(slots + (_sequence & mask) * slot_stride);
+}
+
+bool ShmRing::Create(size_t _slotSize, size_t _capacity)
+{
+	uint64_t capacity = 1;
+	while (capacity < _capacity) capacity <<= 1;
+
+	//slots are cache line aligned so neighbouring messages never share a line
+	size_t stride = (offsetof(ShmRingSlot, payload) + _slotSize + 63) / 64 * 64;
+	size_t header_size = (sizeof(ShmRingHeader) + 63) / 64 * 64;
+	size_t size = header_size + stride * capacity;
+
+#ifdef _WIN32
+	mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(size) >> 32), static_cast<DWORD>(size), name.c_str());
+	if (mapping == NULL) return false;
+	memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (memory == nullptr) return false;
+#else
+	//a fresh segment every run, so subscribers never see messages of a previous publisher
+	shm_unlink(name.c_str());
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0) return false;
+	if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) return false;
+	memory = mapped;
+#endif
+	mapped_size = size;
+
+	header = new (memory) ShmRingHeader();
+	header->slot_size = static_cast<uint32_t>(_slotSize);
+	header->capacity = capacity;
+	header->head.store(0, memory_order_relaxed);
+	header->closed.store(0, memory_order_relaxed);
+
+	slots = static_cast<char*>(memory) + header_size;
+	slot_stride = stride;
+	mask = capacity - 1;
+	for (uint64_t i = 0; i < capacity; i++) new (&Slot(i)->sequence) atomic<uint64_t>(0);
+
+	header->magic.store(SHM_RING_MAGIC, memory_order_release);
+	return true;
+}
+
+bool ShmRing::Open(long _timeoutMs)
+{
+	size_t header_size = (sizeof(ShmRingHeader) + 63) / 64 * 64;
+	auto deadline = chrono::steady_clock::now() + chrono::milliseconds(_timeoutMs);
+
+	//the publisher may not have created the segment yet
+	while (true)
+	{
+#ifdef _WIN32
+		mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+		if (mapping != NULL)
+		{
+			ShmRingHeader* h = static_cast<ShmRingHeader*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, header_size));
+			if (h != nullptr && h->magic.load(memory_order_acquire) == SHM_RING_MAGIC)
+			{
+				size_t stride = (offsetof(ShmRingSlot, payload) + h->slot_size + 63) / 64 * 64;
+				size_t size = header_size + stride * h->capacity;
+				UnmapViewOfFile(h);
+				memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+				if (memory == nullptr) return false;
+				mapped_size = size;
+				break;
+			}
+			if (h != nullptr) UnmapViewOfFile(h);
+			CloseHandle(mapping);
+			mapping = NULL;
+		}
+#else
+		int fd = shm_open(name.c_str(), O_RDONLY, 0);
+		if (fd >= 0)
+		{
+			struct stat st;
+			if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= header_size)
+			{
+				void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+				if (mapped != MAP_FAILED)
+				{
+					if (static_cast<ShmRingHeader*>(mapped)->magic.load(memory_order_acquire) == SHM_RING_MAGIC)
+					{
+						close(fd);
+						memory = mapped;
+						mapped_size = static_cast<size_t>(st.st_size);
+						break;
+					}
+					munmap(mapped, static_cast<size_t>(st.st_size));
+				}
+			}
+			close(fd);
+		}
+#endif
+		if (chrono::steady_clock::now() >= deadline) return false;
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+
+	header = static_cast<ShmRingHeader*>(memory);
+	slots = static_cast<char*>(memory) + header_size;
+	slot_stride = (offsetof(ShmRingSlot, payload) + header->slot_size + 63) / 64 * 64;
+	mask = header->capacity - 1;
+	return true;
+}
+
+void ShmRing::Write(const char* _message)
+{
+	uint64_t sequence = header->head.load(memory_order_relaxed);
+	ShmRingSlot* slot = Slot(sequence);
+
+	slot->sequence.store(2 * sequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	memcpy(slot->payload, _message, header->slot_size);
+	slot->sequence.store(2 * (sequence + 1), memory_order_release);
+
+	header->head.store(sequence + 1, memory_order_release);
+}
+
+int ShmRing::Read(uint64_t _sequence, char* _message) const
+{
+	const ShmRingSlot* slot = Slot(_sequence);
+	uint64_t expected = 2 * (_sequence + 1);
+
+	uint64_t before = slot->sequence.load(memory_order_acquire);
+	if (before < expected) return 0;
+	if (before != expected) return -1;
+
+	memcpy(_message, slot->payload, header->slot_size);
+
+	//the publisher may have lapped us while we copied
+	atomic_thread_fence(memory_order_acquire);
+	return slot->sequence.load(memory_order_relaxed) == expected ? 1 : -1;
+}
+
+uint64_t ShmRing::GetHead() const
+{
+	return header->head.load(memory_order_acquire);
+}
+
+uint64_t ShmRing::GetCapacity() const
+{
+	return header->capacity;
+}
+
+void ShmRing::Close()
+{
+	header->closed.store(1, memory_order_release);
+}
+
+bool ShmRing::IsClosed() const
+{
+	return header->closed.load(memory_order_acquire) != 0;
+}
+
+void ShmRing::Unlink(const string& _name)
+{
+#ifndef _WIN32
+	shm_unlink(_name.c_str());
+#endif
+}
+
+/**
+ * Publisher connector writing each published value to a shared memory ring.
+ * Type V is the data type of the messages; it needs a ShmCodec specialization.
+ */
+template<typename V>
+class ShmPublishConnector : public Connector<V>
+{
+
+private:
+
+	ShmRing ring;
+	char buffer[ShmCodec<V>::SIZE];
+	bool ready;
+
+public:
+
+	// Constructor, creating the segment _name with _capacity slots
+	ShmPublishConnector(const string& _name, size_t _capacity = 65536);
+
+	// Check whether the segment was created
+	bool IsReady() const;
+
+	// Publish data to the ring
+	void Publish(V& _data);
+
+	// Publish-only connector: nothing to read
+	void Subscribe(ifstream& _data);
+
+	// End the stream; subscribers return from Run once they have read everything
+	void Close();
+
+};
+
+template<typename V>
+ShmPublishConnector<V>::ShmPublishConnector(const string& _name, size_t _capacity) : ring(_name)
+{
+	ready = ring.Create(ShmCodec<V>::SIZE, _capacity);
+}
+
+template<typename V>
+bool ShmPublishConnector<V>::IsReady() const
+{
+	return ready;
+}
+
+template<typename V>
+void ShmPublishConnector<V>::Publish(V& _data)
+{
+	if (!ready) return;
+	ShmCodec<V>::Encode(_data, buffer);
+	ring.Write(buffer);
+}
+
+template<typename V>
+void ShmPublishConnector<V>::Subscribe(ifstream& _data) {}
+
+template<typename V>
+void ShmPublishConnector<V>::Close()
+{
+	if (ready) ring.Close();
+}
+
+/**
+ * Subscriber connector reading a shared memory ring and passing every message to a listener,
+ * as ProcessAdd, on the thread calling Poll or Run.
+ * Type V is the data type of the messages; it needs a ShmCodec specialization.
+ */
+template<typename V>
+class ShmSubscribeConnector : public Connector<V>
+{
+
+private:
+
+	ShmRing ring;
+	ServiceListener<V>* listener;
+	uint64_t cursor;
+	uint64_t lost;
+	char buffer[ShmCodec<V>::SIZE];
+	bool ready;
+
+public:
+
+	// Constructor, mapping the segment _name; waits up to _timeoutMs for the publisher to create it
+	ShmSubscribeConnector(const string& _name, ServiceListener<V>* _listener, long _timeoutMs = 10000);
+
+	// Check whether the segment was mapped
+	bool IsReady() const;
+
+	// Subscribe-only connector: nothing to publish
+	void Publish(V& _data);
+
+	// Read the ring until the publisher closes it; the file is not used
+	void Subscribe(ifstream& _data);
+
+	// Deliver the messages published since the last call; returns how many were delivered
+	int Poll();
+
+	// Busy poll until the publisher closes the stream and everything is delivered, or _stop returns true,
+	// or nothing arrives for _idleTimeoutMs (0 waits forever) in case the publisher died without closing
+	void Run(function<bool()> _stop = nullptr, long _idleTimeoutMs = 0);
+
+	// Number of messages overwritten before this subscriber read them
+	uint64_t GetLostCount() const;
+
+	// Check whether the publisher closed the stream
+	bool IsClosed() const;
+
+};
+
+template<typename V>
+ShmSubscribeConnector<V>::ShmSubscribeConnector(const string& _name, ServiceListener<V>* _listener, long _timeoutMs) : ring(_name)
+{
+	listener = _listener;
+	cursor = 0;
+	lost = 0;
+	ready = ring.Open(_timeoutMs);
+
+	//start from the oldest message still in the ring, so a late subscriber misses as little as possible
+	if (ready)
+	{
+		uint64_t head = ring.GetHead();
+		if (head > ring.GetCapacity()) cursor = head - ring.GetCapacity();
+	}
+}
+
+template<typename V>
+bool ShmSubscribeConnector<V>::IsReady() const
+{
+	return ready;
+}
+
+template<typename V>
+void ShmSubscribeConnector<V>::Publish(V& _data) {}
+
+template<typename V>
+void ShmSubscribeConnector<V>::Subscribe(ifstream& _data)
+{
+	Run();
+}
+
+template<typename V>
+int ShmSubscribeConnector<V>::Poll()
+{
+	if (!ready) return 0;
+
+	int delivered = 0;
+	while (true)
+	{
+		int result = ring.Read(cursor, buffer);
+		if (result == 0) break;
+		if (result < 0)
+		{
+			//lapped by the publisher: skip to the oldest message still in the ring
+			uint64_t oldest = ring.GetHead() - ring.GetCapacity();
+			uint64_t next = oldest > cursor ? oldest : cursor + 1;
+			lost += next - cursor;
+			cursor = next;
+			continue;
+		}
+
+		cursor++;
+		V data = ShmCodec<V>::Decode(buffer);
+		listener->ProcessAdd(data);
+		delivered++;
+	}
+	return delivered;
+}
+
+template<typename V>
+void ShmSubscribeConnector<V>::Run(function<bool()> _stop, long _idleTimeoutMs)
+{
+	if (!ready) return;
+
+	auto last_delivery = chrono::steady_clock::now();
+	while (true)
+	{
+		//read closed before polling, so nothing published before the close is left behind
+		bool closed = ring.IsClosed();
+		int delivered = Poll();
+		if (closed && delivered == 0 && cursor >= ring.GetHead()) return;
+		if (_stop && _stop()) return;
+		if (delivered > 0)
+		{
+			last_delivery = chrono::steady_clock::now();
+			continue;
+		}
+		if (_idleTimeoutMs > 0 && chrono::steady_clock::now() - last_delivery >= chrono::milliseconds(_idleTimeoutMs)) return;
+		this_thread::yield();
+	}
+}
+
+template<typename V>
+uint64_t ShmSubscribeConnector<V>::GetLostCount() const
+{
+	return lost;
+}
+
+template<typename V>
+bool ShmSubscribeConnector<V>::IsClosed() const
+{
+	return ready && ring.IsClosed();
+}
+
+/**
+ * Listener publishing the events of a service to a shared memory ring, so a service in another
+ * process can subscribe to them.
+ * Type V is the data type of the events.
+ */
+template<typename V>
+class ShmPublishListener : public ServiceListener<V>
+{
+
+private:
+
+	ShmPublishConnector<V>* connector;
+
+public:
+
+	ShmPublishListener(ShmPublishConnector<V>* _connector);
+
+	// Listener callback to process an add event to the Service
+	void ProcessAdd(V& _data);
+
+	// Listener callback to process a remove event to the Service
+	void ProcessRemove(V& _data);
+
+	// Listener callback to process an update event to the Service
+	void ProcessUpdate(V& _data);
+
+};
+
+template<typename V>
+ShmPublishListener<V>::ShmPublishListener(ShmPublishConnector<V>* _connector)
+{
+	connector = _connector;
+}
+
+template<typename V>
+void ShmPublishListener<V>::ProcessAdd(V& _data)
+{
+	connector->Publish(_data);
+}
+
+template<typename V>
+void ShmPublishListener<V>::ProcessRemove(V& _data) {}
+
+template<typename V>
+void ShmPublishListener<V>::ProcessUpdate(V& _data)
+{
+	connector->Publish(_data);
+}
+
+#endif
@@ -0,0 +1,196 @@
+/**
+ * slottable.hpp
+ * Flat pooled storage addressed by compact handles. Used for tables of live objects
+ * (orders, parent orders, inquiries) that are created and retired at a high rate.
+ *
+ * @author Krystal Lin
+ */
+
+#ifndef SLOT_TABLE_HPP
+#define SLOT_TABLE_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Handle into a SlotTable: slot index in the low 32 bits, slot generation in the high 32 bits.
+typedef uint64_t SlotHandle;
+
+const SlotHandle INVALID_SLOT_HANDLE = ~0ULL;
+
+/**
+ * Slot table storing values contiguously in a single vector.
+ * Released slots are chained on a free list and reused, so the table never shrinks and
+ * never rehashes. Each slot carries a generation that is bumped on release, which makes
+ * handles to retired values stale instead of silently aliasing a newer value.
+ * Type V is the stored value type.
+ */
+template<typename V>
+class SlotTable
+{
+
+private:
+
+	struct Slot
+	{
+		V value;
+		uint32_t generation;
+		uint32_t next_free;
+		bool live;
+	};
+
+	vector<Slot> slots;
+	uint32_t free_head;
+	size_t live_count;
+
+	static const uint32_t NO_SLOT = ~0U;
+
+	static uint32_t IndexOf(SlotHandle _handle);
+	static uint32_t GenerationOf(SlotHandle _handle);
+
+public:
+
+	// Constructor, optionally reserving room for _capacity values up front
+	SlotTable(size_t _capacity = 0);
+
+	// Store a value and return its handle
+	SlotHandle Allocate(const V& _value);
+
+	// Get the value for a handle, nullptr if the handle is stale
+	V* Get(SlotHandle _handle);
+	const V* Get(SlotHandle _handle) const;
+
+	// Return the slot to the free list; false if the handle is stale
+	bool Release(SlotHandle _handle);
+
+	// Check whether the handle refers to a live value
+	bool IsLive(SlotHandle _handle) const;
+
+	// Number of live values
+	size_t Size() const;
+
+	// Number of slots allocated so far (live and free)
+	size_t Capacity() const;
+
+	// Call f(handle, value) for every live value
+	template<typename F>
+	void ForEach(F f);
+
+};
+
+template<typename V>
+uint32_t SlotTable<V>::IndexOf(SlotHandle _handle)
+{
+	return static_cast<uint32_t>(_handle & 0xFFFFFFFFULL);
+}
+
+template<typename V>
+uint32_t SlotTable<V>::GenerationOf(SlotHandle _handle)
+{
+	return static_cast<uint32_t>(_handle >> 32);
+}
+
+template<typename V>
+SlotTable<V>::SlotTable(size_t _capacity)
+{
+	slots = vector<Slot>();
+	slots.reserve(_capacity);
+	free_head = NO_SLOT;
+	live_count = 0;
+}
+
+template<typename V>
+SlotHandle SlotTable<V>::Allocate(const V& _value)
+{
+	uint32_t index;
+	if (free_head != NO_SLOT)
+	{	//reuse the most recently released slot
+		index = free_head;
+		free_head = slots[index].next_free;
+		slots[index].value = _value;
+	}
+	else
+	{
+		index = static_cast<uint32_t>(slots.size());
+		slots.push_back(Slot{ _value, 0, NO_SLOT, false });
+	}
+
+	Slot& slot = slots[index];
+	slot.live = true;
+	slot.next_free = NO_SLOT;
+	live_count++;
+
+	return (static_cast<SlotHandle>(slot.generation) << 32) | index;
+}
+
+template<typename V>
+V* SlotTable<V>::Get(SlotHandle _handle)
+{
+	uint32_t index = IndexOf(_handle);
+	if (index >= slots.size()) return nullptr;
+
+	Slot& slot = slots[index];
+	if (!slot.live || slot.generation != GenerationOf(_handle)) return nullptr;
+	return &slot.value;
+}
+
+template<typename V>
+const V* SlotTable<V>::Get(SlotHandle _handle) const
+{
+	uint32_t index = IndexOf(_handle);
+	if (index >= slots.size()) return nullptr;
+
+	const Slot& slot = slots[index];
+	if (!slot.live || slot.generation != GenerationOf(_handle)) return nullptr;
+	return &slot.value;
+}
+
+template<typename V>
+bool SlotTable<V>::Release(SlotHandle _handle)
+{
+	if (!IsLive(_handle)) return false;
+
+	uint32_t index = IndexOf(_handle);
+	Slot& slot = slots[index];
+	slot.live = false;
+	slot.generation++;
+	slot.next_free = free_head;
+	free_head = index;
+	live_count--;
+	return true;
+}
+
+template<typename V>
+bool SlotTable<V>::IsLive(SlotHandle _handle) const
+{
+	return Get(_handle) != nullptr;
+}
+
+template<typename V>
+size_t SlotTable<V>::Size() const
+{
+	return live_count;
+}
+
+template<typename V>
+size_t SlotTable<V>::Capacity() const
+{
+	return slots.size();
+}
+
+template<typename V>
+template<typename F>
+void SlotTable<V>::ForEach(F f)
+{
+	for (uint32_t i = 0; i < slots.size(); i++)
+	{
+		if (slots[i].live)
+		{
+			f((static_cast<SlotHandle>(slots[i].generation) << 32) | i, slots[i].value);
+		}
+	}
+}
+
+#endif
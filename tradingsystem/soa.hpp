@@ -9,6 +9,9 @@
 #define SOA_HPP
 
 #include <vector>
+#include <utility>
+#include "timerwheel.hpp"
+#include "clock.hpp"
 
 using namespace std;
 
@@ -50,6 +53,14 @@ public:
   // The callback that a Connector should invoke for any new or updated data
   virtual void OnMessage(V &data) = 0;
 
+  // The callback for data the caller no longer needs; a Service that stores data can move it
+  // into place instead of copying it. By default it is handled like any other data.
+  virtual void OnMessage(V &&data) { OnMessage(data); }
+
+  // Construct data from its constructor arguments and pass it to the Service as an rvalue
+  template<typename... Args>
+  void Emplace(Args&&... args) { OnMessage(V(std::forward<Args>(args)...)); }
+
   // Add a listener to the Service for callbacks on add, remove, and update events
   // for data to the Service.
   virtual void AddListener(ServiceListener<V> *listener) = 0;
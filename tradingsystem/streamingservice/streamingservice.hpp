@@ -8,9 +8,15 @@
 #ifndef STREAMING_SERVICE_HPP
 #define STREAMING_SERVICE_HPP
 
+#include <cmath>
+#include <algorithm>
+
 #include "..\soa.hpp"
+#include "..\bondstaticdata.hpp"
 #include "..\marketdataservice\marketdataservice.hpp"
 #include "..\pricingservice\pricingservice.hpp"
+#include "..\tradebookingservice\positionservice.hpp"
+#include "..\tradebookingservice\riskservice.hpp"
 #include "..\util.hpp"
 
 /**
@@ -102,17 +108,30 @@ public:
   // Get the offer order
   const PriceStreamOrder& GetOfferOrder() const;
 
+  // Get the event time of the price stream
+  Timestamp GetTimestamp() const;
+
+  // Set the event time of the price stream
+  void SetTimestamp(Timestamp _timestamp);
+
   //key used to persist data in historical data service
   string GetPersistKey() const;
 
   //data persisted in historical data service
   string GetPersistData() const;
 
+  //numeric columns persisted in historical data service
+  static vector<string> GetPersistColumns();
+
+  //values of the persisted columns, in the order of GetPersistColumns
+  void GetPersistValues(double* _values) const;
+
 
 private:
-  T product;
+  ProductRef<T> product;
   PriceStreamOrder bidOrder;
   PriceStreamOrder offerOrder;
+  Timestamp timestamp = NO_TIMESTAMP;
 
 };
 
@@ -125,7 +144,7 @@ PriceStream<T>::PriceStream(const T& _product, const PriceStreamOrder& _bidOrder
 template<typename T>
 const T& PriceStream<T>::GetProduct() const
 {
-	return product;
+	return product.Get();
 }
 
 template<typename T>
@@ -140,19 +159,30 @@ const PriceStreamOrder& PriceStream<T>::GetOfferOrder() const
 	return offerOrder;
 }
 
+template<typename T>
+Timestamp PriceStream<T>::GetTimestamp() const
+{
+	return timestamp;
+}
+
+template<typename T>
+void PriceStream<T>::SetTimestamp(Timestamp _timestamp)
+{
+	timestamp = _timestamp;
+}
+
 //key used to persist data in historical data service
 template<typename T>
 string PriceStream<T>::GetPersistKey() const
 {
-	return product.GetProductId();
+	return product.Get().GetProductId();
 }
 
 //data persisted in historical data service
 template<typename T>
 string PriceStream<T>::GetPersistData() const
 {
-	auto now = std::chrono::system_clock::now();
-	string s = timeToString(now) + " , " + this->GetPersistKey() + " , ";
+	string s = timeToString(timestamp) + " , " + this->GetPersistKey() + " , ";
 
 	s += ("BidOrder , Price: " + decimal_to_fractional(bidOrder.GetPrice()));
 	s += (" , Qty:" + std::to_string(bidOrder.GetHiddenQuantity() + bidOrder.GetVisibleQuantity()) + " , ");
@@ -161,6 +191,23 @@ string PriceStream<T>::GetPersistData() const
 	return s;
 }
 
+template<typename T>
+vector<string> PriceStream<T>::GetPersistColumns()
+{
+	return { "bidPrice", "bidVisibleQuantity", "bidHiddenQuantity", "offerPrice", "offerVisibleQuantity", "offerHiddenQuantity" };
+}
+
+template<typename T>
+void PriceStream<T>::GetPersistValues(double* _values) const
+{
+	_values[0] = bidOrder.GetPrice();
+	_values[1] = bidOrder.GetVisibleQuantity();
+	_values[2] = bidOrder.GetHiddenQuantity();
+	_values[3] = offerOrder.GetPrice();
+	_values[4] = offerOrder.GetVisibleQuantity();
+	_values[5] = offerOrder.GetHiddenQuantity();
+}
+
 
 
 /**
@@ -196,12 +243,40 @@ PriceStream<T>* AlgoStream<T>::GetPriceStream() const
 	return price_stream;
 }
 
+/**
+ * Parameters of the inventory skew applied to the quotes of a product.
+ * The skew ratio is the position over maxPosition or the PV01 over maxPV01, whichever is larger
+ * in size, capped at 1. At a full long ratio the quotes are shifted down by maxSkew half spreads
+ * and the bid size is zero; a short ratio mirrors this.
+ */
+struct QuoteSkewParameters
+{
+	long baseSize; //visible size quoted on each side when flat
+	long maxPosition; //aggregate position at which the skew is full
+	double maxPV01; //PV01, in RiskService units, at which the skew is full
+	double maxSkew; //price shift at full skew, in half spreads
+};
+
+const QuoteSkewParameters DEFAULT_QUOTE_SKEW = { 10000000, 100000000, 5000000.0, 1.0 };
+
+// Size increment of streamed quotes
+const long QUOTE_LOT_SIZE = 1000000;
+
 //pre declaration
 template <typename T>
 class AlgoStreamingToPricingListener;
 
+template <typename T>
+class AlgoStreamingToPositionListener;
+
+template <typename T>
+class AlgoStreamingToRiskListener;
+
 /**
  * Streaming service to send the bid/offer prices to the BondStreamingService
+ * Quotes are skewed in price and size by the inventory and PV01 of the product, taken from
+ * the position and risk service listeners. The inventory is cached per product in a flat array
+ * indexed by get_product_index so quoting does not look anything up in a map.
  * Keyed on product identifier.
  * Type T is the product type.
  */
@@ -210,10 +285,19 @@ class AlgoStreamingService : public Service<string, AlgoStream<T>>
 {
 private:
 
+	struct QuotingState
+	{
+		QuoteSkewParameters parameters;
+		long position;
+		double pv01;
+	};
+
 	map<string, AlgoStream<T>> algo_streams;
 	vector<ServiceListener<AlgoStream<T>>*> listeners;
 	ServiceListener<Price<T>>* stream_to_price_listener;
-	bool even;
+	AlgoStreamingToPositionListener<T>* position_listener;
+	AlgoStreamingToRiskListener<T>* risk_listener;
+	vector<QuotingState> quoting_states;
 
 public:
 
@@ -236,9 +320,24 @@ public:
 	// Get the stream_to_price_listener
 	ServiceListener<Price<T>>* GetListener();
 
+	// Get the listener to position updates
+	AlgoStreamingToPositionListener<T>* GetPositionListener();
+
+	// Get the listener to risk updates
+	AlgoStreamingToRiskListener<T>* GetRiskListener();
+
+	// Set the skew parameters of a product
+	void SetSkewParameters(const T& _product, const QuoteSkewParameters& _parameters);
+
 	// Publish price to listners when the service listern get updates from pricing service
 	void PublishPrice(Price<T>& _price);
 
+	// Apply a position change booked on a product
+	void AddPosition(Position<T>& _position);
+
+	// Take the PV01 of a product from the risk service
+	void UpdateRisk(PV01<T>& _risk);
+
 };
 
 template<typename T>
@@ -247,7 +346,16 @@ AlgoStreamingService<T>::AlgoStreamingService()
 	algo_streams = map<string, AlgoStream<T>>();
 	listeners = vector<ServiceListener<AlgoStream<T>>*>();
 	stream_to_price_listener = new AlgoStreamingToPricingListener<T>(this);
-	even = false;
+	position_listener = new AlgoStreamingToPositionListener<T>(this);
+	risk_listener = new AlgoStreamingToRiskListener<T>(this);
+
+	quoting_states = vector<QuotingState>(get_product_count());
+	for (auto& state : quoting_states)
+	{
+		state.parameters = DEFAULT_QUOTE_SKEW;
+		state.position = 0;
+		state.pv01 = 0;
+	}
 }
 
 template<typename T>
@@ -284,25 +392,57 @@ ServiceListener<Price<T>>* AlgoStreamingService<T>::GetListener()
 	return stream_to_price_listener;
 }
 
+template<typename T>
+AlgoStreamingToPositionListener<T>* AlgoStreamingService<T>::GetPositionListener()
+{
+	return position_listener;
+}
+
+template<typename T>
+AlgoStreamingToRiskListener<T>* AlgoStreamingService<T>::GetRiskListener()
+{
+	return risk_listener;
+}
+
+template<typename T>
+void AlgoStreamingService<T>::SetSkewParameters(const T& _product, const QuoteSkewParameters& _parameters)
+{
+	int index = get_product_index(_product.GetProductId());
+	if (index >= 0) quoting_states[index].parameters = _parameters;
+}
+
 template<typename T>
 void AlgoStreamingService<T>::PublishPrice(Price<T>& _price)
 {
-	T product = _price.GetProduct();
+	const T& product = _price.GetProduct();
 	string product_id = product.GetProductId();
 
 	double mid = _price.GetMid();
-	double spread = _price.GetBidOfferSpread();
-	double bid = mid - spread / 2.0;
-	double offer = mid + spread / 2.0;
-	long visible_qty = (even + 1) * 10000000;
-	long hidden_qty = visible_qty * 2;
+	double half_spread = _price.GetBidOfferSpread() / 2.0;
 
-	//negate the bool
-	even = !even;
+	//skew ratio in [-1, 1] from whichever of position and PV01 is closer to its limit
+	double skew = 0;
+	int index = get_product_index(product_id);
+	if (index >= 0)
+	{
+		const QuotingState& state = quoting_states[index];
+		const QuoteSkewParameters& parameters = state.parameters;
+		double position_ratio = parameters.maxPosition > 0 ? (double)state.position / parameters.maxPosition : 0;
+		double pv01_ratio = parameters.maxPV01 > 0 ? state.pv01 / parameters.maxPV01 : 0;
+		skew = std::fabs(position_ratio) > std::fabs(pv01_ratio) ? position_ratio : pv01_ratio;
+		skew = std::clamp(skew, -1.0, 1.0);
+		mid -= skew * parameters.maxSkew * half_spread;
+	}
+	long base_size = index >= 0 ? quoting_states[index].parameters.baseSize : DEFAULT_QUOTE_SKEW.baseSize;
 
-	PriceStreamOrder bid_order(bid, visible_qty, hidden_qty, BID);
-	PriceStreamOrder offer_order(offer, visible_qty, hidden_qty, OFFER);
+	//when long, shrink the bid and keep the offer; when short, the reverse. sizes are whole lots
+	long bid_qty = (long)(base_size * (1.0 - std::max(skew, 0.0)) / QUOTE_LOT_SIZE) * QUOTE_LOT_SIZE;
+	long offer_qty = (long)(base_size * (1.0 + std::min(skew, 0.0)) / QUOTE_LOT_SIZE) * QUOTE_LOT_SIZE;
+
+	PriceStreamOrder bid_order(mid - half_spread, bid_qty, bid_qty * 2, BID);
+	PriceStreamOrder offer_order(mid + half_spread, offer_qty, offer_qty * 2, OFFER);
 	AlgoStream<T> algo_stream(product, bid_order, offer_order);
+	algo_stream.GetPriceStream()->SetTimestamp(_price.GetTimestamp());
 	algo_streams[product_id] = algo_stream;
 
 	for (auto& l : listeners)
@@ -311,6 +451,21 @@ void AlgoStreamingService<T>::PublishPrice(Price<T>& _price)
 	}
 }
 
+template<typename T>
+void AlgoStreamingService<T>::AddPosition(Position<T>& _position)
+{
+	//position service listeners get the change from a trade, not the total
+	int index = get_product_index(_position.GetProduct().GetProductId());
+	if (index >= 0) quoting_states[index].position += _position.GetAggregatePosition();
+}
+
+template<typename T>
+void AlgoStreamingService<T>::UpdateRisk(PV01<T>& _risk)
+{
+	int index = get_product_index(_risk.GetProduct().GetProductId());
+	if (index >= 0) quoting_states[index].pv01 = _risk.GetPV01() * _risk.GetQuantity();
+}
+
 /**
 * AlgoStreamingToPricingListener listen to updates from Pricing Service
 * Type T is the product type.
@@ -362,12 +517,120 @@ template<typename T>
 void AlgoStreamingToPricingListener<T>::ProcessUpdate(Price<T>& _data) {}
 
 
+/**
+* AlgoStreamingToPositionListener listens to position changes from PositionService.
+* Type T is the product type.
+*/
+template<typename T>
+class AlgoStreamingToPositionListener : public ServiceListener<Position<T>>
+{
+
+private:
+
+	AlgoStreamingService<T>* service;
+
+public:
+
+	// Connector and Destructor
+	AlgoStreamingToPositionListener(AlgoStreamingService<T>* _service);
+	~AlgoStreamingToPositionListener();
+
+	// Listener callback to process an add event to the Service
+	void ProcessAdd(Position<T>& _data);
+
+	// Listener callback to process a remove event to the Service
+	void ProcessRemove(Position<T>& _data);
+
+	// Listener callback to process an update event to the Service
+	void ProcessUpdate(Position<T>& _data);
+
+};
+
+template<typename T>
+AlgoStreamingToPositionListener<T>::AlgoStreamingToPositionListener(AlgoStreamingService<T>* _service)
+{
+	service = _service;
+}
+
+template<typename T>
+AlgoStreamingToPositionListener<T>::~AlgoStreamingToPositionListener() {}
+
+template<typename T>
+void AlgoStreamingToPositionListener<T>::ProcessAdd(Position<T>& _data)
+{
+	service->AddPosition(_data);
+}
+
+template<typename T>
+void AlgoStreamingToPositionListener<T>::ProcessRemove(Position<T>& _data) {}
+
+template<typename T>
+void AlgoStreamingToPositionListener<T>::ProcessUpdate(Position<T>& _data) {}
+
+/**
+* AlgoStreamingToRiskListener listens to PV01 updates from RiskService.
+* Type T is the product type.
+*/
+template<typename T>
+class AlgoStreamingToRiskListener : public ServiceListener<PV01<T>>
+{
+
+private:
+
+	AlgoStreamingService<T>* service;
+
+public:
+
+	// Connector and Destructor
+	AlgoStreamingToRiskListener(AlgoStreamingService<T>* _service);
+	~AlgoStreamingToRiskListener();
+
+	// Listener callback to process an add event to the Service
+	void ProcessAdd(PV01<T>& _data);
+
+	// Listener callback to process a remove event to the Service
+	void ProcessRemove(PV01<T>& _data);
+
+	// Listener callback to process an update event to the Service
+	void ProcessUpdate(PV01<T>& _data);
+
+};
+
+template<typename T>
+AlgoStreamingToRiskListener<T>::AlgoStreamingToRiskListener(AlgoStreamingService<T>* _service)
+{
+	service = _service;
+}
+
+template<typename T>
+AlgoStreamingToRiskListener<T>::~AlgoStreamingToRiskListener() {}
+
+template<typename T>
+void AlgoStreamingToRiskListener<T>::ProcessAdd(PV01<T>& _data)
+{
+	service->UpdateRisk(_data);
+}
+
+template<typename T>
+void AlgoStreamingToRiskListener<T>::ProcessRemove(PV01<T>& _data) {}
+
+template<typename T>
+void AlgoStreamingToRiskListener<T>::ProcessUpdate(PV01<T>& _data) {}
+
+
 //Pre declearations 
 template<typename T>
 class StreamingToAlgoStreamingListener;
 
+template<typename T>
+class StreamingPublishTimerListener;
+
 /**
  * Streaming service to publish two-way prices.
+ * Publication goes through a per product policy: a quote identical to the last one published is
+ * dropped, and a product is republished at most once per minimum quote lifetime. Quotes arriving
+ * within the lifetime are coalesced, only the latest is kept and published when the lifetime
+ * ends, on a timer of the service clock. GetData always returns the latest quote received.
  * Keyed on product identifier.
  * Type T is the product type.
  */
@@ -377,14 +640,37 @@ class StreamingService : public Service<string,PriceStream <T> >
 
 private:
 
+	struct PublicationState
+	{
+		PriceStream<T> published; //last quote sent to listeners
+		PriceStream<T> pending; //latest quote held back by the lifetime
+		bool hasPublished;
+		bool hasPending;
+		Timestamp lastPublish;
+		TimerHandle timer;
+	};
+
 	map<string, PriceStream<T>> price_streams;
 	vector<ServiceListener<PriceStream<T>>*> listeners;
 	ServiceListener<AlgoStream<T>>* stream_to_algo_listener;
+	StreamingPublishTimerListener<T>* publish_timer;
+	Clock* clock;
+	TimerWheel* timer_wheel;
+	Timestamp min_quote_life;
+	vector<PublicationState> publication_states;
+	long published_count;
+	long suppressed_count;
+
+	// Check whether two streams quote the same prices and sizes
+	static bool IsSameQuote(const PriceStream<T>& _a, const PriceStream<T>& _b);
+
+	// Send a quote to the listeners and restart the lifetime of the product
+	void Send(int _index, PriceStream<T>& _price_stream, Timestamp _now);
 
 public:
 
-	// Constructor and destructor
-	StreamingService();
+	// Constructor and destructor; _minQuoteLife is in milliseconds, 0 only drops unchanged quotes
+	StreamingService(Timestamp _minQuoteLife = 0, Clock* _clock = &DefaultClock());
 	~StreamingService();
 
 
@@ -403,18 +689,43 @@ public:
 	// Get the stream_to_algo_listener
 	ServiceListener<AlgoStream<T>>* GetListener();
 
-	// Publish two-way prices
+	// Publish two-way prices, subject to the publication policy
 	void PublishPrice(PriceStream<T>& priceStream);
 
+	// Publish the coalesced quote of a product once its lifetime has ended
+	void ProcessPublishTimer(int _index, Timestamp _now);
+
+	// Publish every quote still held back, e.g. at the end of the input
+	void Flush();
+
+	// Number of quotes published and suppressed so far
+	long GetPublishedCount() const;
+	long GetSuppressedCount() const;
+
 };
 
 
 template<typename T>
-StreamingService<T>::StreamingService()
+StreamingService<T>::StreamingService(Timestamp _minQuoteLife, Clock* _clock)
 {
 	price_streams = map<string, PriceStream<T>>();
 	listeners = vector<ServiceListener<PriceStream<T>>*>();
 	stream_to_algo_listener = new StreamingToAlgoStreamingListener<T>(this);
+	publish_timer = new StreamingPublishTimerListener<T>(this);
+	clock = _clock;
+	timer_wheel = clock->GetTimerWheel() != nullptr ? clock->GetTimerWheel() : &SharedTimerWheel();
+	min_quote_life = _minQuoteLife;
+	published_count = 0;
+	suppressed_count = 0;
+
+	publication_states = vector<PublicationState>(get_product_count());
+	for (auto& state : publication_states)
+	{
+		state.hasPublished = false;
+		state.hasPending = false;
+		state.lastPublish = NO_TIMESTAMP;
+		state.timer = INVALID_TIMER_HANDLE;
+	}
 }
 
 template<typename T>
@@ -452,14 +763,146 @@ ServiceListener<AlgoStream<T>>* StreamingService<T>::GetListener()
 }
 
 template<typename T>
-void StreamingService<T>::PublishPrice(PriceStream<T>& _price_stream)
+bool StreamingService<T>::IsSameQuote(const PriceStream<T>& _a, const PriceStream<T>& _b)
 {
+	const PriceStreamOrder& a_bid = _a.GetBidOrder();
+	const PriceStreamOrder& a_offer = _a.GetOfferOrder();
+	const PriceStreamOrder& b_bid = _b.GetBidOrder();
+	const PriceStreamOrder& b_offer = _b.GetOfferOrder();
+
+	return a_bid.GetPrice() == b_bid.GetPrice() && a_offer.GetPrice() == b_offer.GetPrice()
+		&& a_bid.GetVisibleQuantity() == b_bid.GetVisibleQuantity() && a_bid.GetHiddenQuantity() == b_bid.GetHiddenQuantity()
+		&& a_offer.GetVisibleQuantity() == b_offer.GetVisibleQuantity() && a_offer.GetHiddenQuantity() == b_offer.GetHiddenQuantity();
+}
+
+template<typename T>
+void StreamingService<T>::Send(int _index, PriceStream<T>& _price_stream, Timestamp _now)
+{
+	PublicationState& state = publication_states[_index];
+	if (state.timer != INVALID_TIMER_HANDLE)
+	{
+		timer_wheel->Cancel(state.timer);
+		state.timer = INVALID_TIMER_HANDLE;
+	}
+
+	state.published = _price_stream;
+	state.hasPublished = true;
+	state.hasPending = false;
+	state.lastPublish = _now;
+	published_count++;
+
 	for (auto& l : listeners)
 	{
 		l->ProcessAdd(_price_stream);
 	}
 }
 
+template<typename T>
+void StreamingService<T>::PublishPrice(PriceStream<T>& _price_stream)
+{
+	int index = get_product_index(_price_stream.GetProduct().GetProductId());
+	if (index < 0)
+	{	//no policy state for products outside the static data
+		published_count++;
+		for (auto& l : listeners)
+		{
+			l->ProcessAdd(_price_stream);
+		}
+		return;
+	}
+
+	PublicationState& state = publication_states[index];
+
+	//back to the quote already out: nothing to send, and any held back quote is stale
+	if (state.hasPublished && IsSameQuote(state.published, _price_stream))
+	{
+		if (state.hasPending) suppressed_count++;
+		state.hasPending = false;
+		suppressed_count++;
+		return;
+	}
+
+	Timestamp now = clock->Now();
+	if (!state.hasPublished || now - state.lastPublish >= min_quote_life)
+	{
+		Send(index, _price_stream, now);
+		return;
+	}
+
+	//within the lifetime of the last quote: keep the latest and publish it when the lifetime ends
+	if (state.hasPending) suppressed_count++;
+	state.pending = _price_stream;
+	state.hasPending = true;
+	if (state.timer == INVALID_TIMER_HANDLE)
+	{
+		state.timer = timer_wheel->Schedule(state.lastPublish + min_quote_life, publish_timer, index);
+	}
+}
+
+template<typename T>
+void StreamingService<T>::ProcessPublishTimer(int _index, Timestamp _now)
+{
+	PublicationState& state = publication_states[_index];
+	state.timer = INVALID_TIMER_HANDLE;
+	if (state.hasPending) Send(_index, state.pending, _now);
+}
+
+template<typename T>
+void StreamingService<T>::Flush()
+{
+	for (int i = 0; i < static_cast<int>(publication_states.size()); i++)
+	{
+		if (publication_states[i].hasPending) Send(i, publication_states[i].pending, clock->Now());
+	}
+}
+
+template<typename T>
+long StreamingService<T>::GetPublishedCount() const
+{
+	return published_count;
+}
+
+template<typename T>
+long StreamingService<T>::GetSuppressedCount() const
+{
+	return suppressed_count;
+}
+
+/**
+* StreamingPublishTimerListener receives the publication timers of StreamingService.
+* The timer context is the product index.
+* Type T is the product type.
+*/
+template<typename T>
+class StreamingPublishTimerListener : public TimerListener
+{
+
+private:
+
+	StreamingService<T>* service;
+
+public:
+
+	// Constructor
+	StreamingPublishTimerListener(StreamingService<T>* _service);
+
+	// Timer callback
+	void ProcessTimer(uint64_t _context, long long _now);
+
+};
+
+template<typename T>
+StreamingPublishTimerListener<T>::StreamingPublishTimerListener(StreamingService<T>* _service)
+{
+	service = _service;
+}
+
+template<typename T>
+void StreamingPublishTimerListener<T>::ProcessTimer(uint64_t _context, long long _now)
+{
+	service->ProcessPublishTimer(static_cast<int>(_context), _now);
+}
+
 /**
 * StreamingToAlgoStreamingListener listens to updates from Algo Streaming Service.
 * Type T is the product type.
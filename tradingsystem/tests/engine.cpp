@@ -0,0 +1,137 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include "..\engine\engine.hpp"
+#include "..\executionservice\executionservice.hpp"
+#include "..\pretraderiskservice\pretraderiskservice.hpp"
+#include "..\tradebookingservice\tradebookingservice.hpp"
+#include "..\tradebookingservice\positionservice.hpp"
+#include "..\tradebookingservice\riskservice.hpp"
+
+int failures = 0;
+
+// Report a failed check
+void check(bool _passed, const std::string& _what)
+{
+    if (_passed) return;
+    std::cerr << _what << std::endl;
+    failures++;
+}
+
+// Records the thread each event was delivered on
+template<typename V>
+class ThreadRecorder : public ServiceListener<V>
+{
+public:
+    std::thread::id expected;
+    long count = 0;
+    long wrong_thread = 0;
+
+    void ProcessAdd(V& _data) { Record(); }
+    void ProcessRemove(V& _data) {}
+    void ProcessUpdate(V& _data) { Record(); }
+
+    void Record()
+    {
+        count++;
+        if (std::this_thread::get_id() != expected) wrong_thread++;
+    }
+};
+
+// An order of _quantity on the 2Y priced inside the book, for the pre-trade checks
+ExecutionOrder<Bond> make_order(PricingSide _side, long _quantity)
+{
+    return ExecutionOrder<Bond>(get_product_at<Bond>(0), _side, "TEST", MARKET, 99.5, _quantity, 0, "", false);
+}
+
+// Cross pipeline delivery as wired by the engine: fills from the market data pipeline are posted
+// to the booking pipeline, which books them into positions and risk on its own thread, and the
+// positions and risk are posted back to the pre-trade checks on the market data thread. Once both
+// threads are done, the checks have to see the booked positions and PV01.
+int main() {
+
+    const long fill_count = 3;
+    const long fill_quantity = 1000000;
+    const Bond& product = get_product_at<Bond>(0);
+
+    Mailbox market_data_mailbox;
+    Mailbox booking_mailbox;
+    ReplayClock market_data_clock(0);
+    ReplayClock booking_clock(0);
+
+    //booking pipeline: booking, positions and risk
+    TradeBookingService<Bond> trade_booking_service(&booking_clock);
+    PositionService<Bond> position_service;
+    trade_booking_service.AddListener(position_service.GetListener());
+    RiskService<Bond> risk_service;
+    position_service.AddListener(risk_service.GetListener());
+
+    //market data pipeline: the pre-trade checks against a book of 99.49 / 99.51
+    PreTradeRiskService<Bond> pre_trade_risk_service(&market_data_clock);
+    OrderBook<Bond> book(product, { Order(99.49, 10000000, BID) }, { Order(99.51, 10000000, OFFER) });
+    pre_trade_risk_service.UpdateMarket(book);
+
+    MailboxListener<ExecutionFill<Bond>> fill_listener(trade_booking_service.GetListener(), &booking_mailbox);
+    position_service.AddListener(new MailboxListener<Position<Bond>>(pre_trade_risk_service.GetPositionListener(), &market_data_mailbox));
+    risk_service.AddListener(new MailboxListener<PV01<Bond>>(pre_trade_risk_service.GetRiskListener(), &market_data_mailbox));
+    ThreadRecorder<Position<Bond>> positions;
+    position_service.AddListener(new MailboxListener<Position<Bond>>(&positions, &market_data_mailbox));
+    ThreadRecorder<PV01<Bond>> risks;
+    risk_service.AddListener(new MailboxListener<PV01<Bond>>(&risks, &market_data_mailbox));
+
+    //before any fill a BID of a book's worth fits every limit
+    ProductRiskLimits limits = DEFAULT_RISK_LIMITS;
+    limits.maxBookPosition = fill_quantity * 3 / 2;
+    limits.ordersPerSecond = 0;
+    pre_trade_risk_service.SetLimits(product, limits);
+    check(pre_trade_risk_service.CheckOrder(make_order(BID, fill_quantity)) == RISK_ACCEPTED, "BID rejected before any fill");
+
+    std::atomic<bool> fills_sent(false);
+    std::atomic<bool> booking_done(false);
+    std::thread booking_thread([&]
+    {
+        booking_mailbox.RunUntil([&] { return fills_sent.load(); });
+        booking_done = true;
+        market_data_mailbox.Wake();
+    });
+    std::thread market_data_thread([&]
+    {
+        positions.expected = std::this_thread::get_id();
+        risks.expected = std::this_thread::get_id();
+        for (long i = 0; i < fill_count; i++)
+        {
+            ExecutionFill<Bond> fill(product, "ORDER" + std::to_string(i), 1, BID, 99.51, fill_quantity, 0, ORDER_FILLED, i);
+            fill_listener.ProcessAdd(fill);
+        }
+        fills_sent = true;
+        booking_mailbox.Wake();
+        market_data_mailbox.RunUntil([&] { return booking_done.load(); });
+    });
+    booking_thread.join();
+    market_data_thread.join();
+
+    check(positions.count == fill_count, "positions delivered " + std::to_string(positions.count) + ", expected " + std::to_string(fill_count));
+    check(risks.count == fill_count, "risk delivered " + std::to_string(risks.count) + ", expected " + std::to_string(fill_count));
+    check(positions.wrong_thread == 0 && risks.wrong_thread == 0, "positions or risk delivered off the market data thread");
+
+    //the fills went one to each book, so another BID passes the book limit and an OFFER does not
+    check(pre_trade_risk_service.CheckOrder(make_order(BID, fill_quantity)) == RISK_POSITION_LIMIT, "BID not held at the book position limit");
+    check(pre_trade_risk_service.CheckOrder(make_order(OFFER, fill_quantity)) == RISK_ACCEPTED, "OFFER rejected after the fills");
+
+    //the PV01 of the booked position counts against the product limit
+    double unit_pv01 = get_pv01(product.GetProductId());
+    limits.maxBookPosition = DEFAULT_RISK_LIMITS.maxBookPosition;
+    limits.maxPV01 = std::fabs(unit_pv01) * (fill_count + 1) * fill_quantity;
+    pre_trade_risk_service.SetLimits(product, limits);
+    check(pre_trade_risk_service.CheckOrder(make_order(BID, 2 * fill_quantity)) == RISK_PV01_LIMIT, "BID not held at the PV01 limit");
+    check(pre_trade_risk_service.CheckOrder(make_order(OFFER, 2 * fill_quantity)) == RISK_ACCEPTED, "OFFER rejected under the PV01 limit");
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " failures" << std::endl;
+        return 1;
+    }
+    std::cout << fill_count << " fills booked and delivered to the pre-trade checks" << std::endl;
+    return 0;
+}
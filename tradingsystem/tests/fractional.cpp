@@ -0,0 +1,74 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "..\util.hpp"
+
+int failures = 0;
+
+// Report a failed check
+void fail(const std::string& _quote, const std::string& _what)
+{
+    if (failures < 20) std::cerr << _quote << ": " << _what << std::endl;
+    failures++;
+}
+
+// Every valid 32nd and 256th quote from 99 to 101 converts to its exact number of ticks and decimal
+// value, the list conversion agrees, and canonical quotes round trip through decimal_to_fractional.
+// Malformed quotes are rejected.
+int main() {
+
+    std::vector<std::string> quotes;
+    std::vector<int> expected;
+    std::vector<bool> canonical;
+    const char* suffixes[] = { "", "0", "1", "2", "3", "4", "5", "6", "7", "+" };
+    const int suffix_ticks[] = { 0, 0, 1, 2, 3, 4, 5, 6, 7, 4 };
+    for (int whole = 99; whole <= 101; whole++)
+    {
+        for (int x32 = 0; x32 < 32; x32++)
+        {
+            for (int s = 0; s < 10; s++)
+            {
+                quotes.push_back(std::to_string(whole) + "-" + (x32 < 10 ? "0" : "") + std::to_string(x32) + suffixes[s]);
+                expected.push_back(whole * TICKS_PER_POINT + x32 * 8 + suffix_ticks[s]);
+                //"0" and "4" have the shorter canonical forms without a digit and with '+'
+                canonical.push_back(s != 1 && s != 5);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < quotes.size(); i++)
+    {
+        const std::string& quote = quotes[i];
+        int ticks = -1;
+        if (!fractional_to_ticks(quote.data(), quote.size(), ticks)) fail(quote, "rejected");
+        else if (ticks != expected[i]) fail(quote, "got " + std::to_string(ticks) + " ticks, expected " + std::to_string(expected[i]));
+
+        if (fractional_to_decimal(quote) != static_cast<double>(expected[i]) / TICKS_PER_POINT) fail(quote, "wrong decimal value");
+
+        if (canonical[i] && decimal_to_fractional(static_cast<double>(expected[i]) / TICKS_PER_POINT) != quote) fail(quote, "does not round trip");
+    }
+
+    std::vector<std::string_view> views(quotes.begin(), quotes.end());
+    std::vector<int> ticks(quotes.size());
+    if (fractional_list_to_ticks(views.data(), views.size(), ticks.data()) != quotes.size()) fail("list", "rejected valid quotes");
+    for (size_t i = 0; i < quotes.size(); i++)
+    {
+        if (ticks[i] != expected[i]) fail(quotes[i], "wrong ticks from the list conversion");
+    }
+
+    const char* malformed[] = { "", "99", "99-", "99-0", "99-32", "99-40", "99-008", "99-00-", "99-0+0", "-99-00",
+        "99+00", "9a-00", "99-0a", "1000-00", "99-31++", "99 -00", "99-00 " };
+    for (const char* quote : malformed)
+    {
+        int value;
+        if (fractional_to_ticks(quote, strlen(quote), value)) fail(quote, "accepted");
+    }
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " failures" << std::endl;
+        return 1;
+    }
+    std::cout << quotes.size() << " quotes checked" << std::endl;
+    return 0;
+}
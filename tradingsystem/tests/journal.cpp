@@ -0,0 +1,189 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <filesystem>
+#include "..\historicaldataservice\journalindex.hpp"
+#include "..\bondstaticdata.hpp"
+
+int failures = 0;
+
+// Report a failed check
+void check(bool _passed, const std::string& _what)
+{
+    if (_passed) return;
+    std::cerr << _what << std::endl;
+    failures++;
+}
+
+// Append records _first to _last - 1 with their number as event time, cycling through the products
+void append(JournalWriter& _writer, long _first, long _last)
+{
+    char record[64];
+    for (long i = _first; i < _last; i++)
+    {
+        int product = static_cast<int>(i % get_product_count());
+        int length = snprintf(record, sizeof(record), "%ld,%s,%010ld", i, get_product_at<Bond>(product).GetProductId().c_str(), i);
+        _writer.Append(string_view(record, static_cast<size_t>(length)), i, product);
+    }
+}
+
+// Query a journal over every time and product; -1 if it cannot be opened
+long count_records(const std::string& _filename)
+{
+    JournalQuery query;
+    if (!query.Open(_filename)) return -1;
+    return static_cast<long>(query.Query(INT64_MIN, INT64_MAX, ALL_PRODUCTS, [](const JournalEntry& _entry, string_view _record) {}));
+}
+
+// Segments rotate at the size limit and give back their preallocated space, every record stays queryable
+// in order, and a reopened journal starts a new segment after the ones already written
+void check_size_rotation(const std::string& _directory)
+{
+    std::string filename = _directory + "/size.txt";
+    JournalPolicy policy;
+    policy.segmentBytes = 4096;
+    {
+        JournalWriter writer;
+        check(writer.Open(filename, policy), "size: failed to open");
+        append(writer, 0, 1000);
+        check(writer.GetSegments().size() >= 5, "size: " + std::to_string(writer.GetSegments().size()) + " closed segments");
+        for (const JournalSegment& segment : writer.GetSegments())
+        {
+            std::string segment_filename = journal_segment_filename(filename, segment.sequence);
+            check(std::filesystem::file_size(segment_filename) <= policy.segmentBytes, "size: " + segment_filename + " is over the limit");
+            check(std::filesystem::file_size(segment_filename) == segment.bytes, "size: " + segment_filename + " was not trimmed");
+        }
+        check(read_journal_segments(filename).size() == writer.GetSegments().size(), "size: catalog does not list the closed segments");
+    }
+
+    long expected = 0;
+    bool ordered = true;
+    JournalQuery query;
+    check(query.Open(filename), "size: failed to query");
+    size_t matched = query.Query(INT64_MIN, INT64_MAX, ALL_PRODUCTS, [&](const JournalEntry& _entry, string_view _record)
+    {
+        if (_entry.time != expected || std::stol(std::string(_record.substr(0, _record.find(',')))) != expected) ordered = false;
+        expected++;
+    });
+    check(matched == 1000 && ordered, "size: " + std::to_string(matched) + " records queried, in order " + std::to_string(ordered));
+    size_t first_product = 0;
+    for (long i = 100; i < 200; i++) first_product += i % get_product_count() == 0 ? 1 : 0;
+    check(query.Query(100, 199, 0, [](const JournalEntry& _entry, string_view _record) {}) == first_product, "size: wrong count for one product over a range");
+
+    //the segment left open is closed as it is and the next run writes a new one
+    size_t closed;
+    {
+        JournalWriter writer;
+        check(writer.Open(filename, policy), "size: failed to reopen");
+        closed = writer.GetSegments().size();
+        append(writer, 1000, 1010);
+    }
+    check(read_journal_segments(filename).size() == closed, "size: reopened catalog has " + std::to_string(read_journal_segments(filename).size()) + " segments");
+    check(count_records(filename) == 1010, "size: " + std::to_string(count_records(filename)) + " records after reopening");
+}
+
+// Segment age is measured on the clock of the policy, not the wall clock
+void check_age_rotation(const std::string& _directory)
+{
+    std::string filename = _directory + "/age.txt";
+    ReplayClock clock(0);
+    JournalPolicy policy;
+    policy.segmentMillis = 1000;
+    policy.clock = &clock;
+
+    JournalWriter writer;
+    check(writer.Open(filename, policy), "age: failed to open");
+    for (long i = 0; i < 50; i++)
+    {
+        clock.SetTime(i * 100);
+        append(writer, i, i + 1);
+    }
+    //written within a few ms of wall time, but 4900 ms apart on the clock
+    check(writer.GetSegments().size() == 4, "age: " + std::to_string(writer.GetSegments().size()) + " closed segments, expected 4");
+    for (const JournalSegment& segment : writer.GetSegments())
+    {
+        check(segment.records == 10, "age: segment " + std::to_string(segment.sequence) + " has " + std::to_string(segment.records) + " records");
+    }
+    check(count_records(filename) == 50, "age: " + std::to_string(count_records(filename)) + " records queried");
+}
+
+// Only the newest segments are kept, counting the one being written, and the deleted ones are gone
+void check_retention(const std::string& _directory)
+{
+    std::string filename = _directory + "/retain.txt";
+    JournalPolicy policy;
+    policy.segmentBytes = 4096;
+    policy.retainSegments = 3;
+
+    JournalWriter writer;
+    check(writer.Open(filename, policy), "retain: failed to open");
+    append(writer, 0, 2000);
+    const std::vector<JournalSegment>& segments = writer.GetSegments();
+    check(segments.size() == 2, "retain: " + std::to_string(segments.size()) + " closed segments kept");
+    check(read_journal_segments(filename).size() == segments.size(), "retain: catalog does not match the kept segments");
+    check(!std::filesystem::exists(journal_segment_filename(filename, 1)) && !std::filesystem::exists(journal_segment_filename(filename, 1) + ".idx"), "retain: oldest segment not deleted");
+
+    uint64_t kept = 0;
+    for (const JournalSegment& segment : segments) kept += segment.records;
+    JournalQuery query;
+    check(query.Open(filename) && query.GetSegmentCount() == 3, "retain: query does not see 3 segments");
+    long newest = -1;
+    size_t matched = query.Query(INT64_MIN, INT64_MAX, ALL_PRODUCTS, [&](const JournalEntry& _entry, string_view _record) { newest = _entry.time; });
+    check(matched > kept && matched < 2000 && newest == 1999, "retain: " + std::to_string(matched) + " records queried, newest " + std::to_string(newest));
+}
+
+// An index left with a partial block is recovered and extended; an index that no longer matches
+// its journal is rebuilt from the end of the journal, keeping the records already written
+void check_index_recovery(const std::string& _directory)
+{
+    std::string filename = _directory + "/recover.txt";
+    {
+        JournalWriter writer;
+        check(writer.Open(filename), "recover: failed to open");
+        append(writer, 0, 1500);
+    }
+    {
+        JournalWriter writer;
+        check(writer.Open(filename), "recover: failed to reopen");
+        append(writer, 1500, 2100);
+    }
+    check(std::filesystem::file_size(filename + ".blk") == 2 * sizeof(JournalBlock), "recover: partial block not carried over");
+    check(count_records(filename) == 2100, "recover: " + std::to_string(count_records(filename)) + " records after reopening");
+    JournalQuery query;
+    check(query.Open(filename) && query.Query(1000, 1099, ALL_PRODUCTS, [](const JournalEntry& _entry, string_view _record) {}) == 100, "recover: wrong count across the recovered block");
+
+    //a torn index entry no longer matches the journal
+    std::filesystem::resize_file(filename + ".idx", std::filesystem::file_size(filename + ".idx") - 5);
+    uintmax_t journal_size = std::filesystem::file_size(filename);
+    {
+        JournalWriter writer;
+        check(writer.Open(filename), "recover: failed to open with a torn index");
+        append(writer, 2100, 2110);
+    }
+    check(std::filesystem::file_size(filename) > journal_size, "recover: journal not kept");
+    check(count_records(filename) == 10, "recover: " + std::to_string(count_records(filename)) + " records in the rebuilt index");
+}
+
+// Journal rotation by size and by age on the policy clock, retention of the newest segments, and
+// recovery of the index when a journal is reopened, in a scratch directory that is removed after.
+int main() {
+
+    std::string directory = "journaltest";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    check_size_rotation(directory);
+    check_age_rotation(directory);
+    check_retention(directory);
+    check_index_recovery(directory);
+
+    std::filesystem::remove_all(directory);
+    if (failures > 0)
+    {
+        std::cerr << failures << " failures" << std::endl;
+        return 1;
+    }
+    std::cout << "rotation, retention and index recovery checked" << std::endl;
+    return 0;
+}
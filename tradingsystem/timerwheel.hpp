@@ -0,0 +1,394 @@
+/**
+ * timerwheel.hpp
+ * Hierarchical timer wheel shared by services that need to act at points in time rather than on data
+ * (GUI throttling, algo slicing, quote refresh, persistence flushing).
+ *
+ * @author Krystal Lin
+ */
+
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <bit>
+
+using namespace std;
+
+// Handle of a scheduled timer: node index in the low 32 bits, node generation in the high 32 bits.
+typedef uint64_t TimerHandle;
+
+const TimerHandle INVALID_TIMER_HANDLE = ~0ULL;
+
+/**
+ * Callback interface for timers registered on a TimerWheel.
+ * The context is the value given when the timer was scheduled.
+ */
+class TimerListener
+{
+
+public:
+
+	// Callback invoked when a timer expires; _now is the time the wheel was advanced to
+	virtual void ProcessTimer(uint64_t _context, long long _now) = 0;
+
+};
+
+/**
+ * Hierarchical timer wheel with 5 levels of 64 slots. Level l slots cover 64^l ticks, so the
+ * wheel spans 2^30 ticks; timers further out wait in an overflow list until the top level wraps.
+ * Timers are pooled nodes on intrusive lists, so Schedule and Cancel are O(1) and never allocate
+ * once the pool has grown. Advance jumps straight to the next tick where something is due, using
+ * a per level occupancy mask, so the cost of advancing does not depend on how many timers are
+ * armed nor on how far the clock moves.
+ * The wheel has no clock of its own: the owner advances it with wall clock time (AdvanceToWallClock)
+ * or with simulated time taken from replayed data (Advance).
+ */
+class TimerWheel
+{
+
+private:
+
+	static const int LEVELS = 5;
+	static const int SLOT_BITS = 6;
+	static const int SLOTS = 1 << SLOT_BITS;
+	static const uint32_t NIL = ~0U;
+
+	struct TimerNode
+	{
+		long long expiry;
+		long long tick;
+		TimerListener* listener;
+		uint64_t context;
+		uint32_t prev;
+		uint32_t next;
+		uint32_t generation;
+		bool armed;
+		bool overflow;
+	};
+
+	// nodes [0, SENTINELS) are list heads: one per slot, then the overflow and firing lists
+	static const uint32_t OVERFLOW_LIST = LEVELS * SLOTS;
+	static const uint32_t FIRING_LIST = OVERFLOW_LIST + 1;
+	static const uint32_t SENTINELS = FIRING_LIST + 1;
+
+	vector<TimerNode> nodes;
+	uint64_t occupancy[LEVELS]; //bit s set when slot s of the level is non empty
+	uint32_t free_head;
+	long long tick_size;
+	long long current_tick;
+	long long now;
+	size_t timer_count;
+	size_t overflow_count;
+
+	uint32_t AllocateNode();
+	void FreeNode(uint32_t _node);
+	void PushBack(uint32_t _list, uint32_t _node);
+	void Unlink(uint32_t _node);
+	bool IsEmpty(uint32_t _list) const;
+
+	// Put an armed node on the list matching its tick
+	void Place(uint32_t _node);
+
+	// Compute the next tick after current_tick where a slot has to be cascaded or fired
+	long long NextEventTick() const;
+
+	// Cascade higher levels and fire the level 0 slot for current_tick
+	void ProcessTick();
+
+public:
+
+	// Constructor; _tickSize is the wheel resolution in time units, _start the initial time
+	TimerWheel(long long _tickSize = 1, long long _start = 0);
+
+	// Schedule a timer to fire once the wheel reaches time _expiry
+	TimerHandle Schedule(long long _expiry, TimerListener* _listener, uint64_t _context);
+
+	// Cancel a pending timer; false if it already fired or was cancelled
+	bool Cancel(TimerHandle _handle);
+
+	// Advance the wheel to time _now, firing every timer that has expired
+	void Advance(long long _now);
+
+	// Advance the wheel to the current wall clock time in milliseconds
+	void AdvanceToWallClock();
+
+	// Get the time the wheel was last advanced to
+	long long Now() const;
+
+	// Get the number of pending timers
+	size_t Size() const;
+
+	// Wall clock time in milliseconds since epoch
+	static long long WallClockNow();
+
+};
+
+TimerWheel::TimerWheel(long long _tickSize, long long _start)
+{
+	nodes = vector<TimerNode>(SENTINELS);
+	for (uint32_t i = 0; i < SENTINELS; i++)
+	{
+		nodes[i].prev = i;
+		nodes[i].next = i;
+	}
+	for (int l = 0; l < LEVELS; l++) occupancy[l] = 0;
+
+	free_head = NIL;
+	tick_size = _tickSize > 0 ? _tickSize : 1;
+	current_tick = _start / tick_size;
+	now = _start;
+	timer_count = 0;
+	overflow_count = 0;
+}
+
+uint32_t TimerWheel::AllocateNode()
+{
+	if (free_head != NIL)
+	{
+		uint32_t node = free_head;
+		free_head = nodes[node].next;
+		return node;
+	}
+	nodes.push_back(TimerNode{ 0, 0, nullptr, 0, NIL, NIL, 0, false, false });
+	return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void TimerWheel::FreeNode(uint32_t _node)
+{
+	nodes[_node].armed = false;
+	nodes[_node].generation++;
+	nodes[_node].next = free_head;
+	free_head = _node;
+}
+
+void TimerWheel::PushBack(uint32_t _list, uint32_t _node)
+{
+	uint32_t tail = nodes[_list].prev;
+	nodes[_node].prev = tail;
+	nodes[_node].next = _list;
+	nodes[tail].next = _node;
+	nodes[_list].prev = _node;
+}
+
+void TimerWheel::Unlink(uint32_t _node)
+{
+	uint32_t prev = nodes[_node].prev;
+	uint32_t next = nodes[_node].next;
+	nodes[prev].next = next;
+	nodes[next].prev = prev;
+
+	//the list heads are the first nodes, clear the occupancy bit of a slot that became empty
+	if (prev == next && prev < OVERFLOW_LIST)
+	{
+		occupancy[prev / SLOTS] &= ~(1ULL << (prev % SLOTS));
+	}
+}
+
+bool TimerWheel::IsEmpty(uint32_t _list) const
+{
+	return nodes[_list].next == _list;
+}
+
+void TimerWheel::Place(uint32_t _node)
+{
+	long long delta = nodes[_node].tick - current_tick;
+
+	for (int l = 0; l < LEVELS; l++)
+	{
+		if (delta < (1LL << (SLOT_BITS * (l + 1))))
+		{
+			uint32_t slot = static_cast<uint32_t>((nodes[_node].tick >> (SLOT_BITS * l)) & (SLOTS - 1));
+			PushBack(l * SLOTS + slot, _node);
+			occupancy[l] |= 1ULL << slot;
+			nodes[_node].overflow = false;
+			return;
+		}
+	}
+
+	PushBack(OVERFLOW_LIST, _node);
+	nodes[_node].overflow = true;
+	overflow_count++;
+}
+
+TimerHandle TimerWheel::Schedule(long long _expiry, TimerListener* _listener, uint64_t _context)
+{
+	//round up so a timer never fires before its expiry; timers already due fire on the next advance
+	long long tick = (_expiry + tick_size - 1) / tick_size;
+	if (tick <= current_tick) tick = current_tick + 1;
+
+	uint32_t node = AllocateNode();
+	TimerNode& n = nodes[node];
+	n.expiry = _expiry;
+	n.tick = tick;
+	n.listener = _listener;
+	n.context = _context;
+	n.armed = true;
+
+	Place(node);
+	timer_count++;
+
+	return (static_cast<TimerHandle>(n.generation) << 32) | node;
+}
+
+bool TimerWheel::Cancel(TimerHandle _handle)
+{
+	uint32_t node = static_cast<uint32_t>(_handle & 0xFFFFFFFFULL);
+	uint32_t generation = static_cast<uint32_t>(_handle >> 32);
+	if (node < SENTINELS || node >= nodes.size()) return false;
+	if (!nodes[node].armed || nodes[node].generation != generation) return false;
+
+	if (nodes[node].overflow) overflow_count--;
+
+	Unlink(node);
+	FreeNode(node);
+	timer_count--;
+	return true;
+}
+
+long long TimerWheel::NextEventTick() const
+{
+	long long next = -1;
+
+	for (int l = 0; l < LEVELS; l++)
+	{
+		if (occupancy[l] == 0) continue;
+
+		int shift = SLOT_BITS * l;
+		int index = static_cast<int>((current_tick >> shift) & (SLOTS - 1));
+
+		//rotate so bit 0 is the slot after the current one, the first set bit is the next slot due
+		int start = (index + 1) & (SLOTS - 1);
+		int offset = std::countr_zero(std::rotr(occupancy[l], start)) + 1;
+
+		long long tick = ((current_tick >> shift) + offset) << shift;
+		if (next < 0 || tick < next) next = tick;
+	}
+
+	if (overflow_count > 0)
+	{	//overflow timers are re-placed when the top level wraps
+		int shift = SLOT_BITS * LEVELS;
+		long long tick = ((current_tick >> shift) + 1) << shift;
+		if (next < 0 || tick < next) next = tick;
+	}
+
+	return next;
+}
+
+void TimerWheel::ProcessTick()
+{
+	if (overflow_count > 0 && (current_tick & ((1LL << (SLOT_BITS * LEVELS)) - 1)) == 0)
+	{
+		uint32_t n = nodes[OVERFLOW_LIST].next;
+		nodes[OVERFLOW_LIST].next = OVERFLOW_LIST;
+		nodes[OVERFLOW_LIST].prev = OVERFLOW_LIST;
+		overflow_count = 0;
+		while (n != OVERFLOW_LIST)
+		{
+			uint32_t next = nodes[n].next;
+			Place(n);
+			n = next;
+		}
+	}
+
+	//cascade from the top so timers moving down several levels are redistributed in one pass
+	for (int l = LEVELS - 1; l >= 1; l--)
+	{
+		int shift = SLOT_BITS * l;
+		if ((current_tick & ((1LL << shift) - 1)) != 0) continue;
+
+		uint32_t slot = static_cast<uint32_t>((current_tick >> shift) & (SLOTS - 1));
+		uint32_t list = l * SLOTS + slot;
+		if (IsEmpty(list)) continue;
+
+		uint32_t n = nodes[list].next;
+		nodes[list].next = list;
+		nodes[list].prev = list;
+		occupancy[l] &= ~(1ULL << slot);
+		while (n != list)
+		{
+			uint32_t next = nodes[n].next;
+			Place(n);
+			n = next;
+		}
+	}
+
+	uint32_t slot = static_cast<uint32_t>(current_tick & (SLOTS - 1));
+	if (IsEmpty(slot)) return;
+
+	//move the due timers to the firing list, callbacks may schedule or cancel other timers
+	uint32_t first = nodes[slot].next;
+	uint32_t last = nodes[slot].prev;
+	nodes[FIRING_LIST].next = first;
+	nodes[FIRING_LIST].prev = last;
+	nodes[first].prev = FIRING_LIST;
+	nodes[last].next = FIRING_LIST;
+	nodes[slot].next = slot;
+	nodes[slot].prev = slot;
+	occupancy[0] &= ~(1ULL << slot);
+
+	while (!IsEmpty(FIRING_LIST))
+	{
+		uint32_t node = nodes[FIRING_LIST].next;
+		TimerListener* listener = nodes[node].listener;
+		uint64_t context = nodes[node].context;
+
+		Unlink(node);
+		FreeNode(node);
+		timer_count--;
+
+		listener->ProcessTimer(context, now);
+	}
+}
+
+void TimerWheel::Advance(long long _now)
+{
+	if (_now < now) return;
+
+	long long target_tick = _now / tick_size;
+	now = _now;
+
+	while (current_tick < target_tick)
+	{
+		long long next = timer_count > 0 ? NextEventTick() : -1;
+		if (next < 0 || next > target_tick)
+		{
+			current_tick = target_tick;
+			break;
+		}
+
+		current_tick = next;
+		ProcessTick();
+	}
+}
+
+void TimerWheel::AdvanceToWallClock()
+{
+	Advance(WallClockNow());
+}
+
+long long TimerWheel::Now() const
+{
+	return now;
+}
+
+size_t TimerWheel::Size() const
+{
+	return timer_count;
+}
+
+long long TimerWheel::WallClockNow()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Timer wheel shared by all services of the process
+TimerWheel& SharedTimerWheel()
+{
+	static TimerWheel timer_wheel;
+	return timer_wheel;
+}
+
+#endif
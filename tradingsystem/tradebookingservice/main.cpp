@@ -8,9 +8,26 @@
 #include "tradebookingservice.hpp"
 #include "positionservice.hpp"
 #include "riskservice.hpp"
+#include "..\executionservice\executionservice.hpp"
 #include "..\historicaldataservice\historicaldataservice.hpp"
+#include "..\filefollower.hpp"
 
-int main() {
+int main(int argc, char* argv[]) {
+
+    //with --shm fills published by the market data process are booked too
+    //with --follow trades appended to the file keep being read until the process is interrupted
+    //with --securities file products come from a security master file instead of the built in treasuries
+    bool shm = false;
+    bool follow = false;
+    std::string securities;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--shm") shm = true;
+        else if (std::string(argv[i]) == "--follow") follow = true;
+        else if (std::string(argv[i]) == "--securities" && i + 1 < argc) securities = argv[++i];
+    }
+
+    if (!securities.empty() && !load_security_master(securities)) return 1;
 
     //create a trade booking service and subscribe to the booking connector to get trade data
     TradeBookingService<Bond>* bond_booking_service = new TradeBookingService<Bond>();
@@ -37,10 +54,55 @@ int main() {
     bond_risk_service->AddListener(historical_risk_service.GetListener());
 
 
+    //subscribe to the fills before reading the trades, and poll them between trade lines,
+    //so fills published meanwhile are booked before the ring wraps over them
+    ShmSubscribeConnector<ExecutionFill<Bond>>* fill_subscriber = nullptr;
+    if (shm)
+    {
+        install_stop_handler();
+        fill_subscriber = new ShmSubscribeConnector<ExecutionFill<Bond>>(FILLS_SHM_NAME, bond_booking_service->GetListener());
+        if (!fill_subscriber->IsReady()) std::cerr << "No fills published on " << FILLS_SHM_NAME << std::endl;
+    }
+
     //start reading trade data
     std::string filename = "trades.txt";
-    std::ifstream file(filename);
-    bond_booking_connector->Subscribe(file);
+    if (follow)
+    {
+        install_stop_handler();
+        FileFollower follower(filename);
+        follower.Follow([&](const string& _line)
+            {
+                bond_booking_connector->OnLine(_line);
+                if (fill_subscriber != nullptr) fill_subscriber->Poll();
+            },
+            [&]
+            {
+                if (fill_subscriber != nullptr) fill_subscriber->Poll();
+                DefaultClock().AdvanceTimers();
+                return stop_requested();
+            });
+    }
+    else
+    {
+        std::ifstream file(filename);
+        if (!file.is_open()) std::cerr << "Failed to open " << filename << std::endl;
+        CsvReader reader;
+        reader.Read(file, [&](const CsvLine& _line)
+            {
+                bond_booking_connector->OnFields(_line);
+                if (fill_subscriber != nullptr) fill_subscriber->Poll();
+            });
+    }
+
+    //then keep booking the fills published by the market data process, until it closes the stream;
+    //give up on interrupt or when nothing arrives for FILLS_IDLE_TIMEOUT_MS, in case it died without closing
+    if (fill_subscriber != nullptr)
+    {
+        fill_subscriber->Run([] { return stop_requested(); }, FILLS_IDLE_TIMEOUT_MS);
+        if (!fill_subscriber->IsClosed()) std::cerr << "Fill stream on " << FILLS_SHM_NAME << " ended without being closed" << std::endl;
+        if (fill_subscriber->GetLostCount() > 0) std::cerr << fill_subscriber->GetLostCount() << " fills lost" << std::endl;
+        ShmRing::Unlink(FILLS_SHM_NAME);
+    }
 
     return 0;
 }
\ No newline at end of file
@@ -36,7 +36,7 @@ public:
   const T& GetProduct() const;
 
   // Get the position quantity
-  long GetPosition(string &book);
+  long GetPosition(const string &book);
 
   // Get the aggregate position
   long GetAggregatePosition() const;
@@ -44,15 +44,28 @@ public:
   //update the position quantity for a particular book
   void UpdatePosition(string& book, long quantity);
 
+  // Get the event time of the last position change
+  Timestamp GetTimestamp() const;
+
+  // Set the event time of the last position change
+  void SetTimestamp(Timestamp _timestamp);
+
   //key used to persist data in historical data service
   string GetPersistKey() const;
 
   //data persisted in historical data service
   string GetPersistData() const;
 
+  //numeric columns persisted in historical data service
+  static vector<string> GetPersistColumns();
+
+  //values of the persisted columns, in the order of GetPersistColumns
+  void GetPersistValues(double* _values) const;
+
 private:
-  T product;
+  ProductRef<T> product;
   map<string,long> positions;
+  Timestamp timestamp = NO_TIMESTAMP;
 
 };
 
@@ -61,7 +74,7 @@ Position<T>::Position(const T& _product) :
 	product(_product)
 {
 	//initialize positions for all books
-	positions = { {"TRSY1", 0}, {"TRSY2", 0} , {"TRSY3", 0} };
+	for (const auto& book : TRADING_BOOKS) positions[book] = 0;
 }
 
 
@@ -75,15 +88,27 @@ void Position<T>::UpdatePosition(string& book, long quantity)
 template<typename T>
 const T& Position<T>::GetProduct() const
 {
-	return product;
+	return product.Get();
 }
 
 template<typename T>
-long Position<T>::GetPosition(string& book)
+long Position<T>::GetPosition(const string& book)
 {
 	return positions[book];
 }
 
+template<typename T>
+Timestamp Position<T>::GetTimestamp() const
+{
+	return timestamp;
+}
+
+template<typename T>
+void Position<T>::SetTimestamp(Timestamp _timestamp)
+{
+	timestamp = _timestamp;
+}
+
 //return the aggregate position for this product across all books
 template<typename T>
 long Position<T>::GetAggregatePosition() const
@@ -102,15 +127,14 @@ long Position<T>::GetAggregatePosition() const
 template<typename T>
 string Position<T>::GetPersistKey() const
 {
-	return product.GetProductId();
+	return product.Get().GetProductId();
 }
 
 //data persisted in historical data service
 template<typename T>
 string Position<T>::GetPersistData() const
 {
-	auto now = std::chrono::system_clock::now();
-	string s = timeToString(now) + " , " +  this->GetPersistKey() + " , ";
+	string s = timeToString(timestamp) + " , " +  this->GetPersistKey() + " , ";
 	for (const auto& pair : positions)
 	{
 		s += pair.first;
@@ -124,6 +148,27 @@ string Position<T>::GetPersistData() const
 	return s;
 }
 
+//a column per book, then the aggregate; persisted positions hold the change made by one trade, not running totals
+template<typename T>
+vector<string> Position<T>::GetPersistColumns()
+{
+	vector<string> columns;
+	for (int i = 0; i < BOOK_COUNT; i++) columns.push_back(string("delta_") + TRADING_BOOKS[i]);
+	columns.push_back("delta_aggregate");
+	return columns;
+}
+
+template<typename T>
+void Position<T>::GetPersistValues(double* _values) const
+{
+	for (int i = 0; i < BOOK_COUNT; i++)
+	{
+		auto it = positions.find(TRADING_BOOKS[i]);
+		_values[i] = it != positions.end() ? it->second : 0;
+	}
+	_values[BOOK_COUNT] = this->GetAggregatePosition();
+}
+
 
 //Pre-declearations
 template<typename T>
@@ -216,7 +261,7 @@ PositionToTradeBookingListener<T>* PositionService<T>::GetListener() const
 template<typename T>
 void PositionService<T>::AddTrade(const Trade<T>& trade)
 {
-	T product = trade.GetProduct();
+	const T& product = trade.GetProduct();
 	string product_id = product.GetProductId();
 	auto side = trade.GetSide();
 	auto book = trade.GetBook();
@@ -229,10 +274,12 @@ void PositionService<T>::AddTrade(const Trade<T>& trade)
 		positions[product_id] = position;
 	}
 	positions[product_id].UpdatePosition(book, trade_quantity);
+	positions[product_id].SetTimestamp(trade.GetTimestamp());
 
 	//for listeners, send position associated with new trade.
 	Position<T> position_update(product);
 	position_update.UpdatePosition(book, trade_quantity);
+	position_update.SetTimestamp(trade.GetTimestamp());
 
 	for (auto& l : listeners)
 	{
@@ -39,16 +39,29 @@ public:
   //update the risk quantity
   void UpdateQuantity(long _quantity);
 
+  // Get the event time of the last risk change
+  Timestamp GetTimestamp() const;
+
+  // Set the event time of the last risk change
+  void SetTimestamp(Timestamp _timestamp);
+
   //key used to persist data in historical data service
   string GetPersistKey() const;
 
   //data persisted in historical data service
   string GetPersistData() const;
 
+  //numeric columns persisted in historical data service
+  static vector<string> GetPersistColumns();
+
+  //values of the persisted columns, in the order of GetPersistColumns
+  void GetPersistValues(double* _values) const;
+
 private:
-  T product;
+  ProductRef<T> product;
   double pv01;
   long quantity;
+  Timestamp timestamp = NO_TIMESTAMP;
 
 };
 
@@ -64,7 +77,7 @@ PV01<T>::PV01(const T& _product, double _pv01, long _quantity) :
 template<typename T>
 const T& PV01<T>::GetProduct() const
 {
-	return product;
+	return product.Get();
 }
 
 // Get the PV01 value
@@ -88,22 +101,46 @@ void PV01<T>::UpdateQuantity(long _quantity)
 	quantity += _quantity;
 }
 
+template<typename T>
+Timestamp PV01<T>::GetTimestamp() const
+{
+	return timestamp;
+}
+
+template<typename T>
+void PV01<T>::SetTimestamp(Timestamp _timestamp)
+{
+	timestamp = _timestamp;
+}
+
 // key used to persist data in historical data service
 template<typename T>
 string PV01<T>::GetPersistKey() const
 {
-	return product.GetProductId();
+	return product.Get().GetProductId();
 }
 
 //data persisted in historical data service
 template<typename T>
 string PV01<T>::GetPersistData() const
 {
-	auto now = std::chrono::system_clock::now();
-	string s = timeToString(now) + " , "  + this->GetPersistKey() + " ,  PV01: " + std::to_string(pv01) + " , Qty: " + std::to_string(quantity) + "\n";
+	string s = timeToString(timestamp) + " , "  + this->GetPersistKey() + " ,  PV01: " + std::to_string(pv01) + " , Qty: " + std::to_string(quantity) + "\n";
 	return s;
 }
 
+template<typename T>
+vector<string> PV01<T>::GetPersistColumns()
+{
+	return { "pv01", "quantity" };
+}
+
+template<typename T>
+void PV01<T>::GetPersistValues(double* _values) const
+{
+	_values[0] = pv01;
+	_values[1] = quantity;
+}
+
 /**
  * A bucket sector to bucket a group of securities.
  * We can then aggregate bucketed risk to this bucket.
@@ -263,6 +300,7 @@ void RiskService<T>::AddPosition(Position<T>& _position)
 	//get total quantity across all books
 	long total_qty = _position.GetAggregatePosition();
 	risks[product_id].UpdateQuantity(total_qty);
+	risks[product_id].SetTimestamp(_position.GetTimestamp());
 
 	for (auto& l : listeners)
 	{
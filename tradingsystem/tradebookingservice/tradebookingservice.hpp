@@ -11,6 +11,7 @@
 #include <string>
 #include <vector>
 #include "..\soa.hpp"
+#include "..\csvtokenizer.hpp"
 #include "..\bondstaticdata.hpp"
 #include "..\util.hpp"
 #include "..\executionservice\executionservice.hpp"
@@ -18,6 +19,11 @@
 // Trade sides
 enum Side { BUY, SELL };
 
+// Number of trading books; trades from executions are spread across them
+const int BOOK_COUNT = 3;
+
+static const string TRADING_BOOKS[BOOK_COUNT] = { "TRSY1", "TRSY2", "TRSY3" };
+
 /**
  * Trade object with a price, side, and quantity on a particular book.
  * Type T is the product type.
@@ -52,13 +58,20 @@ public:
   // Get the side
   Side GetSide() const;
 
+  // Get the event time of the trade
+  Timestamp GetTimestamp() const;
+
+  // Set the event time of the trade
+  void SetTimestamp(Timestamp _timestamp);
+
 private:
-  T product;
+  ProductRef<T> product;
   string tradeId;
   double price;
   string book;
   long quantity;
   Side side;
+  Timestamp timestamp = NO_TIMESTAMP;
 
 };
 
@@ -67,9 +80,9 @@ template<typename T>
 Trade<T>::Trade(const T& _product, string _tradeId, double _price, string _book, long _quantity, Side _side) :
     product(_product)
 {
-    tradeId = _tradeId;
+    tradeId = std::move(_tradeId);
     price = _price;
-    book = _book;
+    book = std::move(_book);
     quantity = _quantity;
     side = _side;
 }
@@ -77,7 +90,7 @@ Trade<T>::Trade(const T& _product, string _tradeId, double _price, string _book,
 template<typename T>
 const T& Trade<T>::GetProduct() const
 {
-    return product;
+    return product.Get();
 }
 
 template<typename T>
@@ -110,6 +123,18 @@ Side Trade<T>::GetSide() const
     return side;
 }
 
+template<typename T>
+Timestamp Trade<T>::GetTimestamp() const
+{
+    return timestamp;
+}
+
+template<typename T>
+void Trade<T>::SetTimestamp(Timestamp _timestamp)
+{
+    timestamp = _timestamp;
+}
+
 //predeclaration
 template<typename T>
 class TradeBookingConnector;
@@ -127,15 +152,16 @@ template<typename T>
 class TradeBookingService : public Service<string,Trade <T> >
 {
 private:
-    map<string, Trade<T>> trades;
+    map<string, Trade<T>> trades; //every booked trade by id, for GetData
     vector<ServiceListener<Trade<T>>*> listeners;
     TradeBookingConnector<T>* connector;
     TradingToExecutionListerner<T>* listener;
+    Clock* clock;
 
 public:
 
     // Constructor and destructor
-    TradeBookingService();
+    TradeBookingService(Clock* _clock = &DefaultClock());
     ~TradeBookingService();
 
     // Get data on our service given a key
@@ -144,6 +170,9 @@ public:
     // The callback that a Connector should invoke for any new or updated data
     void OnMessage(Trade<T>& _data);
 
+    // The callback for a trade the caller no longer needs; it is moved into the service
+    void OnMessage(Trade<T>&& _data);
+
     // Add a listener to the Service for callbacks on add, remove, and update events for data to the Service
     void AddListener(ServiceListener<Trade<T>>* _listener);
 
@@ -155,9 +184,15 @@ public:
 
     TradingToExecutionListerner<T>* GetListener();
 
+    // Get the clock used to timestamp trades
+    Clock* GetClock() const;
+
     // Book the trade
     void BookTrade(Trade<T> &trade);
 
+    // Book a trade the caller no longer needs, moving it into the service
+    void BookTrade(Trade<T> &&trade);
+
 
 };
 
@@ -173,8 +208,21 @@ void TradeBookingService<T>::BookTrade(Trade<T>& trade)
 }
 
 template<typename T>
-TradeBookingService<T>::TradeBookingService()
+void TradeBookingService<T>::BookTrade(Trade<T>&& trade)
 {
+    //book trade; the id is copied out before the trade is moved from
+    string trade_id = trade.GetTradeId();
+    Trade<T>& booked = trades.insert_or_assign(std::move(trade_id), std::move(trade)).first->second;
+    for (auto& l : listeners)
+    {
+        l->ProcessAdd(booked);
+    }
+}
+
+template<typename T>
+TradeBookingService<T>::TradeBookingService(Clock* _clock)
+{
+    clock = _clock;
     trades = map<string, Trade<T>>();
     listeners = vector<ServiceListener<Trade<T>>*>();
     connector = new TradeBookingConnector<T>(this);
@@ -197,6 +245,12 @@ void TradeBookingService<T>::OnMessage(Trade<T>& _data)
 
 }
 
+template<typename T>
+void TradeBookingService<T>::OnMessage(Trade<T>&& _data)
+{
+    this->BookTrade(std::move(_data));
+}
+
 template<typename T>
 void TradeBookingService<T>::AddListener(ServiceListener<Trade<T>>* _listener)
 {
@@ -222,9 +276,17 @@ TradingToExecutionListerner<T>* TradeBookingService<T>::GetListener()
     return listener;
 }
 
+template<typename T>
+Clock* TradeBookingService<T>::GetClock() const
+{
+    return clock;
+}
+
 
 /**
 *Booking Connector subscribing data to Booking Service.
+*Lines are product,trade id,price,book,quantity,side with an optional trailing event time in
+*milliseconds since epoch; trades are stamped by the service clock.
 */
 template<typename T>
 class TradeBookingConnector : public Connector<Trade<T>>
@@ -244,6 +306,12 @@ public:
     void Publish(Trade<T>& _data);
     void Subscribe(ifstream& _data);
 
+    // Parse one line of trade data and pass the trade to the service
+    void OnLine(const string& _line);
+
+    // Handle the fields of one line of trade data
+    void OnFields(const CsvLine& _line);
+
 };
 
 
@@ -269,30 +337,38 @@ void TradeBookingConnector<T>::Subscribe(ifstream& _data)
         return;
     }
 
-    std::string line;
-    while (getline(_data, line)) {
-        std::stringstream ss(line);
-        std::string item;
-        std::vector<std::string> splittedItems;
+    CsvReader reader;
+    reader.Read(_data, [this](const CsvLine& _line) { OnFields(_line); });
 
+    _data.close();
 
-        while (getline(ss, item, ','))
-        {
-            splittedItems.push_back(item);
-        }
-
-        T b = get_product<T>(splittedItems[0]);
-        Trade<T> trade(b, splittedItems[1], fractional_to_decimal(splittedItems[2]), splittedItems[3], std::stod(splittedItems[4]), splittedItems[5] == "BUY" ?BUY:SELL);
-        service->OnMessage(trade);
+}
 
-    }
+template<typename T>
+void TradeBookingConnector<T>::OnLine(const string& _line)
+{
+    CsvLine fields;
+    tokenize_line(_line.data(), _line.data() + _line.size(), fields);
+    OnFields(fields);
+}
 
-    _data.close();
+template<typename T>
+void TradeBookingConnector<T>::OnFields(const CsvLine& _line)
+{
+    Timestamp event_time = _line.count > 6 ? _line.Integer(6) : NO_TIMESTAMP;
 
+    const T& b = get_product<T>(_line.View(0));
+    Trade<T> trade(b, _line.Field(1), fractional_to_decimal(_line.View(2)), _line.Field(3), _line.Number(4), _line.View(5) == "BUY" ?BUY:SELL);
+    trade.SetTimestamp(service->GetClock()->Stamp(event_time));
+    service->OnMessage(std::move(trade));
 }
 
+/**
+* TradingToExecutionListerner listens to fills from ExecutionService and books a trade for each fill.
+* Type T is the product type.
+*/
 template<typename T>
-class TradingToExecutionListerner : public ServiceListener<ExecutionOrder<T>>
+class TradingToExecutionListerner : public ServiceListener<ExecutionFill<T>>
 {
 private:
 
@@ -306,13 +382,13 @@ public:
     ~TradingToExecutionListerner();
 
     // Listener callback to process an add event to the Service
-    void ProcessAdd(ExecutionOrder<T>& _data);
+    void ProcessAdd(ExecutionFill<T>& _data);
 
     // Listener callback to process a remove event to the Service
-    void ProcessRemove(ExecutionOrder<T>& _data);
+    void ProcessRemove(ExecutionFill<T>& _data);
 
     // Listener callback to process an update event to the Service
-    void ProcessUpdate(ExecutionOrder<T>& _data);
+    void ProcessUpdate(ExecutionFill<T>& _data);
 
 };
 
@@ -327,36 +403,23 @@ template<typename T>
 TradingToExecutionListerner<T>::~TradingToExecutionListerner() {}
 
 template<typename T>
-void TradingToExecutionListerner<T>::ProcessAdd(ExecutionOrder<T>& _data)
+void TradingToExecutionListerner<T>::ProcessAdd(ExecutionFill<T>& _data)
 {
-    string book;
     //cycle through the books TRSY1, TRSY2, TRSY3
-    switch (count % 3)
-    {
-    case 0:
-        book = "TRSY1";
-        break;
-    case 1:
-        book = "TRSY2";
-        break;
-    case 2:
-        book = "TRSY3";
-        break;
-    default:
-        break;
-    }
+    const string& book = TRADING_BOOKS[count % BOOK_COUNT];
     Side side = _data.GetPricingSide() == BID ? BUY : SELL;
-    Trade<T> trade(_data.GetProduct(), _data.GetOrderId(),_data.GetPrice(), book, _data.GetVisibleQuantity() + _data.GetVisibleQuantity(), side);
-    service->BookTrade(trade);
+    Trade<T> trade(_data.GetProduct(), _data.GetFillId(), _data.GetPrice(), book, _data.GetQuantity(), side);
+    trade.SetTimestamp(_data.GetTimestamp());
+    service->BookTrade(std::move(trade));
 
     count++;
 }
 
 template<typename T>
-void TradingToExecutionListerner<T>::ProcessRemove(ExecutionOrder<T>& _data) {}
+void TradingToExecutionListerner<T>::ProcessRemove(ExecutionFill<T>& _data) {}
 
 template<typename T>
-void TradingToExecutionListerner<T>::ProcessUpdate(ExecutionOrder<T>& _data) {}
+void TradingToExecutionListerner<T>::ProcessUpdate(ExecutionFill<T>& _data) {}
 
 
 #endif
@@ -15,6 +15,18 @@
 #include <cmath> // For round function
 #include <iomanip>
 #include <chrono>
+#include <string_view>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UTIL_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 
 //function to convert decimal to fractional representation - by chatgpt
@@ -36,30 +48,109 @@ std::string decimal_to_fractional(double decimal) {
     return std::to_string(whole_part) + "-" + (fraction_32_whole < 10 ? "0" : "") + std::to_string(fraction_32_whole) + fraction_256_str;
 }
 
-//function to convert fractional to decimal representation - by chatgpt
-double fractional_to_decimal(const std::string& fractional)
+// Treasury prices are quoted in 256ths of a point
+const int TICKS_PER_POINT = 256;
+
+// Index of the lowest set bit of a non zero mask
+inline int lowest_bit(uint32_t mask)
 {
-    size_t dashPos = fractional.find('-');
-    if (dashPos == std::string::npos) {
-        std::cerr << "Invalid format" << std::endl;
-        return -1.0; // or handle error appropriately
-    }
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
 
-    // Extract whole part and fractional part
-    std::string wholePart = fractional.substr(0, dashPos);
-    std::string fractionPart = fractional.substr(dashPos + 1);
+#ifdef UTIL_SSE2
+// Place values of the digits of a quote in ticks, by position of the dash: whole points, then 32nds, then 256ths
+alignas(16) const int16_t FRACTIONAL_WEIGHTS[4][8] = {
+    { 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 256, 0, 80, 8, 1, 0, 0, 0 },
+    { 2560, 256, 0, 80, 8, 1, 0, 0 },
+    { 25600, 2560, 256, 0, 80, 8, 1, 0 },
+};
+#endif
+
+// Convert a fractional price such as "99-16+" or "100-001" to 256ths; false if it is not a valid quote under 1000
+bool fractional_to_ticks(const char* text, size_t length, int& ticks)
+{
+    //shortest is "9-00", longest "999-31+"
+    if (length < 4 || length > 7) return false;
+
+#ifdef UTIL_SSE2
+    //compare all characters at once: digit and dash masks give the layout, one multiply-add the value
+    char padded[8] = { 0 };
+    memcpy(padded, text, length);
+    __m128i chars = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(padded));
+    __m128i values = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(values, _mm_set1_epi8(9)), values);
+    uint32_t digits = static_cast<uint32_t>(_mm_movemask_epi8(is_digit)) & ((1u << length) - 1);
+    uint32_t dashes = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chars, _mm_set1_epi8('-')))) & 0xFF;
+    if (dashes == 0) return false;
+    int dash = lowest_bit(dashes);
+#else
+    const char* found = static_cast<const char*>(memchr(text, '-', length));
+    if (found == nullptr) return false;
+    int dash = static_cast<int>(found - text);
+    uint32_t digits = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (text[i] >= '0' && text[i] <= '9') digits |= 1u << i;
+    }
+#endif
+
+    //1 to 3 digits of points, 2 digits of 32nds, then an optional digit or '+' of 256ths
+    int fraction_length = static_cast<int>(length) - dash - 1;
+    if (dash < 1 || dash > 3 || fraction_length < 2 || fraction_length > 3) return false;
+    bool plus = fraction_length == 3 && text[length - 1] == '+';
+    uint32_t expected = ((1u << dash) - 1) | (3u << (dash + 1));
+    if (fraction_length == 3 && !plus) expected |= 1u << (dash + 3);
+    if (digits != expected) return false;
+    if (text[dash + 1] > '3' || (text[dash + 1] == '3' && text[dash + 2] > '1')) return false;
+    if (fraction_length == 3 && !plus && text[dash + 3] > '7') return false;
+
+#ifdef UTIL_SSE2
+    __m128i digit_values = _mm_unpacklo_epi8(_mm_and_si128(values, is_digit), _mm_setzero_si128());
+    __m128i sums = _mm_madd_epi16(digit_values, _mm_load_si128(reinterpret_cast<const __m128i*>(FRACTIONAL_WEIGHTS[dash])));
+    sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, 0x4E));
+    sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, 0xB1));
+    ticks = _mm_cvtsi128_si32(sums);
+#else
+    int whole = 0;
+    for (int i = 0; i < dash; i++) whole = whole * 10 + (text[i] - '0');
+    ticks = whole * TICKS_PER_POINT + ((text[dash + 1] - '0') * 10 + (text[dash + 2] - '0')) * 8;
+    if (fraction_length == 3 && !plus) ticks += text[dash + 3] - '0';
+#endif
+    if (plus) ticks += 4;
+    return true;
+}
 
-    // Extract parts for 32nds and 256ths
-    int fraction32 = std::stoi(fractionPart.substr(0, 2));
-    int fraction256 = 0;
-    if (fractionPart.length() > 2) {
-        fraction256 = (fractionPart[2] == '+') ? 4 : std::stoi(fractionPart.substr(2));
+// Convert a list of fractional prices to 256ths; invalid quotes get -1. Returns the number of valid quotes.
+// A convenience loop: each quote is still converted on its own by fractional_to_ticks.
+size_t fractional_list_to_ticks(const std::string_view* quotes, size_t count, int* ticks)
+{
+    size_t valid = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (fractional_to_ticks(quotes[i].data(), quotes[i].size(), ticks[i])) valid++;
+        else ticks[i] = -1;
     }
+    return valid;
+}
 
-    // Convert to decimal
-    float decimalFraction = fraction32 / 32.0f + fraction256 / 256.0f;
+//function to convert fractional to decimal representation
+double fractional_to_decimal(std::string_view fractional)
+{
+    int ticks;
+    if (!fractional_to_ticks(fractional.data(), fractional.size(), ticks)) {
+        std::cerr << "Invalid format" << std::endl;
+        return -1.0; // or handle error appropriately
+    }
 
-    return std::stof(wholePart) + decimalFraction;
+    //every tick is exact in a double
+    return static_cast<double>(ticks) / TICKS_PER_POINT;
 }
 
 //convert a time to string, including millisecond precision. Implemented by chatgpt.
@@ -83,4 +174,10 @@ std::string timeToString(std::chrono::time_point<std::chrono::system_clock> now)
     return timestamp.str();
 }
 
+//convert a time in milliseconds since epoch to string, including millisecond precision.
+std::string timeToString(long long millis)
+{
+    return timeToString(std::chrono::time_point<std::chrono::system_clock>(std::chrono::milliseconds(millis)));
+}
+
 #endif // !UTIL_HPP
@@ -0,0 +1,225 @@
+/**
+ * uuid.hpp
+ * 128 bit UUID values parsed from their text form, and an open addressing index keyed by them.
+ * Used for ids that arrive as UUID text (inquiry ids) so they are compared and hashed as two
+ * integers and only rendered back to text when persisted.
+ *
+ * @author Krystal Lin
+ */
+
+#ifndef UUID_HPP
+#define UUID_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "slottable.hpp"
+
+using namespace std;
+
+/**
+ * A UUID as two 64 bit halves, high holding the first 16 hex digits.
+ */
+struct Uuid
+{
+	uint64_t high;
+	uint64_t low;
+};
+
+bool operator==(const Uuid& _a, const Uuid& _b)
+{
+	return _a.high == _b.high && _a.low == _b.low;
+}
+
+bool operator!=(const Uuid& _a, const Uuid& _b)
+{
+	return !(_a == _b);
+}
+
+// Parse a UUID in 8-4-4-4-12 hex form (either case); false if the text is not a UUID
+bool parse_uuid(string_view _text, Uuid& _uuid)
+{
+	if (_text.size() != 36) return false;
+
+	uint64_t halves[2] = { 0, 0 };
+	int digits = 0;
+	for (size_t i = 0; i < _text.size(); i++)
+	{
+		char c = _text[i];
+		if (i == 8 || i == 13 || i == 18 || i == 23)
+		{
+			if (c != '-') return false;
+			continue;
+		}
+
+		uint64_t value;
+		if (c >= '0' && c <= '9') value = c - '0';
+		else if (c >= 'a' && c <= 'f') value = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F') value = c - 'A' + 10;
+		else return false;
+
+		halves[digits / 16] = (halves[digits / 16] << 4) | value;
+		digits++;
+	}
+
+	_uuid.high = halves[0];
+	_uuid.low = halves[1];
+	return true;
+}
+
+// Render a UUID in lowercase 8-4-4-4-12 hex form
+string uuid_to_string(const Uuid& _uuid)
+{
+	static const char HEX[] = "0123456789abcdef";
+	string text(36, '-');
+
+	int digit = 0;
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		if (i == 8 || i == 13 || i == 18 || i == 23) continue;
+
+		uint64_t half = digit < 16 ? _uuid.high : _uuid.low;
+		int shift = 60 - 4 * (digit % 16);
+		text[i] = HEX[(half >> shift) & 0xF];
+		digit++;
+	}
+	return text;
+}
+
+/**
+ * Open addressing hash index from UUIDs to slot handles.
+ * Entries live in one power of two sized array probed linearly; erase shifts the following
+ * entries back instead of leaving tombstones, so probe sequences stay short under churn.
+ * The array doubles when it is half full.
+ */
+class UuidIndex
+{
+
+private:
+
+	struct Entry
+	{
+		Uuid key;
+		SlotHandle value; //INVALID_SLOT_HANDLE marks an empty entry
+	};
+
+	vector<Entry> entries;
+	size_t mask;
+	size_t count;
+
+	size_t Home(const Uuid& _key) const;
+	void Grow();
+
+public:
+
+	// Constructor, sized to hold _capacity keys without growing
+	UuidIndex(size_t _capacity = 1024);
+
+	// Get the handle stored for a key, INVALID_SLOT_HANDLE if absent
+	SlotHandle Find(const Uuid& _key) const;
+
+	// Store a handle for a key; false if the key is already present
+	bool Insert(const Uuid& _key, SlotHandle _value);
+
+	// Remove a key; false if it is absent
+	bool Erase(const Uuid& _key);
+
+	// Number of keys
+	size_t Size() const;
+
+};
+
+UuidIndex::UuidIndex(size_t _capacity)
+{
+	size_t size = 16;
+	while (size < _capacity * 2) size <<= 1;
+
+	entries = vector<Entry>(size, Entry{ { 0, 0 }, INVALID_SLOT_HANDLE });
+	mask = size - 1;
+	count = 0;
+}
+
+size_t UuidIndex::Home(const Uuid& _key) const
+{
+	//random UUIDs are already well mixed, fold and spread the halves for ids that are not
+	uint64_t h = (_key.high ^ (_key.low * 0x9E3779B97F4A7C15ULL)) * 0xBF58476D1CE4E5B9ULL;
+	return static_cast<size_t>(h >> 32) & mask;
+}
+
+void UuidIndex::Grow()
+{
+	vector<Entry> old = std::move(entries);
+	entries = vector<Entry>(old.size() * 2, Entry{ { 0, 0 }, INVALID_SLOT_HANDLE });
+	mask = entries.size() - 1;
+	count = 0;
+
+	for (const Entry& e : old)
+	{
+		if (e.value != INVALID_SLOT_HANDLE) Insert(e.key, e.value);
+	}
+}
+
+SlotHandle UuidIndex::Find(const Uuid& _key) const
+{
+	for (size_t i = Home(_key);; i = (i + 1) & mask)
+	{
+		const Entry& e = entries[i];
+		if (e.value == INVALID_SLOT_HANDLE) return INVALID_SLOT_HANDLE;
+		if (e.key == _key) return e.value;
+	}
+}
+
+bool UuidIndex::Insert(const Uuid& _key, SlotHandle _value)
+{
+	if ((count + 1) * 2 > entries.size()) Grow();
+
+	for (size_t i = Home(_key);; i = (i + 1) & mask)
+	{
+		Entry& e = entries[i];
+		if (e.value == INVALID_SLOT_HANDLE)
+		{
+			e.key = _key;
+			e.value = _value;
+			count++;
+			return true;
+		}
+		if (e.key == _key) return false;
+	}
+}
+
+bool UuidIndex::Erase(const Uuid& _key)
+{
+	size_t i = Home(_key);
+	while (true)
+	{
+		if (entries[i].value == INVALID_SLOT_HANDLE) return false;
+		if (entries[i].key == _key) break;
+		i = (i + 1) & mask;
+	}
+
+	//backward shift: move later entries of the cluster into the hole unless that would put them before their home
+	size_t hole = i;
+	for (size_t j = (hole + 1) & mask; entries[j].value != INVALID_SLOT_HANDLE; j = (j + 1) & mask)
+	{
+		size_t home = Home(entries[j].key);
+		bool movable = hole <= j ? (home <= hole || home > j) : (home <= hole && home > j);
+		if (movable)
+		{
+			entries[hole] = entries[j];
+			hole = j;
+		}
+	}
+
+	entries[hole].value = INVALID_SLOT_HANDLE;
+	count--;
+	return true;
+}
+
+size_t UuidIndex::Size() const
+{
+	return count;
+}
+
+#endif